@@ -3,10 +3,21 @@ TEMPLATE = subdirs
 SUBDIRS += \
     askelib \
     std \
-    widgets
+    grammarc \
+    widgets \
+    highlight \
+    highlightbench \
+    editorbench
 
 askelib.subdir = askelib
 std.subdir = std
+grammarc.subdir = tools/grammarc
 widgets.subdir = widgets
+highlight.subdir = tools/highlight
+highlightbench.subdir = tools/highlightbench
+editorbench.subdir = tools/editorbench
 
-widgets.depends = askelib
+widgets.depends = askelib grammarc
+highlight.depends = widgets
+highlightbench.depends = widgets
+editorbench.depends = widgets
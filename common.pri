@@ -6,4 +6,5 @@ CONFIG(debug, debug|release) {
 }
 
 ASKELIBQT_LIB_PATH = $$PWD/libs/
+ASKELIBQT_BIN_PATH = $$PWD/bin/
 ASKELIBQT_INCLUDE_PATH = $$PWD
@@ -0,0 +1,314 @@
+/*! @file
+ *
+ * editorbench measures end-to-end `TextEditor` latencies.
+ *
+ * Usage: `editorbench [-o <result.json>] [--sizes 1K,1M,...] [--repeat <n>] [--keys <n>]`
+ *
+ * Runs on the offscreen platform unless `QT_QPA_PLATFORM` says otherwise.
+ * For every size a C++ file is generated and the same script is played:
+ *  - `open`: `openFile()` until the first paint of the viewport;
+ *  - `scrollToEnd`: scroll bar moved to the end until repainted, skipped and
+ *    counted as such if the document fits the viewport;
+ *  - `keystroke`: a key typed at the start, middle and end of the document
+ *    until repainted, highlighting is on;
+ *  - `save`: `saveFile()`.
+ *
+ * Files from `TextEditor`'s large-file limit are shown by a view covering
+ * the editor, the script is played on that view then. A step which is not
+ * repainted in time fails the benchmark.
+ *
+ * Every measurement is repeated and exported as JSON percentiles.
+ */
+
+#include "texteditor/texteditor.h"
+#include "texteditor/largetextview.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QKeyEvent>
+#include <QScrollBar>
+#include <QTemporaryDir>
+#include <QTextBlock>
+
+using namespace aske;
+
+namespace {
+
+//! Notices paint events of a widget
+class PaintProbe : public QObject
+{
+public:
+    explicit PaintProbe(QWidget *widget) {
+        widget->installEventFilter(this);
+    }
+
+    void reset() { m_painted = false; }
+
+    /*! Process events until the widget is painted, returns false on timeout. */
+    bool wait(qint64 timeout = 600000) {
+        QElapsedTimer timer;
+        timer.start();
+        while(!m_painted && timer.elapsed() < timeout) {
+            QCoreApplication::processEvents(QEventLoop::AllEvents, 10);
+        }
+        return m_painted;
+    }
+
+protected:
+    bool eventFilter(QObject *, QEvent *event) override {
+        if(event->type() == QEvent::Paint) {
+            m_painted = true;
+        }
+        return false;
+    }
+
+private:
+    bool m_painted {false};
+};
+
+qint64 parseSize(QString size)
+{
+    qint64 factor = 1;
+    if(size.endsWith('K', Qt::CaseInsensitive)) {
+        factor = 1024;
+    } else if(size.endsWith('M', Qt::CaseInsensitive)) {
+        factor = 1024 * 1024;
+    } else if(size.endsWith('G', Qt::CaseInsensitive)) {
+        factor = 1024 * 1024 * 1024;
+    }
+    if(factor != 1) {
+        size.chop(1);
+    }
+    return size.toLongLong() * factor;
+}
+
+//! Write `size` bytes of C++-like source into `fileName`
+bool generateFile(const QString &fileName, qint64 size)
+{
+    QFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    const QByteArray lines[] = {
+        "#include <vector>\n",
+        "/* block comment which spans\n   two lines */\n",
+        "static int compute(const std::vector<int> &values, int index) {\n",
+        "    if (index < 0 || values.empty()) return -1; // guard\n",
+        "    const char *label = \"value \\\"quoted\\\"\";\n",
+        "    for (int i = 0; i < 100; ++i) { total += values[i % values.size()] * 3; }\n",
+        "}\n",
+        "\n",
+    };
+
+    QByteArray chunk;
+    while(chunk.size() < 64 * 1024) {
+        for(const QByteArray &line : lines) {
+            chunk += line;
+        }
+    }
+
+    qint64 written = 0;
+    while(written < size) {
+        const qint64 part = qMin<qint64>(chunk.size(), size - written);
+        file.write(chunk.constData(), part);
+        written += part;
+    }
+    return true;
+}
+
+QJsonObject percentiles(QVector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    auto at = [&](double p) {
+        if(samples.isEmpty()) {
+            return 0.0;
+        }
+        const qsizetype index = qMin<qsizetype>(samples.size() - 1, static_cast<qsizetype>(p * samples.size()));
+        return samples.at(index);
+    };
+    return {
+        {"count", static_cast<qint64>(samples.size())},
+        {"p50", at(0.50)},
+        {"p90", at(0.90)},
+        {"p99", at(0.99)},
+        {"max", samples.isEmpty() ? 0.0 : samples.last()},
+    };
+}
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return timer.nsecsElapsed() / 1e6;
+}
+
+//! Plays the script, returns false if a step was not repainted in time
+bool runScript(const QString &fileName, qint64 size, int repeat, int keys, QJsonObject *result)
+{
+    QVector<double> open, scroll, keystroke, save;
+    qint64 scrollSkipped = 0;
+
+    for(int run = 0; run < repeat; ++run) {
+        TextEditor editor(TextEditor::Type::Text | TextEditor::Type::Code);
+        editor.resize(1024, 768);
+        editor.show();
+        PaintProbe probe(editor.viewport());
+        probe.wait(1000);
+
+        QElapsedTimer timer;
+
+        auto failed = [&](const char *step) {
+            fprintf(stderr, "%s of %s was not repainted in time\n", step, qPrintable(fileName));
+            return false;
+        };
+
+        // paint of the view is posted, nothing is painted until events are processed
+        timer.start();
+        editor.openFile(fileName);
+        auto large = editor.findChild<TextEditorPrivate::LargeTextView *>();
+        QAbstractScrollArea *view = large ? static_cast<QAbstractScrollArea *>(large) : &editor;
+        PaintProbe viewProbe(view->viewport());
+        if(!viewProbe.wait()) {
+            return failed("open");
+        }
+        open.append(elapsedMs(timer));
+
+        // paints still posted by the open must not be taken for the scroll
+        QCoreApplication::processEvents();
+        QScrollBar *bar = view->verticalScrollBar();
+        const int before = bar->value();
+        viewProbe.reset();
+        timer.start();
+        bar->setValue(bar->maximum());
+        if(bar->value() == before) {
+            // nothing to scroll, no paint would come
+            ++scrollSkipped;
+        } else {
+            if(!viewProbe.wait()) {
+                return failed("scrollToEnd");
+            }
+            scroll.append(elapsedMs(timer));
+        }
+
+        // keystrokes at start, middle and end of the document
+        const qint64 lines = large ? large->text().lineCount() : editor.document()->blockCount();
+        const qint64 positions[] = {0, lines / 2, lines - 1};
+        for(int i = 0; i < keys; ++i) {
+            if(large) {
+                large->setCursorPosition(large->text().lineStart(positions[i % 3]));
+            } else {
+                QTextCursor cursor(editor.document()->findBlockByNumber(static_cast<int>(positions[i % 3])));
+                editor.setTextCursor(cursor);
+                editor.ensureCursorVisible();
+            }
+            QCoreApplication::processEvents();
+
+            QKeyEvent press(QEvent::KeyPress, Qt::Key_X, Qt::NoModifier, "x");
+            QKeyEvent release(QEvent::KeyRelease, Qt::Key_X, Qt::NoModifier, "x");
+            viewProbe.reset();
+            timer.start();
+            QCoreApplication::sendEvent(view, &press);
+            QCoreApplication::sendEvent(view, &release);
+            if(!viewProbe.wait()) {
+                return failed("keystroke");
+            }
+            keystroke.append(elapsedMs(timer));
+        }
+
+        timer.start();
+        editor.saveFile(fileName + ".saved");
+        save.append(elapsedMs(timer));
+        QFile::remove(fileName + ".saved");
+    }
+
+    QJsonObject scrollPercentiles = percentiles(scroll);
+    scrollPercentiles["skipped"] = scrollSkipped;
+
+    *result = {
+        {"size", size},
+        {"open", percentiles(open)},
+        {"scrollToEnd", scrollPercentiles},
+        {"keystroke", percentiles(keystroke)},
+        {"save", percentiles(save)},
+    };
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark TextEditor latencies.");
+    parser.addHelpOption();
+    const QCommandLineOption outputOption({"o", "output"}, "Write JSON into <file> instead of stdout.", "file");
+    const QCommandLineOption sizesOption("sizes", "Comma separated file sizes.", "sizes", "1K,64K,1M,16M,256M,1G");
+    const QCommandLineOption repeatOption("repeat", "Runs of the script per size, files over 16M run once.", "n", "5");
+    const QCommandLineOption keysOption("keys", "Keystrokes per run.", "n", "30");
+    parser.addOptions({outputOption, sizesOption, repeatOption, keysOption});
+    parser.process(app);
+
+    QTemporaryDir dir;
+    if(!dir.isValid()) {
+        fprintf(stderr, "can not create temporary directory\n");
+        return 1;
+    }
+
+    QJsonArray results;
+    for(const QString &sizeName : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        const qint64 size = parseSize(sizeName.trimmed());
+        const QString fileName = dir.filePath(QString("bench-%1.cpp").arg(sizeName.trimmed()));
+        if(size <= 0 || !generateFile(fileName, size)) {
+            fprintf(stderr, "skipping size %s\n", qPrintable(sizeName));
+            continue;
+        }
+
+        const int repeat = size > 16 * 1024 * 1024 ? 1 : parser.value(repeatOption).toInt();
+        QJsonObject result;
+        const bool ok = runScript(fileName, size, repeat, parser.value(keysOption).toInt(), &result);
+        QFile::remove(fileName);
+        if(!ok) {
+            return 1;
+        }
+        result["name"] = sizeName.trimmed();
+        results.append(result);
+
+        auto ms = [&](const char *step, const char *percentile) {
+            return result.value(step).toObject().value(percentile).toDouble();
+        };
+        fprintf(stderr, "%-6s open %9.1f ms  scroll %8.1f ms  key p50 %6.2f p99 %6.2f ms  save %8.1f ms\n",
+                qPrintable(sizeName.trimmed()), ms("open", "p50"), ms("scrollToEnd", "p50"),
+                ms("keystroke", "p50"), ms("keystroke", "p99"), ms("save", "p50"));
+    }
+
+    const QJsonObject report {
+        {"qt", qVersion()},
+        {"platform", QGuiApplication::platformName()},
+        {"results", results},
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if(parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "can not write %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        file.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,681 @@
+#include "automaton.h"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace grammarc {
+
+namespace {
+
+CharSet charSet(int c)
+{
+    CharSet set;
+    set.set(static_cast<std::size_t>(c));
+    return set;
+}
+
+CharSet range(int from, int to)
+{
+    CharSet set;
+    for(int c = from; c <= to; ++c) {
+        set.set(static_cast<std::size_t>(c));
+    }
+    return set;
+}
+
+CharSet foldCase(CharSet set)
+{
+    for(int c = 'a'; c <= 'z'; ++c) {
+        const int upper = c - 'a' + 'A';
+        if(set.test(c) || set.test(upper)) {
+            set.set(c);
+            set.set(upper);
+        }
+    }
+    return set;
+}
+
+CharSet spaceChars()
+{
+    CharSet set;
+    for(char c : {' ', '\t', '\r', '\n', '\v', '\f'}) {
+        set.set(static_cast<std::size_t>(c));
+    }
+    return set;
+}
+
+//
+// PARSER
+//
+
+class RegexParser
+{
+public:
+    RegexParser(const std::string &pattern, bool caseInsensitive)
+        : m_p(pattern)
+        , m_caseInsensitive(caseInsensitive)
+    {}
+
+    RegexPtr parse() {
+        RegexPtr r = alternation();
+        if(m_pos != m_p.size()) {
+            error("unbalanced ')'");
+        }
+        return r;
+    }
+
+private:
+    [[noreturn]] void error(const std::string &what) const {
+        throw std::runtime_error("regex \"" + m_p + "\" at " + std::to_string(m_pos) + ": " + what);
+    }
+
+    bool atEnd() const { return m_pos >= m_p.size(); }
+    char peek() const { return m_p[m_pos]; }
+
+    int take() {
+        const unsigned char c = static_cast<unsigned char>(m_p[m_pos++]);
+        if(c < 0x80) {
+            return c;
+        }
+        // skip UTF-8 continuation bytes: any non-ASCII is one symbol
+        while(!atEnd() && (static_cast<unsigned char>(peek()) & 0xC0) == 0x80) {
+            ++m_pos;
+        }
+        return NonAscii;
+    }
+
+    RegexPtr alternation() {
+        std::vector<RegexPtr> items {sequence()};
+        while(!atEnd() && peek() == '|') {
+            ++m_pos;
+            items.push_back(sequence());
+        }
+        if(items.size() == 1) {
+            return items.front();
+        }
+        auto r = std::make_shared<Regex>();
+        r->kind = Regex::Alternation;
+        r->items = std::move(items);
+        return r;
+    }
+
+    RegexPtr sequence() {
+        std::vector<RegexPtr> items;
+        while(!atEnd() && peek() != '|' && peek() != ')') {
+            items.push_back(quantified());
+        }
+        if(items.empty()) {
+            error("empty expression");
+        }
+        return Regex::concat(std::move(items));
+    }
+
+    int number() {
+        if(atEnd() || peek() < '0' || peek() > '9') {
+            error("number expected");
+        }
+        int n = 0;
+        while(!atEnd() && peek() >= '0' && peek() <= '9') {
+            n = n * 10 + (m_p[m_pos++] - '0');
+        }
+        return n;
+    }
+
+    RegexPtr quantified() {
+        RegexPtr r = atom();
+        while(!atEnd()) {
+            const char c = peek();
+            if(c == '*') {
+                ++m_pos;
+                r = Regex::repeat(r, 0, -1);
+            } else if(c == '+') {
+                ++m_pos;
+                r = Regex::repeat(r, 1, -1);
+            } else if(c == '?') {
+                ++m_pos;
+                r = Regex::repeat(r, 0, 1);
+            } else if(c == '{') {
+                ++m_pos;
+                const int min = number();
+                int max = min;
+                if(!atEnd() && peek() == ',') {
+                    ++m_pos;
+                    max = (!atEnd() && peek() == '}') ? -1 : number();
+                }
+                if(atEnd() || peek() != '}') {
+                    error("'}' expected");
+                }
+                ++m_pos;
+                if(max >= 0 && max < min) {
+                    error("bad repetition range");
+                }
+                r = Regex::repeat(r, min, max);
+            } else {
+                break;
+            }
+            if(!atEnd() && (peek() == '?' || peek() == '+')) {
+                error("lazy and possessive quantifiers are not supported");
+            }
+        }
+        return r;
+    }
+
+    // escape after '\', returns set of matched symbols
+    CharSet escape(bool inClass) {
+        if(atEnd()) {
+            error("dangling '\\'");
+        }
+        const char c = m_p[m_pos++];
+        switch(c) {
+        case 'd': return digitChars();
+        case 'D': return ~digitChars();
+        case 'w': return wordChars();
+        case 'W': return ~wordChars();
+        case 's': return spaceChars();
+        case 'S': return ~spaceChars();
+        case 't': return charSet('\t');
+        case 'n': return charSet('\n');
+        case 'r': return charSet('\r');
+        case 'f': return charSet('\f');
+        case 'v': return charSet('\v');
+        case 'x': {
+            if(m_pos + 2 > m_p.size()) {
+                error("\\xHH expected");
+            }
+            const int value = std::stoi(m_p.substr(m_pos, 2), nullptr, 16);
+            m_pos += 2;
+            return charSet(value < 128 ? value : NonAscii);
+        }
+        case 'b': case 'B': case 'A': case 'z': case 'Z': case 'G':
+            if(!inClass) {
+                error("anchors are not supported");
+            }
+            break;
+        default:
+            if(c >= '1' && c <= '9') {
+                error("backreferences are not supported");
+            }
+            break;
+        }
+        if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            error(std::string("unknown escape \\") + c);
+        }
+        return charSet(static_cast<unsigned char>(c) < 128 ? c : NonAscii);
+    }
+
+    CharSet bracket() {
+        bool negated = false;
+        if(!atEnd() && peek() == '^') {
+            negated = true;
+            ++m_pos;
+        }
+
+        CharSet set;
+        bool first = true;
+        while(!atEnd() && (peek() != ']' || first)) {
+            first = false;
+
+            CharSet item;
+            int low = -1;
+            if(peek() == '\\') {
+                ++m_pos;
+                item = escape(true);
+                if(item.count() == 1) {
+                    for(int c = 0; c < AlphabetSize; ++c) {
+                        if(item.test(c)) {
+                            low = c;
+                        }
+                    }
+                }
+            } else {
+                low = take();
+                item = charSet(low);
+            }
+
+            // range
+            if(low >= 0 && m_pos + 1 < m_p.size() && peek() == '-' && m_p[m_pos + 1] != ']') {
+                ++m_pos;
+                int high;
+                if(peek() == '\\') {
+                    ++m_pos;
+                    const CharSet h = escape(true);
+                    if(h.count() != 1) {
+                        error("bad range end");
+                    }
+                    high = 0;
+                    while(!h.test(high)) {
+                        ++high;
+                    }
+                } else {
+                    high = take();
+                }
+                if(high < low) {
+                    error("bad range");
+                }
+                item = range(low, high);
+            }
+            set |= item;
+        }
+        if(atEnd()) {
+            error("']' expected");
+        }
+        ++m_pos;
+
+        if(m_caseInsensitive) {
+            set = foldCase(set);
+        }
+        return negated ? ~set : set;
+    }
+
+    RegexPtr atom() {
+        const char c = peek();
+        switch(c) {
+        case '(': {
+            ++m_pos;
+            if(m_p.compare(m_pos, 2, "?:") == 0) {
+                m_pos += 2;
+            } else if(!atEnd() && peek() == '?') {
+                error("lookarounds and inline flags are not supported");
+            }
+            RegexPtr r = alternation();
+            if(atEnd() || peek() != ')') {
+                error("')' expected");
+            }
+            ++m_pos;
+            return r;
+        }
+        case '[':
+            ++m_pos;
+            return Regex::chars(bracket());
+        case '.':
+            ++m_pos;
+            return Regex::chars(~charSet('\n'));
+        case '\\': {
+            ++m_pos;
+            CharSet set = escape(false);
+            return Regex::chars(m_caseInsensitive ? foldCase(set) : set);
+        }
+        case '^': case '$':
+            error("anchors are not supported");
+        case '*': case '+': case '?': case '{':
+            error("nothing to repeat");
+        default: {
+            const int symbol = take();
+            CharSet set = charSet(symbol);
+            return Regex::chars(m_caseInsensitive ? foldCase(set) : set);
+        }
+        }
+    }
+
+    const std::string &m_p;
+    const bool m_caseInsensitive;
+    std::size_t m_pos {0};
+};
+
+//
+// NFA
+//
+
+struct Nfa
+{
+    struct State
+    {
+        std::vector<std::pair<const CharSet *, int>> edges;
+        std::vector<int> epsilons;
+        int accept {-1};
+    };
+
+    struct Fragment
+    {
+        int start;
+        int end;
+    };
+
+    std::vector<State> states;
+
+    int add() {
+        states.emplace_back();
+        return static_cast<int>(states.size()) - 1;
+    }
+
+    Fragment build(const Regex &r) {
+        switch(r.kind) {
+        case Regex::Set: {
+            Fragment f {add(), add()};
+            states[f.start].edges.emplace_back(&r.set, f.end);
+            return f;
+        }
+        case Regex::Concat: {
+            Fragment f = build(*r.items.front());
+            for(std::size_t i = 1; i < r.items.size(); ++i) {
+                const Fragment next = build(*r.items[i]);
+                states[f.end].epsilons.push_back(next.start);
+                f.end = next.end;
+            }
+            return f;
+        }
+        case Regex::Alternation: {
+            Fragment f {add(), add()};
+            for(const RegexPtr &item : r.items) {
+                const Fragment branch = build(*item);
+                states[f.start].epsilons.push_back(branch.start);
+                states[branch.end].epsilons.push_back(f.end);
+            }
+            return f;
+        }
+        case Regex::Repeat: {
+            Fragment f {add(), -1};
+            f.end = f.start;
+            // mandatory copies
+            for(int i = 0; i < r.min; ++i) {
+                const Fragment copy = build(*r.items.front());
+                states[f.end].epsilons.push_back(copy.start);
+                f.end = copy.end;
+            }
+            if(r.max < 0) {
+                // loop
+                const Fragment loop = build(*r.items.front());
+                const int end = add();
+                states[f.end].epsilons.push_back(loop.start);
+                states[f.end].epsilons.push_back(end);
+                states[loop.end].epsilons.push_back(loop.start);
+                states[loop.end].epsilons.push_back(end);
+                f.end = end;
+            } else {
+                // optional copies
+                const int end = add();
+                for(int i = r.min; i < r.max; ++i) {
+                    const Fragment copy = build(*r.items.front());
+                    states[f.end].epsilons.push_back(copy.start);
+                    states[f.end].epsilons.push_back(end);
+                    f.end = copy.end;
+                }
+                states[f.end].epsilons.push_back(end);
+                f.end = end;
+            }
+            return f;
+        }
+        }
+        throw std::logic_error("bad regex kind");
+    }
+
+    void closure(std::vector<int> &set) const {
+        std::vector<bool> seen(states.size());
+        std::vector<int> stack(set);
+        for(int s : set) {
+            seen[s] = true;
+        }
+        while(!stack.empty()) {
+            const int s = stack.back();
+            stack.pop_back();
+            for(int t : states[s].epsilons) {
+                if(!seen[t]) {
+                    seen[t] = true;
+                    set.push_back(t);
+                    stack.push_back(t);
+                }
+            }
+        }
+        std::sort(set.begin(), set.end());
+    }
+};
+
+void collectSets(const Regex &r, std::vector<const CharSet *> &sets)
+{
+    if(r.kind == Regex::Set) {
+        sets.push_back(&r.set);
+    }
+    for(const RegexPtr &item : r.items) {
+        collectSets(*item, sets);
+    }
+}
+
+// Moore partition refinement, keeps dead state 0 and start state 1 in place
+Dfa minimize(const Dfa &dfa)
+{
+    const int n = dfa.stateCount();
+    std::vector<int> block(n);
+    {
+        std::map<std::pair<int, int>, int> initial;
+        // dead state gets it's own block
+        initial[{-2, -2}] = 0;
+        for(int s = 0; s < n; ++s) {
+            const std::pair<int, int> key = s == 0 ? std::make_pair(-2, -2)
+                                                   : std::make_pair(dfa.accepts[s], dfa.fallbacks[s]);
+            auto it = initial.emplace(key, static_cast<int>(initial.size())).first;
+            block[s] = it->second;
+        }
+    }
+
+    for(;;) {
+        std::map<std::vector<int>, int> signatures;
+        std::vector<int> next(n);
+        for(int s = 0; s < n; ++s) {
+            std::vector<int> signature {block[s]};
+            for(int c = 0; c < dfa.classCount; ++c) {
+                signature.push_back(block[dfa.transitions[s * dfa.classCount + c]]);
+            }
+            auto it = signatures.emplace(signature, static_cast<int>(signatures.size())).first;
+            next[s] = it->second;
+        }
+        const bool stable = signatures.size() == static_cast<std::size_t>(
+                    *std::max_element(block.begin(), block.end()) + 1);
+        block.swap(next);
+        if(stable) {
+            break;
+        }
+    }
+
+    // renumber: dead state and start state first, then in order of appearance
+    std::vector<int> number(n, -1);
+    std::vector<int> representative;
+    for(int s : {0, 1}) {
+        if(number[block[s]] < 0) {
+            number[block[s]] = static_cast<int>(representative.size());
+            representative.push_back(s);
+        }
+    }
+    for(int s = 0; s < n; ++s) {
+        if(number[block[s]] < 0) {
+            number[block[s]] = static_cast<int>(representative.size());
+            representative.push_back(s);
+        }
+    }
+
+    Dfa out;
+    out.classCount = dfa.classCount;
+    for(int s : representative) {
+        out.accepts.push_back(dfa.accepts[s]);
+        out.fallbacks.push_back(dfa.fallbacks[s]);
+        for(int c = 0; c < dfa.classCount; ++c) {
+            out.transitions.push_back(number[block[dfa.transitions[s * dfa.classCount + c]]]);
+        }
+    }
+    return out;
+}
+
+} // namespace
+
+//
+// REGEX
+//
+
+RegexPtr Regex::literal(const std::string &s, bool caseInsensitive)
+{
+    std::vector<RegexPtr> items;
+    for(std::size_t i = 0; i < s.size(); ++i) {
+        const unsigned char c = static_cast<unsigned char>(s[i]);
+        if(c >= 0x80) {
+            while(i + 1 < s.size() && (static_cast<unsigned char>(s[i + 1]) & 0xC0) == 0x80) {
+                ++i;
+            }
+            items.push_back(chars(charSet(NonAscii)));
+        } else {
+            items.push_back(chars(caseInsensitive ? foldCase(charSet(c)) : charSet(c)));
+        }
+    }
+    if(items.empty()) {
+        throw std::runtime_error("empty string");
+    }
+    return concat(std::move(items));
+}
+
+RegexPtr Regex::chars(const CharSet &set)
+{
+    auto r = std::make_shared<Regex>();
+    r->kind = Set;
+    r->set = set;
+    return r;
+}
+
+RegexPtr Regex::concat(std::vector<RegexPtr> items)
+{
+    if(items.size() == 1) {
+        return items.front();
+    }
+    auto r = std::make_shared<Regex>();
+    r->kind = Concat;
+    r->items = std::move(items);
+    return r;
+}
+
+RegexPtr Regex::repeat(RegexPtr item, int min, int max)
+{
+    auto r = std::make_shared<Regex>();
+    r->kind = Repeat;
+    r->items.push_back(std::move(item));
+    r->min = min;
+    r->max = max;
+    return r;
+}
+
+RegexPtr parseRegex(const std::string &pattern, bool caseInsensitive)
+{
+    return RegexParser(pattern, caseInsensitive).parse();
+}
+
+CharSet wordChars()
+{
+    CharSet set = range('a', 'z') | range('A', 'Z') | digitChars();
+    set.set('_');
+    set.set(NonAscii);
+    return set;
+}
+
+CharSet digitChars()
+{
+    return range('0', '9');
+}
+
+//
+// DFA
+//
+
+std::vector<int> symbolClasses(const std::vector<RegexPtr> &regexes, int &classCount)
+{
+    std::vector<const CharSet *> sets;
+    for(const RegexPtr &r : regexes) {
+        collectSets(*r, sets);
+    }
+
+    std::map<std::vector<bool>, int> signatures;
+    std::vector<int> classes(AlphabetSize);
+    for(int c = 0; c < AlphabetSize; ++c) {
+        std::vector<bool> signature;
+        signature.reserve(sets.size());
+        for(const CharSet *set : sets) {
+            signature.push_back(set->test(c));
+        }
+        auto it = signatures.emplace(signature, static_cast<int>(signatures.size())).first;
+        classes[c] = it->second;
+    }
+    classCount = static_cast<int>(signatures.size());
+    return classes;
+}
+
+Dfa buildDfa(const std::vector<Pattern> &patterns, const std::vector<int> &classes, int classCount)
+{
+    Nfa nfa;
+    const int start = nfa.add();
+    for(std::size_t i = 0; i < patterns.size(); ++i) {
+        const Nfa::Fragment f = nfa.build(*patterns[i].regex);
+        nfa.states[start].epsilons.push_back(f.start);
+        nfa.states[f.end].accept = static_cast<int>(i);
+    }
+
+    // any symbol of every class
+    std::vector<int> sample(classCount, -1);
+    for(int c = 0; c < AlphabetSize; ++c) {
+        if(sample[classes[c]] < 0) {
+            sample[classes[c]] = c;
+        }
+    }
+
+    Dfa dfa;
+    dfa.classCount = classCount;
+
+    std::map<std::vector<int>, int> index;
+    std::vector<std::vector<int>> sets;
+
+    auto addState = [&](std::vector<int> set) {
+        auto it = index.find(set);
+        if(it != index.end()) {
+            return it->second;
+        }
+        const int id = static_cast<int>(sets.size());
+        int accept = -1;
+        int fallback = -1;
+        for(int s : set) {
+            const int a = nfa.states[s].accept;
+            if(a < 0) {
+                continue;
+            }
+            if(accept < 0 || a < accept) {
+                accept = a;
+            }
+            if(!patterns[a].keyword && (fallback < 0 || a < fallback)) {
+                fallback = a;
+            }
+        }
+        index.emplace(set, id);
+        sets.push_back(std::move(set));
+        dfa.accepts.push_back(accept);
+        dfa.fallbacks.push_back(fallback);
+        dfa.transitions.resize(sets.size() * classCount, 0);
+        return id;
+    };
+
+    addState({}); // dead
+    std::vector<int> initial {start};
+    nfa.closure(initial);
+    addState(initial);
+    if(dfa.accepts[1] >= 0) {
+        throw std::runtime_error("rule " + std::to_string(dfa.accepts[1] + 1) + " matches empty string");
+    }
+
+    for(std::size_t s = 1; s < sets.size(); ++s) {
+        for(int c = 0; c < classCount; ++c) {
+            std::vector<int> target;
+            for(int state : sets[s]) {
+                for(const auto &edge : nfa.states[state].edges) {
+                    if(edge.first->test(sample[c])) {
+                        target.push_back(edge.second);
+                    }
+                }
+            }
+            std::sort(target.begin(), target.end());
+            target.erase(std::unique(target.begin(), target.end()), target.end());
+            int next = 0;
+            if(!target.empty()) {
+                nfa.closure(target);
+                next = addState(std::move(target));
+            }
+            dfa.transitions[s * classCount + c] = next;
+        }
+    }
+
+    return minimize(dfa);
+}
+
+} // namespace grammarc
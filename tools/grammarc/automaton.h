@@ -0,0 +1,97 @@
+/*! @file
+ *
+ * Regular expressions over the grammar alphabet and their compilation
+ * into a deterministic automaton.
+ *
+ * The alphabet has 129 symbols: 128 ASCII code units and one symbol for
+ * every non-ASCII UTF-16 code unit. Non-ASCII is treated as a word
+ * character and is matched by `.` and negated sets.
+ */
+
+#ifndef GRAMMARC_AUTOMATON_H
+#define GRAMMARC_AUTOMATON_H
+
+#include <bitset>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace grammarc {
+
+constexpr int AlphabetSize = 129;
+constexpr int NonAscii = 128;
+
+using CharSet = std::bitset<AlphabetSize>;
+
+//! Regular expression syntax tree
+struct Regex
+{
+    enum Kind { Set, Concat, Alternation, Repeat };
+
+    Kind kind {Set};
+    CharSet set;                                //! for `Set`
+    std::vector<std::shared_ptr<Regex>> items;  //! for `Concat` and `Alternation`
+    int min {0};                                //! for `Repeat`
+    int max {-1};                               //! for `Repeat`, -1 is unbounded
+
+    static std::shared_ptr<Regex> literal(const std::string &s, bool caseInsensitive);
+    static std::shared_ptr<Regex> chars(const CharSet &set);
+    static std::shared_ptr<Regex> concat(std::vector<std::shared_ptr<Regex>> items);
+    static std::shared_ptr<Regex> repeat(std::shared_ptr<Regex> item, int min, int max);
+};
+
+using RegexPtr = std::shared_ptr<Regex>;
+
+/*!
+ * Parse regular expression subset:
+ * literals, `.`, `[...]` (ranges, negation, escapes), `(...)`, `(?:...)`,
+ * `|`, `*`, `+`, `?`, `{m}`, `{m,}`, `{m,n}` and escapes `\d \w \s \D \W \S
+ * \t \n \r \xHH`. Anchors, lookarounds and backreferences can not be
+ * expressed by a DFA and are rejected. Throws `std::runtime_error`.
+ */
+RegexPtr parseRegex(const std::string &pattern, bool caseInsensitive);
+
+CharSet wordChars();
+CharSet digitChars();
+
+//! Rule of a single automaton: a pattern and whether it is a keyword rule
+struct Pattern
+{
+    RegexPtr regex;
+    bool keyword {false};
+};
+
+/*!
+ * Deterministic automaton recognizing a set of patterns.
+ *
+ * State 0 is the dead state, state 1 is the start state. `accepts[s]` is the
+ * first pattern (in pattern order) which matches when the input ends in
+ * state `s`, -1 for none. `fallbacks[s]` is the first non-keyword pattern
+ * accepted in `s`, used when a keyword pattern matched a word which is
+ * not in it's list.
+ */
+struct Dfa
+{
+    int classCount {0};
+    std::vector<int> transitions; //! [state * classCount + class]
+    std::vector<int> accepts;
+    std::vector<int> fallbacks;
+
+    int stateCount() const { return static_cast<int>(accepts.size()); }
+};
+
+/*!
+ * Split the alphabet into classes of symbols which no set of `regexes`
+ * distinguishes. Returns class of every symbol.
+ */
+std::vector<int> symbolClasses(const std::vector<RegexPtr> &regexes, int &classCount);
+
+/*!
+ * Build minimal DFA for `patterns` over symbol classes `classes`.
+ * Throws `std::runtime_error` if a pattern matches the empty string.
+ */
+Dfa buildDfa(const std::vector<Pattern> &patterns, const std::vector<int> &classes, int classCount);
+
+} // namespace grammarc
+
+#endif // GRAMMARC_AUTOMATON_H
@@ -0,0 +1,497 @@
+#include "grammar.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <set>
+#include <stdexcept>
+
+namespace grammarc {
+
+namespace {
+
+[[noreturn]] void error(int line, const std::string &what)
+{
+    throw std::runtime_error("line " + std::to_string(line) + ": " + what);
+}
+
+bool isTrue(const std::string &value)
+{
+    return value == "1" || value == "true";
+}
+
+const XmlElement *child(const XmlElement &e, const std::string &name)
+{
+    for(const XmlElement &c : e.children) {
+        if(c.name == name) {
+            return &c;
+        }
+    }
+    return nullptr;
+}
+
+void checkAttributes(const XmlElement &e, std::initializer_list<const char *> allowed)
+{
+    for(const auto &a : e.attributes) {
+        if(std::find_if(allowed.begin(), allowed.end(),
+                        [&](const char *name) { return a.first == name; }) == allowed.end()) {
+            error(e.line, "unsupported attribute " + a.first + " of <" + e.name + ">");
+        }
+    }
+}
+
+std::string required(const XmlElement &e, const std::string &name)
+{
+    const std::string *value = e.attribute(name);
+    if(!value || value->empty()) {
+        error(e.line, "<" + e.name + "> requires attribute " + name);
+    }
+    return *value;
+}
+
+std::string trim(const std::string &s)
+{
+    const auto begin = s.find_first_not_of(" \t\r\n");
+    if(begin == std::string::npos) {
+        return std::string();
+    }
+    const auto end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+// `char` attribute: exactly one (possibly multi-byte) character
+std::string character(const XmlElement &e, const std::string &name)
+{
+    const std::string value = required(e, name);
+    std::size_t length = 1;
+    while(length < value.size() && (static_cast<unsigned char>(value[length]) & 0xC0) == 0x80) {
+        ++length;
+    }
+    if(length != value.size()) {
+        error(e.line, "attribute " + name + " must be a single character");
+    }
+    return value;
+}
+
+// Kate default style name to `Dfa::Style` enumerator
+std::string styleName(const XmlElement &e)
+{
+    static const std::set<std::string> styles {
+        "Normal", "Keyword", "ControlFlow", "Operator", "BuiltIn", "Variable",
+        "Extension", "Preprocessor", "Attribute", "DataType", "DecVal", "BaseN",
+        "Float", "Constant", "Char", "SpecialChar", "String", "VerbatimString",
+        "SpecialString", "Import", "Comment", "Documentation", "Annotation",
+        "CommentVar", "RegionMarker", "Information", "Warning", "Alert",
+        "Function", "Others", "Error"
+    };
+
+    const std::string value = required(e, "defStyleNum");
+    if(value.compare(0, 2, "ds") != 0 || !styles.count(value.substr(2))) {
+        error(e.line, "unknown default style " + value);
+    }
+    return value.substr(2);
+}
+
+class Loader
+{
+public:
+    explicit Loader(Grammar &g)
+        : m_g(g)
+    {}
+
+    void load(const XmlElement &language) {
+        if(language.name != "language") {
+            error(language.line, "<language> expected");
+        }
+        m_g.name = required(language, "name");
+        m_g.syntax = required(language, "syntax");
+        for(char c : m_g.syntax) {
+            m_g.id += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+        m_g.id += "Grammar";
+
+        const XmlElement *highlighting = child(language, "highlighting");
+        if(!highlighting) {
+            error(language.line, "<highlighting> expected");
+        }
+
+        if(const XmlElement *general = child(language, "general")) {
+            if(const XmlElement *keywords = child(*general, "keywords")) {
+                checkAttributes(*keywords, {"casesensitive", "weakDeliminator"});
+                m_g.caseSensitive = isTrue(keywords->attribute("casesensitive", "1"));
+                m_weakDeliminators = keywords->attribute("weakDeliminator", "");
+            }
+        }
+
+        // names first: rules reference lists, contexts and attributes
+        for(const XmlElement &e : highlighting->children) {
+            if(e.name == "list") {
+                loadList(e);
+            }
+        }
+        const XmlElement *itemDatas = child(*highlighting, "itemDatas");
+        if(!itemDatas) {
+            error(highlighting->line, "<itemDatas> expected");
+        }
+        for(const XmlElement &e : itemDatas->children) {
+            Attribute a;
+            a.name = required(e, "name");
+            a.style = styleName(e);
+            if(m_attributes.count(a.name)) {
+                error(e.line, "duplicated itemData " + a.name);
+            }
+            m_attributes[a.name] = static_cast<int>(m_g.attributes.size());
+            m_g.attributes.push_back(a);
+        }
+
+        const XmlElement *contexts = child(*highlighting, "contexts");
+        if(!contexts || contexts->children.empty()) {
+            error(highlighting->line, "<contexts> expected");
+        }
+        for(const XmlElement &e : contexts->children) {
+            checkAttributes(e, {"name", "attribute", "lineEndContext"});
+            Context c;
+            c.name = required(e, "name");
+            c.attribute = attribute(e, required(e, "attribute"));
+            c.lineEndContext = e.attribute("lineEndContext", "#stay");
+            c.line = e.line;
+            if(m_contexts.count(c.name)) {
+                error(e.line, "duplicated context " + c.name);
+            }
+            m_contexts[c.name] = static_cast<int>(m_g.contexts.size());
+            m_g.contexts.push_back(c);
+        }
+        if(m_g.contexts.size() > 255) {
+            error(contexts->line, "too many contexts");
+        }
+
+        for(std::size_t i = 0; i < m_g.contexts.size(); ++i) {
+            Context &c = m_g.contexts[i];
+            c.lineEnd = action(c.line, c.lineEndContext);
+            for(const XmlElement &e : contexts->children[i].children) {
+                c.rules.push_back(rule(e, c));
+            }
+        }
+
+        for(const KeywordList &list : m_g.lists) {
+            if(!list.used) {
+                error(list.line, "keyword list " + list.name + " is not used");
+            }
+        }
+
+        compile();
+    }
+
+private:
+    void loadList(const XmlElement &e) {
+        KeywordList list;
+        list.name = required(e, "name");
+        list.line = e.line;
+
+        std::set<std::string> seen;
+        for(const XmlElement &item : e.children) {
+            if(item.name != "item") {
+                error(item.line, "<item> expected");
+            }
+            std::string word = trim(item.text);
+            if(word.empty()) {
+                error(item.line, "empty keyword");
+            }
+            std::string key;
+            for(char c : word) {
+                if(static_cast<unsigned char>(c) >= 0x80) {
+                    error(item.line, "keyword " + word + " is not ASCII");
+                }
+                key += m_g.caseSensitive ? c : static_cast<char>(std::tolower(c));
+            }
+            if(!seen.insert(key).second) {
+                error(item.line, "duplicated keyword " + word);
+            }
+            list.items.push_back(word);
+        }
+        if(list.items.empty()) {
+            error(e.line, "keyword list " + list.name + " is empty");
+        }
+        if(m_lists.count(list.name)) {
+            error(e.line, "duplicated list " + list.name);
+        }
+        m_lists[list.name] = static_cast<int>(m_g.lists.size());
+        m_g.lists.push_back(list);
+    }
+
+    int attribute(const XmlElement &e, const std::string &name) const {
+        auto it = m_attributes.find(name);
+        if(it == m_attributes.end()) {
+            error(e.line, "unknown itemData " + name);
+        }
+        return it->second;
+    }
+
+    // "#stay", "#pop#pop", "#pop!Name" or "Name"
+    Action action(int line, const std::string &spec) const {
+        Action a;
+        if(spec == "#stay") {
+            return a;
+        }
+        std::size_t pos = 0;
+        while(spec.compare(pos, 4, "#pop") == 0) {
+            ++a.pops;
+            pos += 4;
+        }
+        if(pos == spec.size()) {
+            return a;
+        }
+        if(a.pops > 0) {
+            if(spec[pos] != '!') {
+                error(line, "bad context switch " + spec);
+            }
+            ++pos;
+        }
+        auto it = m_contexts.find(spec.substr(pos));
+        if(it == m_contexts.end()) {
+            error(line, "unknown context " + spec.substr(pos));
+        }
+        a.push = it->second;
+        return a;
+    }
+
+    RegexPtr keywordRegex() const {
+        CharSet weak;
+        for(char c : m_weakDeliminators) {
+            weak.set(static_cast<unsigned char>(c) < 0x80 ? static_cast<unsigned char>(c) : NonAscii);
+        }
+        const CharSet tail = wordChars() | weak;
+        const CharSet head = tail & ~digitChars();
+        return Regex::concat({Regex::chars(head), Regex::repeat(Regex::chars(tail), 0, -1)});
+    }
+
+    Rule rule(const XmlElement &e, const Context &context) {
+        Rule r;
+        r.line = e.line;
+        r.attribute = e.attribute("attribute") ? attribute(e, *e.attribute("attribute")) : context.attribute;
+        r.action = action(e.line, e.attribute("context", "#stay"));
+
+        const bool insensitive = isTrue(e.attribute("insensitive", "0"));
+        auto parse = [&](const std::string &pattern) {
+            try {
+                return parseRegex(pattern, insensitive);
+            } catch(const std::exception &ex) {
+                error(e.line, ex.what());
+            }
+        };
+        auto literal = [&](const std::string &s) {
+            return Regex::literal(s, insensitive);
+        };
+
+        const std::string &n = e.name;
+        if(n == "DetectChar") {
+            checkAttributes(e, {"attribute", "context", "char", "beginRegion", "endRegion"});
+            r.regex = literal(character(e, "char"));
+        } else if(n == "Detect2Chars") {
+            checkAttributes(e, {"attribute", "context", "char", "char1", "beginRegion", "endRegion"});
+            r.regex = literal(character(e, "char") + character(e, "char1"));
+        } else if(n == "AnyChar") {
+            checkAttributes(e, {"attribute", "context", "String"});
+            CharSet set;
+            for(const auto &c : required(e, "String")) {
+                set.set(static_cast<unsigned char>(c) < 0x80 ? static_cast<unsigned char>(c) : NonAscii);
+            }
+            r.regex = Regex::chars(set);
+        } else if(n == "StringDetect" || n == "WordDetect") {
+            checkAttributes(e, {"attribute", "context", "String", "insensitive", "beginRegion", "endRegion"});
+            r.regex = literal(required(e, "String"));
+        } else if(n == "RangeDetect") {
+            checkAttributes(e, {"attribute", "context", "char", "char1"});
+            const std::string open = character(e, "char");
+            const std::string close = character(e, "char1");
+            RegexPtr closeRegex = literal(close);
+            CharSet body = ~closeRegex->set;
+            body.reset('\n');
+            r.regex = Regex::concat({literal(open), Regex::repeat(Regex::chars(body), 0, -1), closeRegex});
+        } else if(n == "RegExpr") {
+            checkAttributes(e, {"attribute", "context", "String", "insensitive", "beginRegion", "endRegion"});
+            r.regex = parse(required(e, "String"));
+        } else if(n == "keyword") {
+            checkAttributes(e, {"attribute", "context", "String"});
+            auto it = m_lists.find(required(e, "String"));
+            if(it == m_lists.end()) {
+                error(e.line, "unknown keyword list " + required(e, "String"));
+            }
+            m_g.lists[it->second].used = true;
+            r.keywords = it->second;
+            r.regex = keywordRegex();
+        } else if(n == "Int") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("[0-9]+");
+        } else if(n == "Float") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("([0-9]+\\.[0-9]*|\\.[0-9]+)([eE][-+]?[0-9]+)?|[0-9]+[eE][-+]?[0-9]+");
+        } else if(n == "HlCHex") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("0[xX][0-9A-Fa-f]+");
+        } else if(n == "HlCOct") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("0[0-7]+");
+        } else if(n == "HlCStringChar") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("\\\\([abefnrtv\"'?\\\\]|x[0-9A-Fa-f]{1,4}|[0-7]{1,3})");
+        } else if(n == "HlCChar") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("'([^'\\\\\\n]|\\\\([abefnrtv\"'?\\\\]|x[0-9A-Fa-f]{1,4}|[0-7]{1,3}))'");
+        } else if(n == "DetectSpaces") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("[ \\t]+");
+        } else if(n == "DetectIdentifier") {
+            checkAttributes(e, {"attribute", "context"});
+            r.regex = parse("[a-zA-Z_\\x80][a-zA-Z0-9_\\x80]*");
+        } else {
+            error(e.line, "unsupported rule <" + n + ">");
+        }
+        return r;
+    }
+
+    void compile() {
+        std::vector<RegexPtr> regexes;
+        for(const Context &c : m_g.contexts) {
+            for(const Rule &r : c.rules) {
+                regexes.push_back(r.regex);
+            }
+        }
+        m_g.classes = symbolClasses(regexes, m_g.classCount);
+
+        for(Context &c : m_g.contexts) {
+            std::vector<Pattern> patterns;
+            for(const Rule &r : c.rules) {
+                patterns.push_back({r.regex, r.keywords >= 0});
+            }
+            try {
+                c.dfa = buildDfa(patterns, m_g.classes, m_g.classCount);
+            } catch(const std::exception &ex) {
+                error(c.line, "context " + c.name + ": " + ex.what());
+            }
+            if(c.dfa.stateCount() > 0xFFFF) {
+                error(c.line, "context " + c.name + " is too big");
+            }
+        }
+    }
+
+    Grammar &m_g;
+    std::string m_weakDeliminators;
+    std::map<std::string, int> m_lists;
+    std::map<std::string, int> m_contexts;
+    std::map<std::string, int> m_attributes;
+};
+
+std::string quoted(const std::string &s)
+{
+    std::string out = "\"";
+    for(char c : s) {
+        if(c == '"' || c == '\\') {
+            out += '\\';
+        }
+        out += c;
+    }
+    return out + '"';
+}
+
+template<class Container>
+void writeArray(std::ostream &out, const char *type, const std::string &name, const Container &values)
+{
+    out << "const " << type << ' ' << name << "[] = {";
+    int column = 0;
+    for(auto value : values) {
+        if(column++ % 20 == 0) {
+            out << "\n   ";
+        }
+        out << ' ' << value << ',';
+    }
+    out << "\n};\n";
+}
+
+} // namespace
+
+Grammar loadGrammar(const XmlElement &language)
+{
+    Grammar g;
+    Loader(g).load(language);
+    return g;
+}
+
+void writeGrammar(std::ostream &out, const Grammar &g)
+{
+    out << "namespace " << g.id << " {\n\n";
+
+    for(std::size_t i = 0; i < g.lists.size(); ++i) {
+        out << "// " << g.lists[i].name << "\n"
+            << "constexpr auto list" << i << " = makeKeywordTable({";
+        int column = 0;
+        for(const std::string &word : g.lists[i].items) {
+            out << (column++ % 8 == 0 ? "\n    " : " ") << quoted(word) << ',';
+        }
+        out << "\n}" << (g.caseSensitive ? "" : ", Qt::CaseInsensitive") << ");\n\n";
+    }
+
+    writeArray(out, "quint8", "classes", g.classes);
+    out << '\n';
+
+    for(std::size_t i = 0; i < g.contexts.size(); ++i) {
+        const Context &c = g.contexts[i];
+        const std::string prefix = "context" + std::to_string(i);
+        out << "// " << c.name << "\n";
+        writeArray(out, "quint16", prefix + "Transitions", c.dfa.transitions);
+        writeArray(out, "qint16", prefix + "Accepts", c.dfa.accepts);
+        writeArray(out, "qint16", prefix + "Fallbacks", c.dfa.fallbacks);
+        if(!c.rules.empty()) {
+            out << "const Dfa::Rule " << prefix << "Rules[] = {\n";
+            for(std::size_t r = 0; r < c.rules.size(); ++r) {
+                int nextKeyword = -1;
+                for(std::size_t k = r + 1; k < c.rules.size() && nextKeyword < 0; ++k) {
+                    if(c.rules[k].keywords >= 0) {
+                        nextKeyword = static_cast<int>(k);
+                    }
+                }
+                const Rule &rule = c.rules[r];
+                out << "    {" << rule.attribute << ", " << rule.keywords << ", " << nextKeyword << ", {"
+                    << rule.action.pops << ", " << rule.action.push << "}},\n";
+            }
+            out << "};\n";
+        }
+        out << '\n';
+    }
+
+    out << "const Dfa::Context contexts[] = {\n";
+    for(std::size_t i = 0; i < g.contexts.size(); ++i) {
+        const Context &c = g.contexts[i];
+        const std::string prefix = "context" + std::to_string(i);
+        out << "    {" << prefix << "Transitions, " << prefix << "Accepts, " << prefix << "Fallbacks, "
+            << (c.rules.empty() ? std::string("nullptr") : prefix + "Rules") << ", "
+            << c.attribute << ", {" << c.lineEnd.pops << ", " << c.lineEnd.push << "}},\n";
+    }
+    out << "};\n\n";
+
+    if(!g.lists.empty()) {
+        out << "const KeywordSet lists[] = {";
+        for(std::size_t i = 0; i < g.lists.size(); ++i) {
+            out << (i ? ", " : "") << "list" << i;
+        }
+        out << "};\n";
+    }
+
+    out << "const Dfa::Style styles[] = {\n";
+    for(const Attribute &a : g.attributes) {
+        out << "    Dfa::Style::" << a.style << ", // " << a.name << "\n";
+    }
+    out << "};\n\n";
+
+    out << "const Dfa::Grammar grammar {\n"
+        << "    " << quoted(g.name) << ",\n"
+        << "    classes, " << g.classCount << ",\n"
+        << "    contexts, " << g.contexts.size() << ",\n"
+        << "    " << (g.lists.empty() ? "nullptr" : "lists") << ",\n"
+        << "    styles, " << g.attributes.size() << "\n"
+        << "};\n\n";
+
+    out << "} // namespace " << g.id << "\n\n";
+}
+
+} // namespace grammarc
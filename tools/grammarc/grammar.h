@@ -0,0 +1,84 @@
+/*! @file
+ *
+ * Grammar model loaded from a Kate-style (KSyntaxHighlighting) XML
+ * definition and it's C++ code generator.
+ */
+
+#ifndef GRAMMARC_GRAMMAR_H
+#define GRAMMARC_GRAMMAR_H
+
+#include "automaton.h"
+#include "xml.h"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace grammarc {
+
+//! What happens with the context stack after a match
+struct Action
+{
+    int pops {0};
+    int push {-1};
+};
+
+struct Rule
+{
+    RegexPtr regex;
+    int keywords {-1};  //! index of keyword list for `keyword` rules
+    int attribute {0};
+    Action action;
+    std::string context; //! unresolved action
+    int line {0};
+};
+
+struct Context
+{
+    std::string name;
+    int attribute {0};
+    Action lineEnd;
+    std::string lineEndContext; //! unresolved action
+    std::vector<Rule> rules;
+    Dfa dfa;
+    int line {0};
+};
+
+struct KeywordList
+{
+    std::string name;
+    std::vector<std::string> items;
+    bool used {false};
+    int line {0};
+};
+
+struct Attribute
+{
+    std::string name;
+    std::string style; //! `Dfa::Style` enumerator
+};
+
+struct Grammar
+{
+    std::string name;     //! Human readable language name
+    std::string syntax;   //! `Syntax::t` enumerator handled by this grammar
+    std::string id;       //! C++ namespace of tables, derived from `syntax`
+    bool caseSensitive {true};
+
+    std::vector<KeywordList> lists;
+    std::vector<Context> contexts;
+    std::vector<Attribute> attributes;
+
+    std::vector<int> classes; //! symbol class of every alphabet symbol
+    int classCount {0};
+};
+
+/*! Load and compile grammar. Throws `std::runtime_error`. */
+Grammar loadGrammar(const XmlElement &language);
+
+/*! Write tables of `grammar` as C++ definitions. */
+void writeGrammar(std::ostream &out, const Grammar &grammar);
+
+} // namespace grammarc
+
+#endif // GRAMMARC_GRAMMAR_H
@@ -0,0 +1,18 @@
+include( ../../common.pri )
+
+# host tool: compiles texteditor/grammars/*.xml into DFA tables
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= qt app_bundle
+
+TARGET = grammarc
+DESTDIR = $${ASKELIBQT_BIN_PATH}
+
+SOURCES += main.cpp \
+    xml.cpp \
+    automaton.cpp \
+    grammar.cpp
+
+HEADERS += xml.h \
+    automaton.h \
+    grammar.h
@@ -0,0 +1,108 @@
+/*! @file
+ *
+ * grammarc compiles syntax definitions into DFA tables.
+ *
+ * Usage: `grammarc <output.cpp> <grammar.xml>...`
+ *
+ * Every grammar is a subset of KSyntaxHighlighting XML format with an
+ * additional `syntax` attribute of `<language>` naming the `Syntax::t`
+ * enumerator it handles. Output defines tables of all grammars and
+ * `Syntax::dfaGrammar()`. The output file is rewritten only if it's
+ * content changes.
+ */
+
+#include "grammar.h"
+#include "xml.h"
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+using namespace grammarc;
+
+namespace {
+
+std::string readFile(const std::string &fileName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    if(!in) {
+        throw std::runtime_error("can not open file");
+    }
+    std::ostringstream s;
+    s << in.rdbuf();
+    return s.str();
+}
+
+std::string baseName(const std::string &path)
+{
+    const auto slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? path : path.substr(slash + 1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    if(argc < 3) {
+        std::cerr << "usage: grammarc <output.cpp> <grammar.xml>..." << std::endl;
+        return 2;
+    }
+
+    std::ostringstream out;
+    out << "// Generated by grammarc. Do not edit.\n\n"
+        << "#include \"texteditor/highlighters/dfa.h\"\n"
+        << "#include \"texteditor/highlighters/keywords.h\"\n"
+        << "#include \"texteditor/syntax.h\"\n\n"
+        << "namespace aske {\n\n"
+        << "namespace {\n\n";
+
+    std::vector<Grammar> grammars;
+    std::set<std::string> syntaxes;
+    for(int i = 2; i < argc; ++i) {
+        const std::string fileName = argv[i];
+        try {
+            grammars.push_back(loadGrammar(parseXml(readFile(fileName))));
+            if(!syntaxes.insert(grammars.back().syntax).second) {
+                throw std::runtime_error("syntax " + grammars.back().syntax + " is already defined");
+            }
+        } catch(const std::exception &ex) {
+            std::cerr << fileName << ": error: " << ex.what() << std::endl;
+            return 1;
+        }
+
+        out << "//\n// " << grammars.back().name << ", " << baseName(fileName) << "\n//\n\n";
+        writeGrammar(out, grammars.back());
+    }
+
+    out << "} // namespace\n\n"
+        << "namespace TextEditorPrivate {\n\n"
+        << "const Dfa::Grammar *Syntax::dfaGrammar(Syntax::t syntax)\n"
+        << "{\n"
+        << "    switch(syntax) {\n";
+    for(const Grammar &g : grammars) {
+        out << "    case Syntax::" << g.syntax << ": return &" << g.id << "::grammar;\n";
+    }
+    out << "    default: return nullptr;\n"
+        << "    }\n"
+        << "}\n\n"
+        << "} // namespace TextEditorPrivate\n\n"
+        << "} // namespace aske\n";
+
+    const std::string output = argv[1];
+    const std::string content = out.str();
+    try {
+        if(readFile(output) == content) {
+            return 0;
+        }
+    } catch(const std::exception &) {
+    }
+
+    std::ofstream file(output, std::ios::binary | std::ios::trunc);
+    file << content;
+    if(!file) {
+        std::cerr << output << ": error: can not write file" << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,261 @@
+#include "xml.h"
+
+#include <stdexcept>
+
+namespace grammarc {
+
+const std::string *XmlElement::attribute(const std::string &attributeName) const
+{
+    for(const auto &a : attributes) {
+        if(a.first == attributeName) {
+            return &a.second;
+        }
+    }
+    return nullptr;
+}
+
+std::string XmlElement::attribute(const std::string &attributeName, const std::string &defaultValue) const
+{
+    const std::string *value = attribute(attributeName);
+    return value ? *value : defaultValue;
+}
+
+namespace {
+
+class Parser
+{
+public:
+    explicit Parser(const std::string &source)
+        : m_s(source)
+    {}
+
+    XmlElement document() {
+        skipMisc();
+        if(!lookingAt("<")) {
+            error("root element expected");
+        }
+        XmlElement root = element();
+        skipMisc();
+        if(m_pos != m_s.size()) {
+            error("garbage after root element");
+        }
+        return root;
+    }
+
+private:
+    [[noreturn]] void error(const std::string &what) const {
+        throw std::runtime_error("line " + std::to_string(m_line) + ": " + what);
+    }
+
+    bool lookingAt(const char *token) const {
+        return m_s.compare(m_pos, std::char_traits<char>::length(token), token) == 0;
+    }
+
+    void advance(std::size_t n = 1) {
+        for(std::size_t i = 0; i < n && m_pos < m_s.size(); ++i) {
+            if(m_s[m_pos++] == '\n') {
+                ++m_line;
+            }
+        }
+    }
+
+    void skipUntil(const char *token) {
+        while(m_pos < m_s.size() && !lookingAt(token)) {
+            advance();
+        }
+        if(m_pos == m_s.size()) {
+            error(std::string("'") + token + "' expected");
+        }
+        advance(std::char_traits<char>::length(token));
+    }
+
+    void skipSpaces() {
+        while(m_pos < m_s.size() && isSpace(m_s[m_pos])) {
+            advance();
+        }
+    }
+
+    // whitespace, comments, processing instructions and doctype
+    void skipMisc() {
+        for(;;) {
+            skipSpaces();
+            if(lookingAt("<!--")) {
+                skipUntil("-->");
+            } else if(lookingAt("<?")) {
+                skipUntil("?>");
+            } else if(lookingAt("<!DOCTYPE")) {
+                skipUntil(">");
+            } else {
+                return;
+            }
+        }
+    }
+
+    static bool isSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    }
+
+    static bool isNameChar(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')
+                || c == '_' || c == '-' || c == '.' || c == ':';
+    }
+
+    std::string name() {
+        const std::size_t begin = m_pos;
+        while(m_pos < m_s.size() && isNameChar(m_s[m_pos])) {
+            advance();
+        }
+        if(begin == m_pos) {
+            error("name expected");
+        }
+        return m_s.substr(begin, m_pos - begin);
+    }
+
+    static void appendUtf8(std::string &out, unsigned long cp) {
+        if(cp < 0x80) {
+            out += static_cast<char>(cp);
+        } else if(cp < 0x800) {
+            out += static_cast<char>(0xC0 | (cp >> 6));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else if(cp < 0x10000) {
+            out += static_cast<char>(0xE0 | (cp >> 12));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (cp >> 18));
+            out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // decodes text up to `terminator`
+    std::string characterData(char terminator) {
+        std::string out;
+        while(m_pos < m_s.size() && m_s[m_pos] != terminator) {
+            if(terminator == '<' && lookingAt("<![CDATA[")) {
+                advance(9);
+                const std::size_t end = m_s.find("]]>", m_pos);
+                if(end == std::string::npos) {
+                    error("unterminated CDATA section");
+                }
+                out += m_s.substr(m_pos, end - m_pos);
+                advance(end - m_pos + 3);
+                continue;
+            }
+
+            const char c = m_s[m_pos];
+            if(c != '&') {
+                out += c;
+                advance();
+                continue;
+            }
+
+            const std::size_t end = m_s.find(';', m_pos);
+            if(end == std::string::npos) {
+                error("unterminated entity");
+            }
+            const std::string entity = m_s.substr(m_pos + 1, end - m_pos - 1);
+            if(entity == "lt") {
+                out += '<';
+            } else if(entity == "gt") {
+                out += '>';
+            } else if(entity == "amp") {
+                out += '&';
+            } else if(entity == "quot") {
+                out += '"';
+            } else if(entity == "apos") {
+                out += '\'';
+            } else if(entity.size() > 1 && entity[0] == '#') {
+                const bool hex = entity[1] == 'x' || entity[1] == 'X';
+                appendUtf8(out, std::stoul(entity.substr(hex ? 2 : 1), nullptr, hex ? 16 : 10));
+            } else {
+                error("unknown entity &" + entity + ";");
+            }
+            advance(end - m_pos + 1);
+        }
+        return out;
+    }
+
+    XmlElement element() {
+        XmlElement e;
+        e.line = m_line;
+        advance(); // <
+        e.name = name();
+
+        for(;;) {
+            skipSpaces();
+            if(lookingAt("/>")) {
+                advance(2);
+                return e;
+            }
+            if(lookingAt(">")) {
+                advance();
+                break;
+            }
+
+            std::string attributeName = name();
+            skipSpaces();
+            if(!lookingAt("=")) {
+                error("'=' expected after attribute " + attributeName);
+            }
+            advance();
+            skipSpaces();
+            if(!lookingAt("\"") && !lookingAt("'")) {
+                error("quoted value expected for attribute " + attributeName);
+            }
+            const char quote = m_s[m_pos];
+            advance();
+            std::string value = characterData(quote);
+            if(m_pos == m_s.size()) {
+                error("unterminated attribute value");
+            }
+            advance();
+            e.attributes.emplace_back(std::move(attributeName), std::move(value));
+        }
+
+        // content
+        for(;;) {
+            if(m_pos == m_s.size()) {
+                error("unterminated element <" + e.name + ">");
+            }
+            if(lookingAt("</")) {
+                advance(2);
+                const std::string closing = name();
+                if(closing != e.name) {
+                    error("</" + e.name + "> expected, got </" + closing + ">");
+                }
+                skipSpaces();
+                if(!lookingAt(">")) {
+                    error("'>' expected");
+                }
+                advance();
+                return e;
+            }
+            if(lookingAt("<!--")) {
+                skipUntil("-->");
+            } else if(lookingAt("<?")) {
+                skipUntil("?>");
+            } else if(lookingAt("<![CDATA[")) {
+                e.text += characterData('<');
+            } else if(lookingAt("<")) {
+                e.children.push_back(element());
+            } else {
+                e.text += characterData('<');
+            }
+        }
+    }
+
+    const std::string &m_s;
+    std::size_t m_pos {0};
+    int m_line {1};
+};
+
+} // namespace
+
+XmlElement parseXml(const std::string &source)
+{
+    return Parser(source).document();
+}
+
+} // namespace grammarc
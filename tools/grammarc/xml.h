@@ -0,0 +1,38 @@
+/*! @file
+ *
+ * Minimal XML reader for grammar files.
+ *
+ * Supports elements, attributes, character data, comments, processing
+ * instructions and predefined/numeric entities. No DTDs, no namespaces.
+ */
+
+#ifndef GRAMMARC_XML_H
+#define GRAMMARC_XML_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace grammarc {
+
+struct XmlElement
+{
+    std::string name;
+    std::vector<std::pair<std::string, std::string>> attributes;
+    std::vector<XmlElement> children;
+    std::string text; //! Concatenated character data of the element
+    int line {0};
+
+    /*! Returns attribute value or `nullptr` if there is no such attribute. */
+    const std::string *attribute(const std::string &attributeName) const;
+
+    /*! Returns attribute value or `defaultValue` if there is no such attribute. */
+    std::string attribute(const std::string &attributeName, const std::string &defaultValue) const;
+};
+
+/*! Parse XML document. Throws `std::runtime_error` on malformed input. */
+XmlElement parseXml(const std::string &source);
+
+} // namespace grammarc
+
+#endif // GRAMMARC_XML_H
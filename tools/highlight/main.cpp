@@ -0,0 +1,160 @@
+/*! @file
+ *
+ * highlight renders source files with the text editor's highlighters
+ * without any widgets.
+ *
+ * Usage: `highlight [--ansi] [-o <dir>] [-j <threads>] <file-or-dir>...`
+ *
+ * Directories are walked recursively, files with unknown syntax are
+ * skipped. With `-o` every file is written as `<dir>/<relative path>.html`
+ * (or `.ansi`), otherwise output of every file is streamed to stdout as
+ * soon as it is ready. Throughput is reported to stderr.
+ */
+
+#include "texteditor/batchhighlighter.h"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+using namespace aske;
+using namespace aske::TextEditorPrivate;
+
+namespace {
+
+struct Input {
+    QString path;     //! File to read
+    QString relative; //! Path relative to the walked directory
+};
+
+std::vector<Input> collectInputs(const QStringList &paths)
+{
+    std::vector<Input> inputs;
+    for(const QString &path : paths) {
+        const QFileInfo info(path);
+        if(info.isFile()) {
+            inputs.push_back({path, info.fileName()});
+            continue;
+        }
+
+        const QDir root(path);
+        QDirIterator it(path, QDir::Files | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
+        while(it.hasNext()) {
+            const QString file = it.next();
+            inputs.push_back({file, root.relativeFilePath(file)});
+        }
+    }
+    return inputs;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Render source files with syntax highlighting.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("paths", "Files or directories to highlight.", "<file-or-dir>...");
+    const QCommandLineOption ansiOption("ansi", "Output terminal escape sequences instead of HTML.");
+    const QCommandLineOption outputOption({"o", "output"}, "Write every file into <dir> instead of stdout.", "dir");
+    const QCommandLineOption jobsOption({"j", "jobs"}, "Number of threads, all cores by default.", "threads");
+    parser.addOption(ansiOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.process(app);
+
+    if(parser.positionalArguments().isEmpty()) {
+        parser.showHelp(2);
+    }
+
+    const BatchHighlighter::Output output = parser.isSet(ansiOption) ? BatchHighlighter::Output::Ansi
+                                                                       : BatchHighlighter::Output::Html;
+    const QString outputDir = parser.value(outputOption);
+    const QString suffix = output == BatchHighlighter::Output::Html ? ".html" : ".ansi";
+
+    unsigned jobs = parser.isSet(jobsOption) ? parser.value(jobsOption).toUInt() : std::thread::hardware_concurrency();
+    if(jobs == 0) {
+        jobs = 1;
+    }
+
+    const std::vector<Input> inputs = collectInputs(parser.positionalArguments());
+
+    std::atomic<size_t> next {0};
+    std::atomic<qint64> files {0};
+    std::atomic<qint64> bytes {0};
+    std::mutex outMutex;
+    QFile out;
+    out.open(stdout, QIODevice::WriteOnly);
+
+    auto worker = [&] {
+        for(size_t i = next++; i < inputs.size(); i = next++) {
+            const Input &input = inputs[i];
+
+            QFile file(input.path);
+            if(!file.open(QIODevice::ReadOnly)) {
+                continue;
+            }
+            const QByteArray data = file.readAll();
+            const Syntax::t syntax = Syntax::fromFile(input.path, data.left(512));
+            if(syntax == Syntax::No) {
+                continue;
+            }
+
+            BatchHighlighter highlighter(syntax);
+            if(!highlighter.isValid()) {
+                continue;
+            }
+            const QByteArray rendered = highlighter.render(data, output);
+
+            if(outputDir.isEmpty()) {
+                std::lock_guard<std::mutex> lock(outMutex);
+                out.write(output == BatchHighlighter::Output::Html
+                          ? "<h3>" + input.relative.toUtf8() + "</h3>\n"
+                          : "==> " + input.relative.toUtf8() + " <==\n");
+                out.write(rendered);
+                out.flush();
+            } else {
+                const QString target = QDir(outputDir).filePath(input.relative + suffix);
+                QDir().mkpath(QFileInfo(target).path());
+                QFile result(target);
+                if(result.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+                    result.write(rendered);
+                }
+            }
+
+            ++files;
+            bytes += data.size();
+        }
+    };
+
+    QElapsedTimer timer;
+    timer.start();
+
+    std::vector<std::thread> threads;
+    for(unsigned i = 0; i < jobs; ++i) {
+        threads.emplace_back(worker);
+    }
+    for(std::thread &thread : threads) {
+        thread.join();
+    }
+
+    const double seconds = qMax<qint64>(timer.elapsed(), 1) / 1000.0;
+    const double megabytes = bytes / (1024.0 * 1024.0);
+    fprintf(stderr, "%lld files, %.2f MB in %.3f s: %.1f files/s, %.2f MB/s (%u threads)\n",
+            static_cast<long long>(files.load()), megabytes, seconds,
+            files / seconds, megabytes / seconds, jobs);
+
+    return 0;
+}
@@ -0,0 +1,22 @@
+include( ../../common.pri )
+include( ../../config.pri )
+
+# highlighter benchmark: lexing throughput, allocations and rehighlight time per language
+TEMPLATE = app
+CONFIG += console c++17
+CONFIG -= app_bundle
+
+QT += core gui
+
+TARGET = highlightbench
+DESTDIR = $${ASKELIBQT_BIN_PATH}
+
+include( ../../askelib/public.pri )
+
+INCLUDEPATH += ../../widgets
+INCLUDEPATH += $${ASKELIB_INCLUDE_PATH}
+
+LIBS += -L$${ASKELIBQT_LIB_PATH} -laskelib_qt_widgets$${ASKELIBQT_LIB_SUFFIX}
+LIBS += -L$${ASKELIB_LIB_PATH} -laskelib_std$${ASKELIB_LIB_SUFFIX}
+
+SOURCES += main.cpp
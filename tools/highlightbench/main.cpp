@@ -0,0 +1,379 @@
+/*! @file
+ *
+ * highlightbench measures every highlighter in isolation.
+ *
+ * Usage: `highlightbench [-o <result.json>] [--corpus <dir>] [--lines <n>] [--language <name>]`
+ *
+ * Every highlighter is run over three corpus shapes:
+ *  - `typical`: source-like lines, generated or read from `--corpus`;
+ *  - `minified`: the same content joined into a single line;
+ *  - `unterminated`: the typical corpus after a line opening a block
+ *    comment and strings which are never closed.
+ *
+ * Reported per language and shape: lines/s and MB/s (of UTF-8 source) of
+ * lexing without a document, heap allocations per line, and the time of a
+ * full document rehighlight (cold, then again with the lexing memo warm).
+ * The rehighlighted document is cut to `Highlighter::MemoSize` lines, so
+ * the memo can hold all of it.
+ * Results are written as JSON, so runs can be compared for per-language
+ * regressions.
+ *
+ * With glibc allocations are counted at `malloc()`, so storage of Qt
+ * containers is included. Elsewhere only `operator new` is counted, the
+ * report's `allocator` field says which one was.
+ */
+
+#include "texteditor/syntax.h"
+
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <new>
+
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextDocument>
+
+using namespace aske;
+using namespace aske::TextEditorPrivate;
+
+//
+// ALLOCATION COUNTING
+//
+
+namespace {
+std::atomic<qint64> allocations {0};
+}
+
+#if defined(__GLIBC__)
+
+// definitions of the executable take precedence over libc's for Qt libraries too
+extern "C" {
+
+void *__libc_malloc(std::size_t size);
+void *__libc_calloc(std::size_t count, std::size_t size);
+void *__libc_realloc(void *p, std::size_t size);
+
+void *malloc(std::size_t size)
+{
+    ++allocations;
+    return __libc_malloc(size);
+}
+
+void *calloc(std::size_t count, std::size_t size)
+{
+    ++allocations;
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *p, std::size_t size)
+{
+    ++allocations;
+    return __libc_realloc(p, size);
+}
+
+} // extern "C"
+
+static const char *const countedAllocator = "malloc";
+
+#else
+
+// QArrayData allocates with malloc() directly, Qt containers are not counted here
+void *operator new(std::size_t size)
+{
+    ++allocations;
+    if(void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+static const char *const countedAllocator = "new";
+
+#endif
+
+namespace {
+
+//
+// CORPORA
+//
+
+//! Deterministic generator, so corpora are equal between runs
+class Random
+{
+public:
+    quint32 next() {
+        m_state ^= m_state << 13;
+        m_state ^= m_state >> 17;
+        m_state ^= m_state << 5;
+        return m_state;
+    }
+    template<std::size_t N>
+    const char *pick(const char *const (&items)[N]) { return items[next() % N]; }
+
+private:
+    quint32 m_state {2463534242u};
+};
+
+const char *const words[] = {
+    "if", "else", "for", "while", "return", "def", "class", "function", "let", "var",
+    "int", "void", "select", "from", "where", "begin", "end", "local", "echo", "import",
+    "value", "count", "index", "result", "buffer", "QString", "self", "this", "data", "node",
+};
+
+const char *const operators[] = {" = ", " + ", " - ", " * ", " / ", " == ", " < ", " && ", ", ", "."};
+
+const char *const comments[] = {
+    " // trailing comment", " # trailing comment", " -- trailing comment", " ; trailing comment",
+    " /* inline comment */", " <!-- markup comment -->",
+};
+
+QString typicalLine(Random &random, bool withComments)
+{
+    QString line(QString(static_cast<int>(random.next() % 4) * 4, ' '));
+
+    const int tokens = 3 + random.next() % 10;
+    for(int i = 0; i < tokens; ++i) {
+        switch(random.next() % 8) {
+        case 0:
+            line += QString::number(random.next() % 100000);
+            break;
+        case 1:
+            line += "\"string \\\"literal\\\"\"";
+            break;
+        case 2:
+            line += "'c'";
+            break;
+        case 3:
+            line += QString(random.pick(words)) + '(';
+            line += QString(random.pick(words)) + ')';
+            break;
+        case 4:
+            line += QString("<div class=\"") + random.pick(words) + "\">";
+            break;
+        default:
+            line += random.pick(words);
+            break;
+        }
+        line += random.pick(operators);
+    }
+    line += ';';
+
+    if(withComments && random.next() % 5 == 0) {
+        line += random.pick(comments);
+    }
+    return line;
+}
+
+struct Corpus {
+    QString shape;
+    QStringList lines;
+};
+
+QList<Corpus> makeCorpora(const QStringList &typical, int lineCount)
+{
+    Random random;
+
+    QStringList lines = typical;
+    QStringList plain;
+    if(lines.isEmpty()) {
+        for(int i = 0; i < lineCount; ++i) {
+            lines.append(typicalLine(random, true));
+        }
+    }
+    for(int i = 0; i < lines.size(); ++i) {
+        plain.append(typical.isEmpty() ? typicalLine(random, false) : lines.at(i).trimmed());
+    }
+
+    QStringList unterminated {"/* \"\"\" ''' <!-- {- (* \" ' `"};
+    unterminated += lines;
+
+    return {
+        {"typical", lines},
+        {"minified", {plain.join(' ')}},
+        {"unterminated", unterminated},
+    };
+}
+
+//! Real files of `--corpus` directory grouped by syntax
+QHash<Syntax::t, QStringList> readCorpusDir(const QString &dir)
+{
+    QHash<Syntax::t, QStringList> result;
+    if(dir.isEmpty()) {
+        return result;
+    }
+
+    QDirIterator it(dir, QDir::Files, QDirIterator::Subdirectories);
+    while(it.hasNext()) {
+        QFile file(it.next());
+        if(!file.open(QIODevice::ReadOnly)) {
+            continue;
+        }
+        const QByteArray data = file.readAll();
+        const Syntax::t syntax = Syntax::fromFile(file.fileName(), data.left(512));
+        if(syntax != Syntax::No) {
+            result[syntax] += QString::fromUtf8(data).split('\n');
+        }
+    }
+    return result;
+}
+
+//
+// MEASUREMENTS
+//
+
+QJsonObject measure(Syntax::t syntax, const Corpus &corpus, qint64 minTime)
+{
+    qint64 bytes = 0;
+    for(const QString &line : corpus.lines) {
+        bytes += line.toUtf8().size();
+    }
+
+    QJsonObject result {
+        {"language", Syntax::name(syntax)},
+        {"shape", corpus.shape},
+        {"lines", static_cast<qint64>(corpus.lines.size())},
+        {"bytes", bytes},
+    };
+
+    // lexing without a document
+    {
+        std::unique_ptr<Highlighter> highlighter(Syntax::createHighlighter(syntax));
+
+        auto pass = [&] {
+            int state = -1;
+            for(const QString &line : corpus.lines) {
+                highlighter->lexLine(line, state);
+            }
+        };
+
+        pass(); // warm up lazily built language data
+
+        const qint64 before = allocations;
+        pass();
+        result["allocsPerLine"] = double(allocations - before) / qMax<qsizetype>(corpus.lines.size(), 1);
+
+        QElapsedTimer timer;
+        qint64 passes = 0;
+        timer.start();
+        do {
+            pass();
+            ++passes;
+        } while(timer.elapsed() < minTime);
+        const double seconds = timer.nsecsElapsed() / 1e9;
+
+        result["linesPerSec"] = passes * corpus.lines.size() / seconds;
+        result["mbPerSec"] = passes * bytes / seconds / (1024.0 * 1024.0);
+    }
+
+    // full document rehighlight, the second one is served by the lexing memo
+    // which a longer document would flush
+    {
+        QTextDocument document;
+        document.setPlainText(corpus.lines.mid(0, Highlighter::MemoSize).join('\n'));
+
+        std::unique_ptr<Highlighter> highlighter(Syntax::createHighlighter(syntax));
+        highlighter->setVisibleBlocks(0, INT_MAX);
+        highlighter->setDocument(&document);
+
+        QElapsedTimer timer;
+        const qint64 before = allocations;
+        timer.start();
+        highlighter->rehighlight();
+        result["rehighlightMs"] = timer.nsecsElapsed() / 1e6;
+        result["rehighlightAllocsPerBlock"] = double(allocations - before) / document.blockCount();
+
+        highlighter->resetMemoCounters();
+        timer.start();
+        highlighter->rehighlight();
+        result["rehighlightMemoMs"] = timer.nsecsElapsed() / 1e6;
+        result["memoHitRate"] = double(highlighter->memoHits())
+                                / qMax<quint64>(highlighter->memoHits() + highlighter->memoMisses(), 1);
+    }
+
+    return result;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // QTextDocument needs a GUI application, but no screen
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmark syntax highlighters.");
+    parser.addHelpOption();
+    const QCommandLineOption outputOption({"o", "output"}, "Write JSON into <file> instead of stdout.", "file");
+    const QCommandLineOption corpusOption("corpus", "Use files of <dir> as typical corpora.", "dir");
+    const QCommandLineOption linesOption("lines", "Lines of generated corpora.", "n", "20000");
+    const QCommandLineOption languageOption("language", "Run only <name> (e.g. \"C++\").", "name");
+    const QCommandLineOption timeOption("min-time", "Minimal lexing time per measurement.", "ms", "200");
+    parser.addOptions({outputOption, corpusOption, linesOption, languageOption, timeOption});
+    parser.process(app);
+
+    const QHash<Syntax::t, QStringList> corpusDir = readCorpusDir(parser.value(corpusOption));
+    const int lineCount = parser.value(linesOption).toInt();
+    const qint64 minTime = parser.value(timeOption).toLongLong();
+
+    QJsonArray results;
+    for(int i = Syntax::No + 1; i <= Syntax::Yaml; ++i) {
+        const Syntax::t syntax = static_cast<Syntax::t>(i);
+        if(parser.isSet(languageOption) && Syntax::name(syntax) != parser.value(languageOption)) {
+            continue;
+        }
+        std::unique_ptr<Highlighter> probe(Syntax::createHighlighter(syntax));
+        if(!probe) {
+            continue;
+        }
+
+        for(const Corpus &corpus : makeCorpora(corpusDir.value(syntax), lineCount)) {
+            const QJsonObject result = measure(syntax, corpus, minTime);
+            results.append(result);
+            fprintf(stderr, "%-14s %-13s %12.0f lines/s %8.2f MB/s %6.2f allocs/line %9.2f ms rehighlight\n",
+                    qPrintable(result["language"].toString()), qPrintable(corpus.shape),
+                    result["linesPerSec"].toDouble(), result["mbPerSec"].toDouble(),
+                    result["allocsPerLine"].toDouble(), result["rehighlightMs"].toDouble());
+        }
+    }
+
+    const QJsonObject report {
+        {"qt", qVersion()},
+        {"allocator", countedAllocator},
+        {"results", results},
+    };
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if(parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if(!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fprintf(stderr, "can not write %s\n", qPrintable(file.fileName()));
+            return 1;
+        }
+        file.write(json);
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include "batchhighlighter.h"
+
+#include <QColor>
+#include <QFont>
+#include <QTextCharFormat>
+#include <QVector>
+
+namespace aske {
+
+using namespace TextEditorPrivate;
+
+namespace {
+
+QByteArray htmlStyle(const QTextCharFormat &format)
+{
+    QByteArray style;
+    if(format.hasProperty(QTextFormat::ForegroundBrush)) {
+        style += "color:" + format.foreground().color().name().toLatin1() + ';';
+    }
+    if(format.fontWeight() >= QFont::Bold) {
+        style += "font-weight:bold;";
+    }
+    if(format.fontItalic()) {
+        style += "font-style:italic;";
+    }
+    if(format.fontUnderline()) {
+        style += "text-decoration:underline;";
+    }
+    return style.isEmpty() ? QByteArray() : "<span style=\"" + style + "\">";
+}
+
+QByteArray ansiStyle(const QTextCharFormat &format)
+{
+    QByteArray codes;
+    if(format.hasProperty(QTextFormat::ForegroundBrush)) {
+        const QColor color = format.foreground().color();
+        codes += "38;2;" + QByteArray::number(color.red()) + ';' + QByteArray::number(color.green())
+                 + ';' + QByteArray::number(color.blue());
+    }
+    if(format.fontWeight() >= QFont::Bold) {
+        codes += codes.isEmpty() ? "1" : ";1";
+    }
+    if(format.fontItalic()) {
+        codes += codes.isEmpty() ? "3" : ";3";
+    }
+    if(format.fontUnderline()) {
+        codes += codes.isEmpty() ? "4" : ";4";
+    }
+    return codes.isEmpty() ? QByteArray() : "\x1b[" + codes + 'm';
+}
+
+void appendHtml(QByteArray &out, QStringView text)
+{
+    const QByteArray utf8 = text.toUtf8();
+    for(const char c : utf8) {
+        switch(c) {
+        case '&': out += "&amp;"; break;
+        case '<': out += "&lt;"; break;
+        case '>': out += "&gt;"; break;
+        case '"': out += "&quot;"; break;
+        default: out += c; break;
+        }
+    }
+}
+
+} // namespace
+
+BatchHighlighter::BatchHighlighter(Syntax::t syntax)
+    : m_highlighter(Syntax::createHighlighter(syntax))
+{
+}
+
+BatchHighlighter::~BatchHighlighter() = default;
+
+QByteArray BatchHighlighter::render(const QByteArray &data, Output output)
+{
+    const QString text = QString::fromUtf8(data);
+    const bool html = output == Output::Html;
+
+    // opening sequence of every format, empty for formats which change nothing
+    QVector<QByteArray> open;
+    if(m_highlighter) {
+        for(const QTextCharFormat &format : m_highlighter->formats()) {
+            open.append(html ? htmlStyle(format) : ansiStyle(format));
+        }
+    }
+    const QByteArray close = html ? QByteArray("</span>") : QByteArray("\x1b[0m");
+
+    auto append = [&](QByteArray &out, QStringView part) {
+        if(html) {
+            appendHtml(out, part);
+        } else {
+            out += part.toUtf8();
+        }
+    };
+
+    QByteArray out;
+    out.reserve(data.size() * 2);
+    if(html) {
+        out += "<pre>";
+    }
+
+    if(!m_highlighter) {
+        append(out, text);
+    }
+
+    highlight(text, [&](int number, QStringView line, const QVector<Highlighter::Token> &tokens) {
+        if(number > 0) {
+            out += '\n';
+        }
+
+        qsizetype end = 0;
+        for(const Highlighter::Token &token : tokens) {
+            if(token.kind < 0 || open.at(token.kind).isEmpty()) {
+                continue;
+            }
+            append(out, line.mid(end, token.offset - end));
+            out += open.at(token.kind);
+            append(out, line.mid(token.offset, token.length));
+            out += close;
+            end = token.offset + token.length;
+        }
+        append(out, line.mid(end));
+    });
+
+    if(html) {
+        out += "</pre>\n";
+    }
+    return out;
+}
+
+} // namespace aske
@@ -0,0 +1,84 @@
+//! @file
+
+#ifndef BATCHHIGHLIGHTER_H
+#define BATCHHIGHLIGHTER_H
+
+#include <memory>
+#include <QByteArray>
+#include <QString>
+#include <QStringView>
+#include "syntax.h"
+
+namespace aske {
+
+/*!
+ * @brief Highlights text without a `QTextDocument`.
+ *
+ * @details
+ * Runs the same lexers as the editor over a whole text, line by line, and
+ * reports tokens of every line. Meant for headless use, e.g. rendering
+ * source files to HTML on a server.
+ *
+ * Every instance owns it's highlighter, so instances may be used from
+ * different threads at the same time.
+ */
+class BatchHighlighter
+{
+public:
+    //! Output of `render()`
+    enum class Output {
+        Html, //! `<pre>` with inline-styled `<span>`s
+        Ansi, //! 24-bit color terminal escape sequences
+    };
+
+    explicit BatchHighlighter(TextEditorPrivate::Syntax::t syntax);
+    ~BatchHighlighter();
+
+    /*! Whether there is a highlighter for the syntax. */
+    bool isValid() const { return m_highlighter != nullptr; }
+
+    /*! Lex `text` and call `report(lineNumber, line, tokens)` for every line.
+     *
+     * @details
+     * Lines are separated by `\n`, a trailing `\r` is not part of a line.
+     * Token kinds index `Highlighter::formats()`.
+     */
+    template<class Report>
+    void highlight(const QString &text, Report report);
+
+    /*! Highlight UTF-8 `data` and render it as `output`. */
+    QByteArray render(const QByteArray &data, Output output);
+
+private:
+    std::unique_ptr<Highlighter> m_highlighter;
+};
+
+template<class Report>
+void BatchHighlighter::highlight(const QString &text, Report report)
+{
+    if(!m_highlighter) {
+        return;
+    }
+
+    int state = -1;
+    int number = 0;
+    qsizetype from = 0;
+    while(from <= text.size()) {
+        qsizetype end = text.indexOf(QLatin1Char('\n'), from);
+        if(end < 0) {
+            end = text.size();
+        }
+        qsizetype lineEnd = end;
+        if(lineEnd > from && text.at(lineEnd - 1) == QLatin1Char('\r')) {
+            --lineEnd;
+        }
+
+        const QString line = text.mid(from, lineEnd - from);
+        report(number++, QStringView(line), m_highlighter->lexLine(line, state));
+        from = end + 1;
+    }
+}
+
+} // namespace aske
+
+#endif // BATCHHIGHLIGHTER_H
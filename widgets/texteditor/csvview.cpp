@@ -0,0 +1,533 @@
+#include "csvview.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <QThread>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace {
+
+constexpr qint64 MinPartSize = 4 * 1024 * 1024; //! Smaller files are indexed by fewer threads
+constexpr qint64 SliceSize = 1024 * 1024;       //! Workers check for cancel after every slice
+
+//! Run `job(part)` for every part, the calling thread takes the first one
+template<class Job>
+void runParts(qint64 parts, Job job)
+{
+    std::vector<std::thread> workers;
+    for(qint64 part = 1; part < parts; ++part) {
+        workers.emplace_back(job, part);
+    }
+    job(0);
+    for(std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+//! Raw bytes of field `column` of `row` without enclosing quotes, escaped quotes are kept doubled
+QByteArrayView fieldView(QByteArrayView row, int column, char separator)
+{
+    qsizetype start = 0;
+    for(int field = 0; start <= row.size(); ++field) {
+        qsizetype end = start;
+        bool quoted = end < row.size() && row.at(end) == '"';
+        if(quoted) {
+            ++end;
+            while(end < row.size() && !(row.at(end) == '"' && (end + 1 == row.size() || row.at(end + 1) != '"'))) {
+                end += row.at(end) == '"' ? 2 : 1;
+            }
+        }
+        while(end < row.size() && row.at(end) != separator) {
+            ++end;
+        }
+
+        if(field == column) {
+            QByteArrayView view = row.sliced(start, end - start);
+            if(quoted && view.size() >= 2 && view.endsWith('"')) {
+                view = view.sliced(1, view.size() - 2);
+            }
+            return view;
+        }
+        start = end + 1;
+    }
+    return {};
+}
+
+} // namespace
+
+CsvView::CsvView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+CsvView::~CsvView()
+{
+    cancel();
+}
+
+bool CsvView::openFile(const QString &fileName)
+{
+    cancel();
+    m_file.close();
+    m_copy.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_rows.clear();
+    m_order.clear();
+    m_widths.clear();
+    m_sortColumn = -1;
+
+    m_file.setFileName(fileName);
+    if(!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    m_size = m_file.size();
+    if(m_size > 0) {
+        m_data = reinterpret_cast<const char *>(m_file.map(0, m_size));
+        if(!m_data) {
+            // no mmap for this file system, fall back to a copy
+            m_copy = m_file.readAll();
+            m_data = m_copy.constData();
+            m_size = m_copy.size();
+        }
+    }
+
+    // separator is the most frequent candidate of the first line
+    const QByteArrayView head(m_data, qMin<qint64>(m_size, 4096));
+    const QByteArrayView firstLine = head.left(head.indexOf('\n') >= 0 ? head.indexOf('\n') : head.size());
+    m_separator = ',';
+    qsizetype best = firstLine.count(',');
+    for(char candidate : {';', '\t', '|'}) {
+        if(firstLine.count(candidate) > best) {
+            best = firstLine.count(candidate);
+            m_separator = candidate;
+        }
+    }
+
+    m_indexing = true;
+    m_worker = std::thread([this, generation = m_generation]() {
+        QVector<qint64> rows = buildIndex(m_data, m_size, m_cancel);
+        if(!m_cancel) {
+            QMetaObject::invokeMethod(this, [this, rows = std::move(rows), generation]() {
+                if(generation == m_generation) {
+                    indexDone(rows);
+                }
+            }, Qt::QueuedConnection);
+        }
+    });
+
+    updateScrollBars();
+    viewport()->update();
+    return true;
+}
+
+bool CsvView::sortByColumn(int column, Qt::SortOrder order)
+{
+    if(m_indexing) {
+        return false;
+    }
+
+    cancel();
+    m_sortColumn = column;
+    m_sortOrder = order;
+    if(column < 0) {
+        m_order.clear();
+        viewport()->update();
+        emit sorted();
+        return true;
+    }
+
+    m_sorting = true;
+    viewport()->update();
+    m_worker = std::thread([this, column, order, generation = m_generation]() {
+        const qint64 count = rowCount();
+
+        // keys point into the mapped file, numbers are compared as numbers
+        // if every non-empty field of the column is one, empty ones go first
+        QVector<QByteArrayView> keys(count);
+        QVector<double> numbers(count);
+        bool numeric = true;
+        for(qint64 row = 0; row < count; ++row) {
+            if((row & 0xffff) == 0 && m_cancel) {
+                return;
+            }
+            keys[row] = fieldView(QByteArrayView(rowBytes(row + 1)), column, m_separator);
+            if(numeric) {
+                const QByteArray field = QByteArray::fromRawData(keys.at(row).data(), keys.at(row).size()).trimmed();
+                bool ok = true;
+                numbers[row] = field.isEmpty() ? -std::numeric_limits<double>::infinity() : field.toDouble(&ok);
+                numeric = ok;
+            }
+        }
+
+        const bool ascending = order == Qt::AscendingOrder;
+        auto less = [&](qint64 a, qint64 b) {
+            if(!ascending) {
+                std::swap(a, b);
+            }
+            return numeric ? numbers.at(a) < numbers.at(b) : keys.at(a) < keys.at(b);
+        };
+
+        // sorted in runs which are then merged, so cancel is noticed between steps
+        QVector<qint64> permutation(count);
+        std::iota(permutation.begin(), permutation.end(), 0);
+        for(qint64 from = 0; from < count; from += SortRun) {
+            if(m_cancel) {
+                return;
+            }
+            std::stable_sort(permutation.begin() + from, permutation.begin() + qMin(count, from + SortRun), less);
+        }
+
+        QVector<qint64> merged(count);
+        for(qint64 width = SortRun; width < count; width *= 2) {
+            const qint64 *in = permutation.constData();
+            qint64 *out = merged.data();
+            for(qint64 from = 0; from < count; from += 2 * width) {
+                const qint64 middle = qMin(count, from + width);
+                const qint64 end = qMin(count, from + 2 * width);
+                qint64 a = from;
+                qint64 b = middle;
+                qint64 to = from;
+                while(a < middle && b < end) {
+                    if((to & 0xffff) == 0 && m_cancel) {
+                        return;
+                    }
+                    // equal keys are taken from the left run first, the merge is stable
+                    out[to++] = less(in[b], in[a]) ? in[b++] : in[a++];
+                }
+                std::copy(in + a, in + middle, out + to);
+                std::copy(in + b, in + end, out + to + (middle - a));
+            }
+            permutation.swap(merged);
+        }
+
+        if(!m_cancel) {
+            QMetaObject::invokeMethod(this, [this, permutation = std::move(permutation), generation]() {
+                if(generation != m_generation) {
+                    return;
+                }
+                if(m_worker.joinable()) {
+                    m_worker.join();
+                }
+                m_order = permutation;
+                m_sorting = false;
+                viewport()->update();
+                emit sorted();
+            }, Qt::QueuedConnection);
+        }
+    });
+    return true;
+}
+
+void CsvView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), palette().base());
+
+    if(m_indexing || m_rows.isEmpty()) {
+        painter.setPen(Qt::gray);
+        painter.drawText(viewport()->rect(), Qt::AlignCenter, m_indexing ? tr("Indexing rows...") : QString());
+        return;
+    }
+
+    const QFontMetrics metrics(font());
+    const int height = rowHeight();
+    const int cw = charWidth();
+    const int gutter = gutterWidth();
+    const int left = gutter + cw - horizontalScrollBar()->value();
+    const int width = viewport()->width();
+
+    auto drawRow = [&](int y, const QVector<QByteArray> &fields) {
+        int x = left;
+        for(int column = 0; column < m_widths.size() && x < width; ++column) {
+            const int columnWidth = m_widths.at(column);
+            if(column < fields.size() && x + columnWidth * cw > gutter) {
+                QString text = QString::fromUtf8(fields.at(column));
+                text.replace(QLatin1Char('\n'), QLatin1Char(' ')).replace(QLatin1Char('\r'), QLatin1Char(' '));
+                if(text.size() > columnWidth) {
+                    text = text.left(columnWidth - 1) + QChar(0x2026);
+                }
+                painter.drawText(x, y + metrics.ascent(), text);
+            }
+            x += (columnWidth + ColumnPadding) * cw;
+        }
+    };
+
+    // header stays on top, the sorted column is marked
+    painter.fillRect(0, 0, width, height, QColor(240, 240, 240));
+    painter.setClipRect(gutter, 0, width - gutter, height);
+    painter.setPen(palette().text().color());
+    drawRow(0, fields(0));
+    if(m_sortColumn >= 0 && m_sortColumn < m_widths.size()) {
+        int x = left;
+        for(int column = 0; column < m_sortColumn; ++column) {
+            x += (m_widths.at(column) + ColumnPadding) * cw;
+        }
+        x += m_widths.at(m_sortColumn) * cw;
+        const QChar mark = m_sorting ? QChar(0x2026) : m_sortOrder == Qt::AscendingOrder ? QChar(0x25b2) : QChar(0x25bc);
+        painter.drawText(x, metrics.ascent(), QString(mark));
+    }
+
+    const qint64 count = rowCount();
+    qint64 row = verticalScrollBar()->value();
+    for(int y = height; y < viewport()->height() && row < count; y += height, ++row) {
+        painter.setClipRect(gutter, height, width - gutter, viewport()->height() - height);
+        painter.setPen(palette().text().color());
+        drawRow(y, fields(fileRow(row)));
+
+        // number of the row in the file
+        painter.setClipping(false);
+        painter.setPen(Qt::lightGray);
+        painter.drawText(0, y, gutter - 6, height, Qt::AlignRight, QString::number(fileRow(row)));
+    }
+}
+
+void CsvView::mousePressEvent(QMouseEvent *event)
+{
+    // header click sorts: ascending, descending, file order
+    if(event->button() != Qt::LeftButton || event->position().y() >= rowHeight()) {
+        QAbstractScrollArea::mousePressEvent(event);
+        return;
+    }
+
+    const int column = columnAt(static_cast<int>(event->position().x()));
+    if(column < 0) {
+        return;
+    }
+    if(column != m_sortColumn) {
+        sortByColumn(column, Qt::AscendingOrder);
+    } else if(m_sortOrder == Qt::AscendingOrder) {
+        sortByColumn(column, Qt::DescendingOrder);
+    } else {
+        sortByColumn(-1);
+    }
+}
+
+void CsvView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+QVector<qint64> CsvView::buildIndex(const char *data, qint64 size, const std::atomic<bool> &cancel)
+{
+    if(size <= 0) {
+        return {};
+    }
+
+    const qint64 parts = qBound<qint64>(1, size / MinPartSize, QThread::idealThreadCount());
+    const qint64 partSize = size / parts + 1;
+    auto bounds = [&](qint64 part) {
+        return std::make_pair(qMin(size, part * partSize), qMin(size, (part + 1) * partSize));
+    };
+
+    // quotes of every part, a line feed is inside a quoted field if an odd
+    // number of quotes precedes it
+    std::vector<char> odd(parts);
+    runParts(parts, [&](qint64 part) {
+        const auto [from, to] = bounds(part);
+        qint64 quotes = 0;
+        for(qint64 slice = from; slice < to && !cancel; slice += SliceSize) {
+            const char *end = data + qMin(to, slice + SliceSize);
+            for(const char *at = data + slice; (at = static_cast<const char *>(std::memchr(at, '"', end - at))); ++at) {
+                ++quotes;
+            }
+        }
+        odd[part] = quotes & 1;
+    });
+
+    std::vector<char> quoted(parts);
+    char state = 0;
+    for(qint64 part = 0; part < parts; ++part) {
+        quoted[part] = state;
+        state ^= odd[part];
+    }
+
+    std::vector<QVector<qint64>> starts(parts);
+    runParts(parts, [&](qint64 part) {
+        const auto [from, to] = bounds(part);
+        bool inQuotes = quoted[part];
+        QVector<qint64> &rows = starts[part];
+        for(qint64 slice = from; slice < to && !cancel; slice += SliceSize) {
+            const qint64 end = qMin(to, slice + SliceSize);
+            for(qint64 i = slice; i < end; ++i) {
+                const char c = data[i];
+                if(c == '"') {
+                    inQuotes = !inQuotes;
+                } else if(c == '\n' && !inQuotes && i + 1 < size) {
+                    rows.append(i + 1);
+                }
+            }
+        }
+    });
+
+    qsizetype count = 1;
+    for(const QVector<qint64> &rows : starts) {
+        count += rows.size();
+    }
+    QVector<qint64> rows;
+    rows.reserve(count);
+    rows.append(0);
+    for(QVector<qint64> &part : starts) {
+        rows.append(part);
+        part.clear();
+    }
+    return rows;
+}
+
+QVector<QByteArray> CsvView::parseRow(const QByteArray &row, char separator)
+{
+    QVector<QByteArray> fields;
+    QByteArray field;
+    bool inQuotes = false;
+    bool quoted = false;
+    for(qsizetype i = 0; i < row.size(); ++i) {
+        const char c = row.at(i);
+        if(inQuotes) {
+            if(c != '"') {
+                field += c;
+            } else if(i + 1 < row.size() && row.at(i + 1) == '"') {
+                field += '"';
+                ++i;
+            } else {
+                inQuotes = false;
+            }
+        } else if(c == '"' && field.isEmpty() && !quoted) {
+            inQuotes = quoted = true;
+        } else if(c == separator) {
+            fields.append(field);
+            field.clear();
+            quoted = false;
+        } else {
+            field += c;
+        }
+    }
+    fields.append(field);
+    return fields;
+}
+
+void CsvView::cancel()
+{
+    m_cancel = true;
+    if(m_worker.joinable()) {
+        m_worker.join();
+    }
+    m_cancel = false;
+
+    ++m_generation;
+    m_indexing = false;
+    m_sorting = false;
+}
+
+void CsvView::indexDone(QVector<qint64> rows)
+{
+    if(m_worker.joinable()) {
+        m_worker.join();
+    }
+
+    m_rows = std::move(rows);
+    m_indexing = false;
+    measureColumns();
+    updateScrollBars();
+    viewport()->update();
+    emit indexed(rowCount());
+}
+
+QByteArray CsvView::rowBytes(qint64 row) const
+{
+    // raw data of the mapped file, not copied
+    const qint64 start = m_rows.at(row);
+    qint64 end = row + 1 < m_rows.size() ? m_rows.at(row + 1) : m_size;
+    if(end > start && m_data[end - 1] == '\n') {
+        --end;
+    }
+    if(end > start && m_data[end - 1] == '\r') {
+        --end;
+    }
+    return QByteArray::fromRawData(m_data + start, qMin(end - start, MaxRowBytes));
+}
+
+QVector<QByteArray> CsvView::fields(qint64 row) const
+{
+    return parseRow(rowBytes(row), m_separator);
+}
+
+qint64 CsvView::fileRow(qint64 row) const
+{
+    return 1 + (m_order.isEmpty() ? row : m_order.at(row));
+}
+
+void CsvView::measureColumns()
+{
+    m_widths.clear();
+    const qint64 rows = qMin<qint64>(m_rows.size(), SampleRows);
+    for(qint64 row = 0; row < rows; ++row) {
+        const QVector<QByteArray> rowFields = fields(row);
+        if(rowFields.size() > m_widths.size()) {
+            m_widths.resize(rowFields.size(), 1);
+        }
+        for(qsizetype column = 0; column < rowFields.size(); ++column) {
+            const int length = static_cast<int>(qMin<qsizetype>(QString::fromUtf8(rowFields.at(column)).size(), MaxColumnWidth));
+            m_widths[column] = qMax(m_widths.at(column), length);
+        }
+    }
+}
+
+int CsvView::columnAt(int x) const
+{
+    int right = gutterWidth() + charWidth() - horizontalScrollBar()->value();
+    for(int column = 0; column < m_widths.size(); ++column) {
+        right += (m_widths.at(column) + ColumnPadding) * charWidth();
+        if(x < right) {
+            return column;
+        }
+    }
+    return -1;
+}
+
+void CsvView::updateScrollBars()
+{
+    const int visible = qMax(1, viewport()->height() / rowHeight() - 1);
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<qint64>(qMax<qint64>(rowCount() - visible, 0), INT_MAX)));
+    verticalScrollBar()->setPageStep(visible);
+
+    int tableWidth = charWidth();
+    for(int width : std::as_const(m_widths)) {
+        tableWidth += (width + ColumnPadding) * charWidth();
+    }
+    const int width = viewport()->width() - gutterWidth();
+    horizontalScrollBar()->setRange(0, qMax(0, tableWidth - width));
+    horizontalScrollBar()->setPageStep(width);
+}
+
+int CsvView::rowHeight() const
+{
+    return qMax(1, QFontMetrics(font()).lineSpacing());
+}
+
+int CsvView::charWidth() const
+{
+    return qMax(1, QFontMetrics(font()).horizontalAdvance(QLatin1Char('0')));
+}
+
+int CsvView::gutterWidth() const
+{
+    int digits = 1;
+    for(qint64 max = rowCount(); max >= 10; max /= 10) {
+        ++digits;
+    }
+    return 3 + QFontMetrics(font()).boundingRect(QLatin1Char('9')).width() * digits + 15;
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
@@ -0,0 +1,110 @@
+//! @file
+
+#ifndef CSVVIEW_H
+#define CSVVIEW_H
+
+#include <atomic>
+#include <thread>
+#include <QAbstractScrollArea>
+#include <QFile>
+#include <QVector>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+/*!
+ * @brief Table view of a CSV file of any size.
+ *
+ * @details
+ * The file is mapped, not read in. Worker threads split it into parts and
+ * index where every row starts: the first pass counts quotes of every part,
+ * so the second one knows which line feeds are inside quoted fields. Fields
+ * of a row are parsed when the row is painted, only visible rows are.
+ *
+ * Columns have fixed widths measured on the first rows. The first row is
+ * a header which stays on top, clicking it sorts by the column: a worker
+ * sorts a permutation of rows, the text is never rewritten.
+ */
+class CsvView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit CsvView(QWidget *parent = 0);
+    ~CsvView();
+
+    /*! Map `fileName` and start indexing it. Returns false if it can not be read. */
+    bool openFile(const QString &fileName);
+
+    /*! Whether rows are still being indexed. */
+    bool isIndexing() const { return m_indexing; }
+
+    /*! Data rows, the header excluded. */
+    qint64 rowCount() const { return qMax<qsizetype>(m_rows.size() - 1, 0); }
+
+    /*!
+     * Sort rows by `column` in background, -1 restores file order.
+     * Returns false while rows are being indexed.
+     */
+    bool sortByColumn(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+    int sortColumn() const { return m_sortColumn; }
+    Qt::SortOrder sortOrder() const { return m_sortOrder; }
+
+signals:
+    /*! All `rows` are indexed. */
+    void indexed(qint64 rows);
+
+    /*! Rows are shown sorted by `sortColumn()`. */
+    void sorted();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    static constexpr int SampleRows = 1000;    //! Rows column widths are measured on
+    static constexpr int MaxColumnWidth = 40;  //! Characters, longer fields are cut
+    static constexpr int ColumnPadding = 2;    //! Characters between columns
+    static constexpr qint64 MaxRowBytes = 64 * 1024; //! Longer rows are shown cut
+    static constexpr qint64 SortRun = 64 * 1024;     //! Rows sorted at once before runs are merged
+
+    static QVector<qint64> buildIndex(const char *data, qint64 size, const std::atomic<bool> &cancel);
+    static QVector<QByteArray> parseRow(const QByteArray &row, char separator);
+
+    void cancel();
+    void indexDone(QVector<qint64> rows);
+    QByteArray rowBytes(qint64 row) const;
+    QVector<QByteArray> fields(qint64 row) const;
+    qint64 fileRow(qint64 row) const;
+    void measureColumns();
+    int columnAt(int x) const;
+
+    void updateScrollBars();
+    int rowHeight() const;
+    int charWidth() const;
+    int gutterWidth() const;
+
+    QFile m_file;
+    QByteArray m_copy;            //! File contents if it can not be mapped
+    const char *m_data {nullptr};
+    qint64 m_size {0};
+    char m_separator {','};
+    QVector<qint64> m_rows;       //! Start of every row, the header included
+    QVector<qint64> m_order;      //! Data row shown by every view row, empty for file order
+    QVector<int> m_widths;        //! Column widths in characters
+    int m_sortColumn {-1};
+    Qt::SortOrder m_sortOrder {Qt::AscendingOrder};
+    bool m_indexing {false};
+    bool m_sorting {false};
+
+    std::thread m_worker;
+    std::atomic<bool> m_cancel {false};
+    quint64 m_generation {0};     //! Results of cancelled jobs are dropped
+};
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // CSVVIEW_H
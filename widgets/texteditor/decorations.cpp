@@ -0,0 +1,146 @@
+#include "decorations.h"
+
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace {
+
+bool byStart(const IntervalTree::Interval &a, const IntervalTree::Interval &b)
+{
+    return a.from < b.from;
+}
+
+} // namespace
+
+//
+// INTERVAL TREE
+//
+
+void IntervalTree::add(QVector<Interval> intervals)
+{
+    if(intervals.isEmpty()) {
+        return;
+    }
+
+    Level level;
+    level.intervals = std::move(intervals);
+    std::sort(level.intervals.begin(), level.intervals.end(), byStart);
+
+    // binary counter: a level is merged into the new one while it is not bigger
+    while(!m_levels.isEmpty() && m_levels.last().intervals.size() <= level.intervals.size()) {
+        const QVector<Interval> &last = m_levels.last().intervals;
+        QVector<Interval> merged(last.size() + level.intervals.size());
+        std::merge(last.cbegin(), last.cend(), level.intervals.cbegin(), level.intervals.cend(), merged.begin(), byStart);
+        level.intervals = std::move(merged);
+        m_levels.removeLast();
+    }
+
+    build(level);
+    m_levels.append(std::move(level));
+}
+
+void IntervalTree::adjust(qint64 position, qint64 removed, qint64 added)
+{
+    if(m_levels.isEmpty()) {
+        return;
+    }
+
+    const qint64 end = position + removed;
+    const qint64 delta = added - removed;
+    auto mapFrom = [&](qint64 p) { return p < position ? p : p >= end ? p + delta : position + added; };
+    auto mapTo = [&](qint64 p) { return p <= position ? p : p >= end ? p + delta : position; };
+
+    QVector<Interval> intervals;
+    for(const Level &level : std::as_const(m_levels)) {
+        for(const Interval &interval : level.intervals) {
+            const qint64 from = mapFrom(interval.from);
+            const qint64 to = mapTo(interval.to);
+            if(to > from || (to == from && interval.to == interval.from)) {
+                intervals.append({from, to, interval.color});
+            }
+        }
+    }
+
+    m_levels.clear();
+    add(std::move(intervals));
+}
+
+void IntervalTree::remove(qint64 from)
+{
+    QVector<Interval> intervals;
+    bool removed = false;
+    for(const Level &level : std::as_const(m_levels)) {
+        for(const Interval &interval : level.intervals) {
+            if(interval.from == from) {
+                removed = true;
+            } else {
+                intervals.append(interval);
+            }
+        }
+    }
+
+    if(removed) {
+        m_levels.clear();
+        add(std::move(intervals));
+    }
+}
+
+void IntervalTree::build(Level &level)
+{
+    level.maxEnd.resize(level.intervals.size());
+    build(level, 0, level.intervals.size());
+}
+
+qint64 IntervalTree::build(Level &level, qsizetype begin, qsizetype end)
+{
+    if(begin >= end) {
+        return std::numeric_limits<qint64>::min();
+    }
+
+    // same split as in `query()`
+    const qsizetype middle = begin + (end - begin) / 2;
+    const qint64 maxEnd = qMax(effectiveEnd(level.intervals.at(middle)),
+                               qMax(build(level, begin, middle), build(level, middle + 1, end)));
+    level.maxEnd[middle] = maxEnd;
+    return maxEnd;
+}
+
+//
+// DECORATIONS
+//
+
+void Decorations::set(Layer layer, const QVector<Decoration> &decorations)
+{
+    IntervalTree &tree = m_layers[static_cast<int>(layer)];
+    tree.clear();
+    tree.add(decorations);
+}
+
+void Decorations::add(Layer layer, const QVector<Decoration> &decorations)
+{
+    m_layers[static_cast<int>(layer)].add(decorations);
+}
+
+void Decorations::clear(Layer layer)
+{
+    m_layers[static_cast<int>(layer)].clear();
+}
+
+bool Decorations::isEmpty(Layer layer) const
+{
+    return m_layers[static_cast<int>(layer)].isEmpty();
+}
+
+void Decorations::adjust(qint64 position, qint64 removed, qint64 added)
+{
+    for(IntervalTree &tree : m_layers) {
+        tree.adjust(position, removed, added);
+    }
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
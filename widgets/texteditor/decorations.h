@@ -0,0 +1,148 @@
+//! @file
+
+#ifndef DECORATIONS_H
+#define DECORATIONS_H
+
+#include <QColor>
+#include <QVector>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+/*!
+ * @brief Set of ranges which finds ranges intersecting a query range.
+ *
+ * @details
+ * Ranges are kept in a few sorted arrays whose sizes grow geometrically
+ * (the "logarithmic method"): a batch of ranges becomes a new array, arrays
+ * of similar size are merged. Every array is an implicit balanced search
+ * tree ordered by range start and augmented with the maximal end of every
+ * subtree, so a query visits O(log n) nodes plus the ranges it reports.
+ */
+class IntervalTree
+{
+public:
+    struct Interval {
+        qint64 from;
+        qint64 to;
+        QRgb color;
+    };
+
+    void clear() { m_levels.clear(); }
+    bool isEmpty() const { return m_levels.isEmpty(); }
+
+    /*! Add a batch of `intervals` in any order. */
+    void add(QVector<Interval> intervals);
+
+    /*!
+     * Follow an edit of the text: `removed` characters at `position` were
+     * replaced with `added` ones. Ranges after it move, ranges inside it
+     * shrink, ranges which become empty are dropped.
+     */
+    void adjust(qint64 position, qint64 removed, qint64 added);
+
+    /*! Remove ranges starting at `from`. */
+    void remove(qint64 from);
+
+    /*! Call `f(interval)` for every range intersecting [`from`, `to`). */
+    template<class F>
+    void forEachIn(qint64 from, qint64 to, F f) const;
+
+private:
+    //! Sorted array with subtree maxima of the implicit tree
+    struct Level {
+        QVector<Interval> intervals;
+        QVector<qint64> maxEnd; //! Maximal end in subtree rooted at the same index
+    };
+
+    //! Empty ranges are found as if they were one character long
+    static qint64 effectiveEnd(const Interval &interval) { return qMax(interval.to, interval.from + 1); }
+
+    static void build(Level &level);
+    static qint64 build(Level &level, qsizetype begin, qsizetype end);
+
+    template<class F>
+    static void query(const Level &level, qsizetype begin, qsizetype end, qint64 from, qint64 to, F &f);
+
+    QVector<Level> m_levels;
+};
+
+/*!
+ * @brief Decorations of the editor text, painted under the text.
+ *
+ * @details
+ * Every kind of decoration lives in its own layer which is updated on its
+ * own, e.g. moving the cursor replaces a single range of `CurrentLine` and
+ * does not touch thousands of search hits. The view asks for ranges of its
+ * visible part only, so painting does not depend on the number of ranges.
+ */
+class Decorations
+{
+public:
+    //! Layers in paint order
+    enum class Layer {
+        CurrentLine, //! Full width background of a line
+        Search,      //! Background of search hits
+        Brackets,    //! Background of a bracket and its pair
+        Diagnostics, //! Wavy underline
+    };
+    static constexpr int LayerCount = 4;
+
+    using Decoration = IntervalTree::Interval;
+
+    /*! Replace all decorations of `layer`. */
+    void set(Layer layer, const QVector<Decoration> &decorations);
+
+    /*! Add `decorations` to `layer`. */
+    void add(Layer layer, const QVector<Decoration> &decorations);
+
+    void clear(Layer layer);
+    bool isEmpty(Layer layer) const;
+
+    /*! Follow an edit of the text in all layers, see `IntervalTree::adjust()`. */
+    void adjust(qint64 position, qint64 removed, qint64 added);
+
+    /*! Call `f(decoration)` for every decoration of `layer` intersecting [`from`, `to`). */
+    template<class F>
+    void forEachIn(Layer layer, qint64 from, qint64 to, F f) const {
+        m_layers[static_cast<int>(layer)].forEachIn(from, to, f);
+    }
+
+private:
+    IntervalTree m_layers[LayerCount];
+};
+
+template<class F>
+void IntervalTree::forEachIn(qint64 from, qint64 to, F f) const
+{
+    for(const Level &level : m_levels) {
+        query(level, 0, level.intervals.size(), from, to, f);
+    }
+}
+
+template<class F>
+void IntervalTree::query(const Level &level, qsizetype begin, qsizetype end, qint64 from, qint64 to, F &f)
+{
+    while(begin < end) {
+        const qsizetype middle = begin + (end - begin) / 2;
+        if(level.maxEnd.at(middle) <= from) {
+            return;
+        }
+
+        query(level, begin, middle, from, to, f);
+
+        const Interval &interval = level.intervals.at(middle);
+        if(interval.from >= to) {
+            return;
+        }
+        if(effectiveEnd(interval) > from) {
+            f(interval);
+        }
+        begin = middle + 1;
+    }
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // DECORATIONS_H
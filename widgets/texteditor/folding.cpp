@@ -0,0 +1,364 @@
+#include "folding.h"
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <QTextBlock>
+#include <QTextDocument>
+#include "highlighters/highlighter.h"
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace {
+
+constexpr int TabStop = 4;
+constexpr int NoMinimum = std::numeric_limits<int>::max();
+
+quint32 nextPriority()
+{
+    static quint32 state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+//! Blank blocks never end an indentation region
+int indentKey(const Folding::Summary &summary)
+{
+    return summary.indent < 0 ? NoMinimum : summary.indent;
+}
+
+} // namespace
+
+//! Treap node, ordered by block number implicitly through subtree sizes
+struct Folding::Node {
+    explicit Node(const Summary &summary) : summary(summary), priority(nextPriority()) {}
+
+    Summary summary;
+    quint32 priority;
+    NodePtr left;
+    NodePtr right;
+
+    // aggregates of the subtree
+    int count {1};
+    int sum {0};               //! Brace balance of all blocks
+    int minPrefix {0};         //! Lowest balance reached inside the subtree
+    int minIndent {NoMinimum}; //! Lowest indentation of non-blank blocks
+};
+
+Folding::Folding() = default;
+Folding::~Folding() = default;
+
+Folding::Summary Folding::summarize(const QTextBlock &block)
+{
+    Summary summary;
+
+    const QString text = block.text();
+    int column = 0;
+    for(const QChar c : text) {
+        if(c == QLatin1Char(' ')) {
+            ++column;
+        } else if(c == QLatin1Char('\t')) {
+            column += TabStop - column % TabStop;
+        } else {
+            summary.indent = column;
+            break;
+        }
+    }
+
+    int balance = 0;
+    for(const Highlighter::Token &token : Highlighter::tokens(block)) {
+        // tokens of an edited block are stale until it is highlighted again
+        if(token.kind != Highlighter::Token::Bracket || token.offset >= text.size()) {
+            continue;
+        }
+        const QChar c = text.at(token.offset);
+        if(c == QLatin1Char('{')) {
+            ++balance;
+        } else if(c == QLatin1Char('}')) {
+            summary.minPrefix = qMin(summary.minPrefix, --balance);
+        }
+    }
+    summary.delta = balance;
+
+    return summary;
+}
+
+void Folding::reset(const QTextDocument *document)
+{
+    QVector<Summary> summaries;
+    summaries.reserve(document->blockCount());
+    for(QTextBlock block = document->begin(); block.isValid(); block = block.next()) {
+        summaries.append(summarize(block));
+    }
+
+    m_root = build(summaries);
+    m_collapsed.clear();
+}
+
+void Folding::replaceBlocks(int first, int removed, const QVector<Summary> &added)
+{
+    auto [head, rest] = split(std::move(m_root), first);
+    auto [dropped, tail] = split(std::move(rest), removed);
+    m_root = merge(merge(std::move(head), build(added)), std::move(tail));
+}
+
+void Folding::updateBlock(int number, const Summary &summary)
+{
+    if(number < 0 || number >= blockCount()) {
+        return;
+    }
+
+    // walk down remembering the path, aggregates are recomputed bottom up
+    std::vector<Node *> path;
+    Node *node = m_root.get();
+    while(node) {
+        path.push_back(node);
+        const int left = countOf(node->left);
+        if(number < left) {
+            node = node->left.get();
+        } else if(number > left) {
+            number -= left + 1;
+            node = node->right.get();
+        } else {
+            node->summary = summary;
+            break;
+        }
+    }
+    for(auto it = path.rbegin(); it != path.rend(); ++it) {
+        update(*it);
+    }
+}
+
+int Folding::blockCount() const
+{
+    return countOf(m_root);
+}
+
+int Folding::regionEnd(int number) const
+{
+    int depth = 0;
+    const Summary *header = summary(number, &depth);
+    if(!header) {
+        return -1;
+    }
+
+    if(m_mode == Mode::Braces) {
+        // region lasts until the balance falls back to the level before
+        // the block's unclosed braces, an unclosed region does not fold
+        if(header->delta - header->minPrefix <= 0) {
+            return -1;
+        }
+        const int closing = firstAtMost(number + 1, depth + header->minPrefix);
+        return closing < blockCount() && closing - 1 > number ? closing - 1 : -1;
+    }
+
+    if(header->indent < 0) {
+        return -1;
+    }
+    int last = firstIndentAtMost(number + 1, header->indent) - 1;
+    while(last > number && summary(last)->indent < 0) {
+        --last;
+    }
+    return last > number ? last : -1;
+}
+
+qint64 Folding::collapsedEnd(qint64 position) const
+{
+    qint64 end = -1;
+    m_collapsed.forEachIn(position, position + 1, [&](const IntervalTree::Interval &interval) {
+        if(interval.from == position) {
+            end = interval.to;
+        }
+    });
+    return end;
+}
+
+void Folding::setCollapsed(qint64 position, qint64 end, bool collapsed)
+{
+    if(collapsed) {
+        m_collapsed.add({{position, end, 0}});
+    } else {
+        m_collapsed.remove(position);
+    }
+}
+
+Folding::NodePtr Folding::build(const QVector<Summary> &summaries)
+{
+    // Cartesian tree in linear time: `spine` is the right spine of the
+    // tree built so far, `spine[k + 1]` being the right child of `spine[k]`
+    std::vector<NodePtr> spine;
+    for(const Summary &summary : summaries) {
+        auto node = std::make_unique<Node>(summary);
+        NodePtr popped;
+        while(!spine.empty() && spine.back()->priority < node->priority) {
+            NodePtr top = std::move(spine.back());
+            spine.pop_back();
+            top->right = std::move(popped);
+            update(top.get());
+            popped = std::move(top);
+        }
+        node->left = std::move(popped);
+        spine.push_back(std::move(node));
+    }
+
+    while(spine.size() > 1) {
+        NodePtr child = std::move(spine.back());
+        spine.pop_back();
+        update(child.get());
+        spine.back()->right = std::move(child);
+    }
+    if(spine.empty()) {
+        return nullptr;
+    }
+    update(spine.front().get());
+    return std::move(spine.front());
+}
+
+std::pair<Folding::NodePtr, Folding::NodePtr> Folding::split(NodePtr node, int count)
+{
+    if(!node) {
+        return {nullptr, nullptr};
+    }
+
+    const int left = countOf(node->left);
+    if(count <= left) {
+        auto [a, b] = split(std::move(node->left), count);
+        node->left = std::move(b);
+        update(node.get());
+        return {std::move(a), std::move(node)};
+    }
+
+    auto [a, b] = split(std::move(node->right), count - left - 1);
+    node->right = std::move(a);
+    update(node.get());
+    return {std::move(node), std::move(b)};
+}
+
+Folding::NodePtr Folding::merge(NodePtr a, NodePtr b)
+{
+    if(!a) {
+        return b;
+    }
+    if(!b) {
+        return a;
+    }
+
+    if(a->priority > b->priority) {
+        a->right = merge(std::move(a->right), std::move(b));
+        update(a.get());
+        return a;
+    }
+    b->left = merge(std::move(a), std::move(b->left));
+    update(b.get());
+    return b;
+}
+
+void Folding::update(Node *node)
+{
+    const Node *left = node->left.get();
+    const Node *right = node->right.get();
+    const int leftSum = left ? left->sum : 0;
+
+    node->count = 1 + (left ? left->count : 0) + (right ? right->count : 0);
+    node->sum = leftSum + node->summary.delta + (right ? right->sum : 0);
+
+    node->minPrefix = leftSum + node->summary.minPrefix;
+    if(left) {
+        node->minPrefix = qMin(node->minPrefix, left->minPrefix);
+    }
+    if(right) {
+        node->minPrefix = qMin(node->minPrefix, leftSum + node->summary.delta + right->minPrefix);
+    }
+
+    node->minIndent = indentKey(node->summary);
+    if(left) {
+        node->minIndent = qMin(node->minIndent, left->minIndent);
+    }
+    if(right) {
+        node->minIndent = qMin(node->minIndent, right->minIndent);
+    }
+}
+
+const Folding::Summary *Folding::summary(int number, int *depth) const
+{
+    int before = 0;
+    const Node *node = m_root.get();
+    while(node) {
+        const int left = countOf(node->left);
+        if(number < left) {
+            node = node->left.get();
+        } else if(number > left) {
+            number -= left + 1;
+            before += (node->left ? node->left->sum : 0) + node->summary.delta;
+            node = node->right.get();
+        } else {
+            if(depth) {
+                *depth = before + (node->left ? node->left->sum : 0);
+            }
+            return &node->summary;
+        }
+    }
+    return nullptr;
+}
+
+int Folding::countOf(const NodePtr &node)
+{
+    return node ? node->count : 0;
+}
+
+int Folding::firstAtMost(int from, int depth) const
+{
+    const int found = findBalance(m_root.get(), 0, 0, from, depth);
+    return found < 0 ? blockCount() : found;
+}
+
+int Folding::firstIndentAtMost(int from, int indent) const
+{
+    const int found = findIndent(m_root.get(), 0, from, indent);
+    return found < 0 ? blockCount() : found;
+}
+
+int Folding::findBalance(const Node *node, int index, int before, int from, int depth)
+{
+    // a subtree which never gets low enough is skipped as a whole,
+    // so only O(log n) nodes are visited
+    if(!node || index + node->count <= from || before + node->minPrefix > depth) {
+        return -1;
+    }
+
+    const int found = findBalance(node->left.get(), index, before, from, depth);
+    if(found >= 0) {
+        return found;
+    }
+
+    const int number = index + countOf(node->left);
+    const int leftSum = node->left ? node->left->sum : 0;
+    if(number >= from && before + leftSum + node->summary.minPrefix <= depth) {
+        return number;
+    }
+    return findBalance(node->right.get(), number + 1, before + leftSum + node->summary.delta, from, depth);
+}
+
+int Folding::findIndent(const Node *node, int index, int from, int indent)
+{
+    if(!node || index + node->count <= from || node->minIndent > indent) {
+        return -1;
+    }
+
+    const int found = findIndent(node->left.get(), index, from, indent);
+    if(found >= 0) {
+        return found;
+    }
+
+    const int number = index + countOf(node->left);
+    if(number >= from && indentKey(node->summary) <= indent) {
+        return number;
+    }
+    return findIndent(node->right.get(), number + 1, from, indent);
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
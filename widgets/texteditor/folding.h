@@ -0,0 +1,109 @@
+//! @file
+
+#ifndef FOLDING_H
+#define FOLDING_H
+
+#include <memory>
+#include <QVector>
+#include "decorations.h"
+
+QT_BEGIN_NAMESPACE
+class QTextBlock;
+class QTextDocument;
+QT_END_NAMESPACE
+
+namespace aske {
+namespace TextEditorPrivate {
+
+/*!
+ * @brief Nesting structure of document blocks for code folding.
+ *
+ * @details
+ * Every block is reduced to a `Summary`: its `{`/`}` balance, taken from
+ * the highlighter's bracket tokens so that braces in strings and comments do
+ * not count, and its indentation. Summaries live in an implicit treap in
+ * block order with subtree aggregates. An edited block is updated and blocks
+ * are inserted or removed in O(log n) without rescanning the rest, and the
+ * end of a region is found by descending the aggregates in O(log n) too.
+ *
+ * Collapsed regions are intervals of document positions, from the start of
+ * the region's first block to the end of its last hidden one.
+ */
+class Folding
+{
+public:
+    //! What starts and ends a region
+    enum class Mode {
+        Braces, //! From a block with an unclosed `{` to the block closing it
+        Indent, //! From a block to the next one which is not indented more
+    };
+
+    //! Block summary
+    struct Summary {
+        int delta {0};     //! Opened minus closed braces
+        int minPrefix {0}; //! Lowest balance inside the block, 0 or less
+        int indent {-1};   //! Indentation width, -1 for a blank block
+    };
+
+    Folding();
+    ~Folding();
+
+    void setMode(Mode mode) { m_mode = mode; }
+    Mode mode() const { return m_mode; }
+
+    /*! Summary of `block` by its text and highlighter tokens. */
+    static Summary summarize(const QTextBlock &block);
+
+    /*! Summarize all blocks of `document` and forget collapsed regions. */
+    void reset(const QTextDocument *document);
+
+    /*! Replace `removed` summaries from block `first` with `added`. */
+    void replaceBlocks(int first, int removed, const QVector<Summary> &added);
+
+    /*! Set summary of block `number`. */
+    void updateBlock(int number, const Summary &summary);
+
+    int blockCount() const;
+
+    /*! Last block of the region started by block `number`, -1 if it starts none. */
+    int regionEnd(int number) const;
+
+    /*! End of the collapsed region which starts at `position`, -1 if there is none. */
+    qint64 collapsedEnd(qint64 position) const;
+
+    void setCollapsed(qint64 position, qint64 end, bool collapsed);
+
+    /*! Call `f(position, end)` for every collapsed region intersecting [`from`, `to`). */
+    template<class F>
+    void forEachCollapsed(qint64 from, qint64 to, F f) const {
+        m_collapsed.forEachIn(from, to, [&](const IntervalTree::Interval &interval) { f(interval.from, interval.to); });
+    }
+
+    /*! Follow an edit of the text, see `IntervalTree::adjust()`. */
+    void adjust(qint64 position, qint64 removed, qint64 added) { m_collapsed.adjust(position, removed, added); }
+
+private:
+    struct Node;
+    using NodePtr = std::unique_ptr<Node>;
+
+    static NodePtr build(const QVector<Summary> &summaries);
+    static std::pair<NodePtr, NodePtr> split(NodePtr node, int count);
+    static NodePtr merge(NodePtr a, NodePtr b);
+    static void update(Node *node);
+    static int countOf(const NodePtr &node);
+    static int findBalance(const Node *node, int index, int before, int from, int depth);
+    static int findIndent(const Node *node, int index, int from, int indent);
+
+    const Summary *summary(int number, int *depth = nullptr) const;
+    int firstAtMost(int from, int depth) const;
+    int firstIndentAtMost(int from, int indent) const;
+
+    Mode m_mode {Mode::Braces};
+    NodePtr m_root;
+    IntervalTree m_collapsed;
+};
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // FOLDING_H
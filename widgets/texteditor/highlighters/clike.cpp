@@ -1,9 +1,15 @@
 #include "clike.h"
+#include "lexer.h"
 
 namespace aske {
 
-CLikeHighlighter::CLikeHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+CLikeHighlighter::CLikeHighlighter(const Grammar &grammar, QTextDocument *parent)
+    : Highlighter(grammar.formats, parent)
+    , m_grammar(grammar)
+{
+}
+
+Highlighter::Formats CLikeHighlighter::defaultFormats()
 {
     QTextCharFormat KeywordFormat;
     QTextCharFormat ClassnameFormat;
@@ -19,165 +25,149 @@ CLikeHighlighter::CLikeHighlighter(QTextDocument *parent)
     LiteralFormat.setForeground(QColor(0, 0, 170));
     PreprocessorFormat.setForeground(QColor(100, 100, 100));
 
-    m_colors = {
+    return makeFormats<HighlightElement>({
         { HighlightElement::Keyword, KeywordFormat },
         { HighlightElement::Classname, ClassnameFormat },
         { HighlightElement::String, StringFormat },
         { HighlightElement::Comment, CommentFormat },
         { HighlightElement::Literal, LiteralFormat },
         { HighlightElement::Preprocessor, PreprocessorFormat },
-    };
+        { HighlightElement::Macro, PreprocessorFormat },
+    });
 }
 
-void CLikeHighlighter::highlightBlock(const QString &text)
+qsizetype CLikeHighlighter::rawStringOpener(QStringView prefix, const QChar *s, qsizetype i, qsizetype size, QString &close) const
 {
-    // parsing state
-    enum {
-        Start = 0,
-        Number = 1,
-        Identifier = 2,
-        String = 3,
-        Comment = 4,
-        Preprocessor = 5,
-    };
-
-    int blockState = previousBlockState();
-    int state = blockState & 15;
-    if (blockState < 0) {
-        state = Start;
+    switch (m_grammar.rawStrings) {
+    case RawStrings::Cpp: {
+        // R"delim( with optional encoding prefix, delim is up to 16 characters
+        if (i >= size || s[i] != QLatin1Char('"') || !prefix.endsWith(QLatin1Char('R')) || prefix.size() > 3) {
+            return 0;
+        }
+        const QStringView encoding = prefix.chopped(1);
+        if (!encoding.isEmpty() && encoding != u"u8" && encoding != u"u" && encoding != u"U" && encoding != u"L") {
+            return 0;
+        }
+        for (qsizetype j = i + 1; j < size && j <= i + 17; ++j) {
+            const char16_t c = s[j].unicode();
+            if (c == '(') {
+                close = QStringView(s + i + 1, j - i - 1).toString();
+                close.prepend(QLatin1Char(')'));
+                close.append(QLatin1Char('"'));
+                return j + 1 - i;
+            }
+            if (c == ')' || c == '\\' || (Lexer::classOf(c) & Lexer::Space)) {
+                return 0;
+            }
+        }
+        return 0;
     }
+    case RawStrings::Rust: {
+        // r"...", r#"..."#, br##"..."##
+        if (prefix != u"r" && prefix != u"br") {
+            return 0;
+        }
+        qsizetype j = i;
+        while (j < size && s[j] == QLatin1Char('#')) {
+            ++j;
+        }
+        if (j >= size || s[j] != QLatin1Char('"')) {
+            return 0;
+        }
+        close = QString(j - i, QLatin1Char('#'));
+        close.prepend(QLatin1Char('"'));
+        return j + 1 - i;
+    }
+    default:
+        return 0;
+    }
+}
 
-    int start = 0;
-    int i = 0;
-    while (i <= text.length()) {
-        QChar ch = (i < text.length()) ? text.at(i) : QChar();
-        QChar next_ch = (i < text.length() - 1) ? text.at(i + 1) : QChar();
-
-        switch (state) {
+int CLikeHighlighter::lexBlock(const QString &text, int previousState)
+{
+    const QChar *s = text.constData();
+    const qsizetype size = text.size();
+    qsizetype i = 0;
+
+    // continue comment or string opened in previous blocks
+    Lexer::State state = m_states.state(previousState);
+    if (state.kind == Lexer::State::Comment) {
+        i = Lexer::closeComment(s, 0, size, state, m_grammar.nestedComments);
+        addRun(0, i, HighlightElement::Comment);
+    } else if (state.kind != Lexer::State::Start) {
+        i = Lexer::closeString(s, 0, size, state);
+        addRun(0, i, HighlightElement::String);
+    }
 
-        case Start:
-            start = i;
-            if (ch.isSpace()) {
-                ++i;
-            } else if (ch.isDigit() || (ch == '-' && !next_ch.isLetter())) {
-                ++i;
-                state = Number;
-            } else if (ch.isLetter() || (ch == '_') || (ch == '$')) {
-                ++i;
-                state = Identifier;
-            } else if (ch == '#') {
-                while(next_ch.isSpace() && next_ch != '\n' && i <= text.length()) {
-                    ++i;
-                    ch = (i < text.length()) ? text.at(i) : QChar();
-                    next_ch = (i < text.length() - 1) ? text.at(i + 1) : QChar();
-                }
-                ++i;
-                state = Preprocessor;
-            } else if ((ch == '\'') || (ch == '\"')) {
-                ++i;
-                state = String;
-            } else if ((ch == '/') && (next_ch == '*')) {
-                ++i;
-                ++i;
-                state = Comment;
-            } else if ((ch == '/') && (next_ch == '/')) {
-                i = text.length();
-                setFormat(start, text.length(), m_colors[HighlightElement::Comment]);
-            } else {
-                ++i;
-                state = Start;
+    while (i < size) {
+        const qsizetype start = i;
+        const char16_t ch = s[i].unicode();
+        const char16_t next = (i + 1 < size) ? s[i + 1].unicode() : 0;
+        const quint8 cls = Lexer::classOf(ch);
+
+        if (cls & Lexer::Space) {
+            i = Lexer::skip(s, i + 1, size, Lexer::Space);
+        } else if ((cls & Lexer::Digit) || (ch == '-' && !(Lexer::classOf(next) & Lexer::Letter))) {
+            i = Lexer::skip(s, i + 1, size, Lexer::Digit | Lexer::Letter);
+            addRun(start, i - start, HighlightElement::Literal);
+        } else if (cls & (Lexer::Letter | Lexer::Word)) {
+            i = Lexer::skip(s, i + 1, size, Lexer::Digit | Lexer::Letter | Lexer::Word);
+            const QStringView token(s + start, i - start);
+            QString close;
+            if (const qsizetype opener = rawStringOpener(token, s, i, size, close)) {
+                state = {Lexer::State::RawString, 0, close};
+                i = Lexer::closeString(s, i + opener, size, state);
+                addRun(start, i - start, HighlightElement::String);
+            } else if (m_grammar.keywords.contains(token)) {
+                addRun(start, i - start, HighlightElement::Keyword);
+            } else if (m_grammar.classnames.contains(token)) {
+                addRun(start, i - start, HighlightElement::Classname);
             }
-            break;
-
-        case Number:
-            if (ch.isSpace() || !(ch.isDigit() || ch.isLetter())) {
-                setFormat(start, i - start, m_colors[HighlightElement::Literal]);
-                state = Start;
-            } else {
+        } else if (ch == '#') {
+            // directive may be separated from '#' by spaces, but not by a line break
+            i = start + 1;
+            while (i < size && s[i] != QLatin1Char('\n') && (Lexer::classOf(s[i].unicode()) & Lexer::Space)) {
                 ++i;
             }
-            break;
-
-        case Identifier:
-            if (ch.isSpace() ||
-                (!(ch.isDigit() || ch.isLetter() || (ch == '_') || (ch == '$')))) {
-                QString token = text.mid(start, i - start).trimmed();
-                if (m_keywords.contains(token)) {
-                    setFormat(start, i - start, m_colors[HighlightElement::Keyword]);
-                } else if (m_classnames.contains(token)) {
-                    setFormat(start, i - start, m_colors[HighlightElement::Classname]);
-                }
-                state = Start;
-            } else {
-                ++i;
+            const qsizetype name = i;
+            i = Lexer::skip(s, i, size, Lexer::Letter);
+            if (m_grammar.ppDirectives.contains(QStringView(s + name, i - name))) {
+                addRun(start, i - start, HighlightElement::Preprocessor);
             }
-            break;
-
-        case Preprocessor:
-            if (ch == '\n' || !ch.isLetter()) {
-                QString token = text.mid(start + 1, i - start - 1).trimmed();
-                if (m_ppDirectives.contains(token)) {
-                    setFormat(start, i - start, m_colors[HighlightElement::Preprocessor]);
+        } else if (ch == '`' && m_grammar.rawStrings == RawStrings::Template) {
+            state = {Lexer::State::String, 0, QStringLiteral("`")};
+            i = Lexer::closeString(s, start + 1, size, state);
+            addRun(start, i - start, HighlightElement::String);
+        } else if (ch == '\'' || ch == '"') {
+            // string ends at the same quote, backslash escapes only valid escape characters
+            i = start + 1;
+            for (;;) {
+                i = Lexer::find(s, i, size, ch, '\\');
+                if (i == size) {
+                    // unterminated string is not highlighted
+                    break;
                 }
-                state = Start;
-            } else {
-                ++i;
-            }
-            break;
-
-        case String:
-            if ((ch == '\\') &&
-                ((next_ch == '\\') || (next_ch == '\'') || (next_ch == '\"') ||
-                 (next_ch == 'b') || (next_ch == 'r') || (next_ch == 'f') ||
-                 (next_ch == 't') || (next_ch == 'v'))) {
-                // Accept all valid escapes as part of string
-                ++i;
-                ++i;
-            }
-            else if (ch == text.at(start)) {
-                QChar prev_prev = (i > 1) ? text.at(i - 2) : QChar();
-                QChar prev = (i > 0) ? text.at(i - 1) : QChar();
-                if ((!(prev == '\\')) || ((prev_prev == '\\') && (prev == '\\'))) {
-                    ++i;
-                    setFormat(start, i - start, m_colors[HighlightElement::String]);
-                    state = Start;
-                } else {
-                    // If (ch == '\\') and we are here, there's an error.
-                    // For example, an invalid escape sequence.
-                    ++i;
+                if (s[i] == QLatin1Char('\\')) {
+                    i += (i + 1 < size && Lexer::isEscape(s[i + 1].unicode())) ? 2 : 1;
+                    continue;
                 }
-            } else {
-                // If (ch == '\\') and we are here, there's an error
-                // For example, an invalid escape sequence.
                 ++i;
+                addRun(start, i - start, HighlightElement::String);
+                break;
             }
+        } else if (ch == '/' && next == '*') {
+            state = {Lexer::State::Comment, 1, {}};
+            i = Lexer::closeComment(s, start + 2, size, state, m_grammar.nestedComments);
+            addRun(start, i - start, HighlightElement::Comment);
+        } else if (ch == '/' && next == '/') {
+            addRun(start, size - start, HighlightElement::Comment);
             break;
-
-        case Comment:
-            if ((ch == '*') && (next_ch == '/')) {
-                ++i;
-                ++i;
-                setFormat(start, i - start, m_colors[HighlightElement::Comment]);
-                state = Start;
-            } else {
-                ++i;
-            }
-            break;
-
-        default:
-            state = Start;
-            break;
+        } else {
+            ++i;
         }
     }
 
-    if (state == Comment) {
-        setFormat(start, text.length(), m_colors[HighlightElement::Comment]);
-    } else {
-        state = Start;
-    }
-
-    blockState = (state & 15);
-    setCurrentBlockState(blockState);
+    return m_states.id(state);
 }
 
 } // aske
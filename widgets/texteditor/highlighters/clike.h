@@ -1,7 +1,9 @@
 #ifndef CLIKE_HIGHLIGHTER_H
 #define CLIKE_HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include "highlighter.h"
+#include "keywords.h"
+#include "lexerstate.h"
 #include <QTextCharFormat>
 
 QT_BEGIN_NAMESPACE
@@ -10,16 +12,11 @@ QT_END_NAMESPACE
 
 namespace aske {
 
-class CLikeHighlighter : public ::QSyntaxHighlighter
+class CLikeHighlighter : public Highlighter
 {
     Q_OBJECT
 
-public:
-    CLikeHighlighter(QTextDocument *parent = 0);
-
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
-
     enum class HighlightElement {
         Keyword,
         Classname,
@@ -27,12 +24,44 @@ protected:
         Comment,
         Literal,
         Preprocessor,
+        Macro,
+    };
+
+    //! Multi-line string syntax of a language
+    enum class RawStrings {
+        None,
+        Cpp,      //! `R"delim( ... )delim"`
+        Rust,     //! `r#" ... "#`
+        Template, //! JavaScript `` ` ... ` ``
+    };
+
+    //! Immutable language data shared by all highlighters of a language
+    struct Grammar {
+        Formats formats;
+        KeywordSet keywords;
+        KeywordSet classnames;
+        KeywordSet ppDirectives;
+        bool nestedComments {false};
+        RawStrings rawStrings {RawStrings::None};
     };
 
-    QMap<HighlightElement, QTextCharFormat> m_colors;
-    QStringList m_keywords;
-    QStringList m_classnames;
-    QStringList m_ppDirectives;
+    CLikeHighlighter(const Grammar &grammar, QTextDocument *parent = 0);
+
+    /*! Formats common for all C-like languages. */
+    static Formats defaultFormats();
+
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
+
+    /*! Opening delimiter of a raw string which starts with `prefix` at `i`.
+     *
+     * @details
+     * Returns length of the delimiter after `prefix` and sets closing
+     * delimiter to `close`, or returns 0 if there is no raw string.
+     */
+    qsizetype rawStringOpener(QStringView prefix, const QChar *s, qsizetype i, qsizetype size, QString &close) const;
+
+    const Grammar &m_grammar;
+    Lexer::StateTable m_states; //! Block state is an ID in this table
 };
 
 } // namespace aske
@@ -2,357 +2,374 @@
 
 namespace aske {
 
-CppHighlighter::CppHighlighter(QTextDocument *parent)
-    : CLikeHighlighter(parent)
-{
-    //
-    // PREPROCESSOR
-    //
+namespace {
 
-    m_ppDirectives = QStringList {
-        QStringLiteral("define"),
-        QStringLiteral("undef"),
-        QStringLiteral("include"),
-        QStringLiteral("if"),
-        QStringLiteral("ifdef"),
-        QStringLiteral("ifndef"),
-        QStringLiteral("else"),
-        QStringLiteral("elif"),
-        QStringLiteral("endif"),
-        QStringLiteral("line"),
-        QStringLiteral("error"),
-        QStringLiteral("warning"),
-        QStringLiteral("pragma")
-    };
+//
+// PREPROCESSOR
+//
 
+constexpr auto ppDirectives = makeKeywordTable({
+    "define",
+    "undef",
+    "include",
+    "if",
+    "ifdef",
+    "ifndef",
+    "else",
+    "elif",
+    "endif",
+    "line",
+    "error",
+    "warning",
+    "pragma",
+});
 
-    //
-    // KEYWORDS
-    //
+//
+// KEYWORDS
+//
 
-    m_keywords = QStringList {
-        QStringLiteral("alignas"),
-        QStringLiteral("alignof"),
-        QStringLiteral("and"),
-        QStringLiteral("and_eq"),
-        QStringLiteral("asm"),
-        QStringLiteral("auto"),
-        QStringLiteral("bitand"),
-        QStringLiteral("bitor"),
-        QStringLiteral("bool"),
-        QStringLiteral("break"),
-        QStringLiteral("case"),
-        QStringLiteral("catch"),
-        QStringLiteral("char"),
-        QStringLiteral("char16_t"),
-        QStringLiteral("char32_t"),
-        QStringLiteral("class"),
-        QStringLiteral("compl"),
-        QStringLiteral("const"),
-        QStringLiteral("constexpr"),
-        QStringLiteral("const_cast"),
-        QStringLiteral("continue"),
-        QStringLiteral("decltype"),
-        QStringLiteral("default"),
-        QStringLiteral("delete"),
-        QStringLiteral("do"),
-        QStringLiteral("double"),
-        QStringLiteral("dynamic_cast"),
-        QStringLiteral("else"),
-        QStringLiteral("enum"),
-        QStringLiteral("explicit"),
-        QStringLiteral("export"),
-        QStringLiteral("extern"),
-        QStringLiteral("false"),
-        QStringLiteral("final"),
-        QStringLiteral("float"),
-        QStringLiteral("for"),
-        QStringLiteral("friend"),
-        QStringLiteral("goto"),
-        QStringLiteral("if"),
-        QStringLiteral("inline"),
-        QStringLiteral("int"),
-        QStringLiteral("long"),
-        QStringLiteral("mutable"),
-        QStringLiteral("namespace"),
-        QStringLiteral("new"),
-        QStringLiteral("noexcept"),
-        QStringLiteral("not"),
-        QStringLiteral("not_eq"),
-        QStringLiteral("nullptr"),
-        QStringLiteral("operator"),
-        QStringLiteral("or"),
-        QStringLiteral("or_eq"),
-        QStringLiteral("override"),
-        QStringLiteral("private"),
-        QStringLiteral("protected"),
-        QStringLiteral("public"),
-        QStringLiteral("register"),
-        QStringLiteral("reinterpret_cast"),
-        QStringLiteral("return"),
-        QStringLiteral("short"),
-        QStringLiteral("signed"),
-        QStringLiteral("sizeof"),
-        QStringLiteral("static"),
-        QStringLiteral("static_assert"),
-        QStringLiteral("static_cast"),
-        QStringLiteral("struct"),
-        QStringLiteral("switch"),
-        QStringLiteral("template"),
-        QStringLiteral("this"),
-        QStringLiteral("thread_local"),
-        QStringLiteral("throw"),
-        QStringLiteral("true"),
-        QStringLiteral("try"),
-        QStringLiteral("typedef"),
-        QStringLiteral("typeid"),
-        QStringLiteral("typename"),
-        QStringLiteral("union"),
-        QStringLiteral("unsigned"),
-        QStringLiteral("using"),
-        QStringLiteral("virtual"),
-        QStringLiteral("void"),
-        QStringLiteral("volatile"),
-        QStringLiteral("wchar_t"),
-        QStringLiteral("while"),
-        QStringLiteral("xor"),
-        QStringLiteral("xor_eq"),
+constexpr auto keywords = makeKeywordTable({
+    "alignas",
+    "alignof",
+    "and",
+    "and_eq",
+    "asm",
+    "auto",
+    "bitand",
+    "bitor",
+    "bool",
+    "break",
+    "case",
+    "catch",
+    "char",
+    "char16_t",
+    "char32_t",
+    "class",
+    "compl",
+    "const",
+    "constexpr",
+    "const_cast",
+    "continue",
+    "decltype",
+    "default",
+    "delete",
+    "do",
+    "double",
+    "dynamic_cast",
+    "else",
+    "enum",
+    "explicit",
+    "export",
+    "extern",
+    "false",
+    "final",
+    "float",
+    "for",
+    "friend",
+    "goto",
+    "if",
+    "inline",
+    "int",
+    "long",
+    "mutable",
+    "namespace",
+    "new",
+    "noexcept",
+    "not",
+    "not_eq",
+    "nullptr",
+    "operator",
+    "or",
+    "or_eq",
+    "override",
+    "private",
+    "protected",
+    "public",
+    "register",
+    "reinterpret_cast",
+    "return",
+    "short",
+    "signed",
+    "sizeof",
+    "static",
+    "static_assert",
+    "static_cast",
+    "struct",
+    "switch",
+    "template",
+    "this",
+    "thread_local",
+    "throw",
+    "true",
+    "try",
+    "typedef",
+    "typeid",
+    "typename",
+    "union",
+    "unsigned",
+    "using",
+    "virtual",
+    "void",
+    "volatile",
+    "wchar_t",
+    "while",
+    "xor",
+    "xor_eq",
 
-        // attributes
-        QStringLiteral("noreturn"),
-        QStringLiteral("carries_dependency"),
-        QStringLiteral("deprecated"),
-        QStringLiteral("fallthrough"),
-        QStringLiteral("nodiscard"),
-        QStringLiteral("maybe_unused"),
-        QStringLiteral("optimize_for_synchronized"),
-    };
+// attributes
+    "noreturn",
+    "carries_dependency",
+    "deprecated",
+    "fallthrough",
+    "nodiscard",
+    "maybe_unused",
+    "optimize_for_synchronized",
+});
+
+//
+// CLASSNAMES
+//
+
+constexpr auto classnames = makeKeywordTable({
+    "std",
+    "double_t",
+    "float_t",
+    "va_list",
+    "ptrdiff_t",
+    "max_align_t",
+    "nullptr_t",
+    "intmax_t",
+    "uintmax_t",
+    "int8_t",
+    "int16_t",
+    "int32_t",
+    "int64_t",
+    "uint8_t",
+    "uint16_t",
+    "uint32_t",
+    "uint64_t",
+    "int_least8_t",
+    "int_least16_t",
+    "int_least32_t",
+    "int_least64_t",
+    "uint_least8_t",
+    "uint_least16_t",
+    "uint_least32_t",
+    "uint_least64_t",
+    "int_fast8_t",
+    "int_fast16_t",
+    "int_fast32_t",
+    "int_fast64_t",
+    "uint_fast8_t",
+    "uint_fast16_t",
+    "uint_fast32_t",
+    "uint_fast64_t",
+    "intptr_t",
+    "uintptr_t",
+    "FILE",
+    "fpos_t",
+    "size_t",
+    "div_t",
+    "ldiv_t",
+    "lldiv_t",
+    "clock_t",
+    "time_t",
+    "tm",
+    "char16_t",
+    "char32_t",
+    "mbstate_t",
+    "wchar_t",
+    "wint_t",
+    "wctrans_t",
+    "wctype_t",
+    "array",
+    "deque",
+    "forward_list",
+    "list",
+    "map",
+    "multimap",
+    "unordered_map",
+    "unordered_multimap",
+    "queue",
+    "priority_queue",
+    "set",
+    "multiset",
+    "unordered_set",
+    "unordered_multiset",
+    "stack",
+    "vector",
+    "basic_ifstream",
+    "basic_ofstream",
+    "basic_fstream",
+    "basic_filebuf",
+    "ifstream",
+    "ofstream",
+    "fstream",
+    "filebuf",
+    "wifstream",
+    "wofstream",
+    "wfstream",
+    "wfilebuf",
+    "basic_ios",
+    "fpos",
+    "ios",
+    "ios_base",
+    "wios",
+    "io_errc",
+    "streamoff",
+    "streampos",
+    "streamsize",
+    "wstreampos",
+    "cin",
+    "cout",
+    "cerr",
+    "clog",
+    "wcin",
+    "wcout",
+    "wcerr",
+    "wclog",
+    "istream",
+    "iostream",
+    "wistream",
+    "wiostream",
+    "ostream",
+    "wostream",
+    "endl",
+    "ends",
+    "flush",
+    "basic_istringstream",
+    "basic_ostringstream",
+    "basic_stringstream",
+    "basic_stringbuf",
+    "istringstream",
+    "ostringstream",
+    "stringstream",
+    "stringbuf",
+    "wistringstream",
+    "wostringstream",
+    "wstringstream",
+    "wstringbuf",
+    "basic_streambuf",
+    "streambuf",
+    "wstreambuf",
+    "atomic",
+    "atomic_flag",
+    "memory_order",
+    "condition_variable",
+    "condition_variable_any",
+    "cv_status",
+    "promise",
+    "packaged_task",
+    "future",
+    "shared_future",
+    "future_error",
+    "future_errc",
+    "future_status",
+    "launch",
+    "mutex",
+    "recursive_mutex",
+    "timed_mutex",
+    "recursive_timed_mutex",
+    "lock_guard",
+    "unique_lock",
+    "once_flag",
+    "adopt_lock_t",
+    "defer_lock_t",
+    "try_to_lock_t",
+    "thread",
+    "this_thread",
+    "bitset",
+    "duration",
+    "time_point",
+    "system_clock",
+    "steady_clock",
+    "high_resolution_clock",
+    "hours",
+    "minutes",
+    "seconds",
+    "milliseconds",
+    "microseconds",
+    "nanoseconds",
+    "complex",
+    "exception",
+    "bad_exception",
+    "nested_exception",
+    "exception_ptr",
+    "terminate_handler",
+    "unexpected_handler",
+    "initializer_list",
+    "iterator",
+    "numeric_limits",
+    "locale",
+    "auto_ptr",
+    "auto_ptr_ref",
+    "shared_ptr",
+    "weak_ptr",
+    "unique_ptr",
+    "default_delete",
+    "ratio",
+    "regex",
+    "basic_string",
+    "string",
+    "u16string",
+    "u32string",
+    "wstring",
+    "tuple",
+    "tuple_size",
+    "tuple_element",
+    "type_index",
+    "type_info",
+    "bad_cast",
+    "bad_typeid",
+    "pair",
+    "valarray",
+    "slice",
+    "gslice",
+    "slice_array",
+    "gslice_array",
+    "mask_array",
+    "indirect_array",
+    "string_view",
+    "wstring_view",
+    "u16string_view",
+    "u32string_view",
+    "any",
+    "optional",
+    "variant",
+    "byte",
+    "path",
+    "filesystem_error",
+    "directory_entry",
+    "directory_iterator",
+    "recursive_directory_iterator",
+    "file_status",
+    "space_info",
+    "file_type",
+    "perms",
+    "perm_options",
+    "copy_options",
+    "directory_options",
+    "file_time_type",
+});
 
-    //
-    // CLASSNAMES
-    //
+} // namespace
 
-    m_classnames = QStringList {
-        QStringLiteral("std"),
-        QStringLiteral("double_t"),
-        QStringLiteral("float_t"),
-        QStringLiteral("va_list"),
-        QStringLiteral("ptrdiff_t"),
-        QStringLiteral("max_align_t"),
-        QStringLiteral("nullptr_t"),
-        QStringLiteral("intmax_t"),
-        QStringLiteral("uintmax_t"),
-        QStringLiteral("int8_t"),
-        QStringLiteral("int16_t"),
-        QStringLiteral("int32_t"),
-        QStringLiteral("int64_t"),
-        QStringLiteral("uint8_t"),
-        QStringLiteral("uint16_t"),
-        QStringLiteral("uint32_t"),
-        QStringLiteral("uint64_t"),
-        QStringLiteral("int_least8_t"),
-        QStringLiteral("int_least16_t"),
-        QStringLiteral("int_least32_t"),
-        QStringLiteral("int_least64_t"),
-        QStringLiteral("uint_least8_t"),
-        QStringLiteral("uint_least16_t"),
-        QStringLiteral("uint_least32_t"),
-        QStringLiteral("uint_least64_t"),
-        QStringLiteral("int_fast8_t"),
-        QStringLiteral("int_fast16_t"),
-        QStringLiteral("int_fast32_t"),
-        QStringLiteral("int_fast64_t"),
-        QStringLiteral("uint_fast8_t"),
-        QStringLiteral("uint_fast16_t"),
-        QStringLiteral("uint_fast32_t"),
-        QStringLiteral("uint_fast64_t"),
-        QStringLiteral("intptr_t"),
-        QStringLiteral("uintptr_t"),
-        QStringLiteral("FILE"),
-        QStringLiteral("fpos_t"),
-        QStringLiteral("size_t"),
-        QStringLiteral("div_t"),
-        QStringLiteral("ldiv_t"),
-        QStringLiteral("lldiv_t"),
-        QStringLiteral("clock_t"),
-        QStringLiteral("time_t"),
-        QStringLiteral("tm"),
-        QStringLiteral("char16_t"),
-        QStringLiteral("char32_t"),
-        QStringLiteral("mbstate_t"),
-        QStringLiteral("wchar_t"),
-        QStringLiteral("wint_t"),
-        QStringLiteral("wctrans_t"),
-        QStringLiteral("wctype_t"),
-        QStringLiteral("array"),
-        QStringLiteral("deque"),
-        QStringLiteral("forward_list"),
-        QStringLiteral("list"),
-        QStringLiteral("map"),
-        QStringLiteral("multimap"),
-        QStringLiteral("unordered_map"),
-        QStringLiteral("unordered_multimap"),
-        QStringLiteral("queue"),
-        QStringLiteral("priority_queue"),
-        QStringLiteral("set"),
-        QStringLiteral("multiset"),
-        QStringLiteral("unordered_set"),
-        QStringLiteral("unordered_multiset"),
-        QStringLiteral("stack"),
-        QStringLiteral("vector"),
-        QStringLiteral("basic_ifstream"),
-        QStringLiteral("basic_ofstream"),
-        QStringLiteral("basic_fstream"),
-        QStringLiteral("basic_filebuf"),
-        QStringLiteral("ifstream"),
-        QStringLiteral("ofstream"),
-        QStringLiteral("fstream"),
-        QStringLiteral("filebuf"),
-        QStringLiteral("wifstream"),
-        QStringLiteral("wofstream"),
-        QStringLiteral("wfstream"),
-        QStringLiteral("wfilebuf"),
-        QStringLiteral("basic_ios"),
-        QStringLiteral("fpos"),
-        QStringLiteral("ios"),
-        QStringLiteral("ios_base"),
-        QStringLiteral("wios"),
-        QStringLiteral("io_errc"),
-        QStringLiteral("streamoff"),
-        QStringLiteral("streampos"),
-        QStringLiteral("streamsize"),
-        QStringLiteral("wstreampos"),
-        QStringLiteral("cin"),
-        QStringLiteral("cout"),
-        QStringLiteral("cerr"),
-        QStringLiteral("clog"),
-        QStringLiteral("wcin"),
-        QStringLiteral("wcout"),
-        QStringLiteral("wcerr"),
-        QStringLiteral("wclog"),
-        QStringLiteral("istream"),
-        QStringLiteral("iostream"),
-        QStringLiteral("wistream"),
-        QStringLiteral("wiostream"),
-        QStringLiteral("ostream"),
-        QStringLiteral("wostream"),
-        QStringLiteral("endl"),
-        QStringLiteral("ends"),
-        QStringLiteral("flush"),
-        QStringLiteral("basic_istringstream"),
-        QStringLiteral("basic_ostringstream"),
-        QStringLiteral("basic_stringstream"),
-        QStringLiteral("basic_stringbuf"),
-        QStringLiteral("istringstream"),
-        QStringLiteral("ostringstream"),
-        QStringLiteral("stringstream"),
-        QStringLiteral("stringbuf"),
-        QStringLiteral("wistringstream"),
-        QStringLiteral("wostringstream"),
-        QStringLiteral("wstringstream"),
-        QStringLiteral("wstringbuf"),
-        QStringLiteral("basic_streambuf"),
-        QStringLiteral("streambuf"),
-        QStringLiteral("wstreambuf"),
-        QStringLiteral("atomic"),
-        QStringLiteral("atomic_flag"),
-        QStringLiteral("memory_order"),
-        QStringLiteral("condition_variable"),
-        QStringLiteral("condition_variable_any"),
-        QStringLiteral("cv_status"),
-        QStringLiteral("promise"),
-        QStringLiteral("packaged_task"),
-        QStringLiteral("future"),
-        QStringLiteral("shared_future"),
-        QStringLiteral("future_error"),
-        QStringLiteral("future_errc"),
-        QStringLiteral("future_status"),
-        QStringLiteral("launch"),
-        QStringLiteral("mutex"),
-        QStringLiteral("recursive_mutex"),
-        QStringLiteral("timed_mutex"),
-        QStringLiteral("recursive_timed_mutex"),
-        QStringLiteral("lock_guard"),
-        QStringLiteral("unique_lock"),
-        QStringLiteral("once_flag"),
-        QStringLiteral("adopt_lock_t"),
-        QStringLiteral("defer_lock_t"),
-        QStringLiteral("try_to_lock_t"),
-        QStringLiteral("thread"),
-        QStringLiteral("this_thread"),
-        QStringLiteral("bitset"),
-        QStringLiteral("duration"),
-        QStringLiteral("time_point"),
-        QStringLiteral("system_clock"),
-        QStringLiteral("steady_clock"),
-        QStringLiteral("high_resolution_clock"),
-        QStringLiteral("hours"),
-        QStringLiteral("minutes"),
-        QStringLiteral("seconds"),
-        QStringLiteral("milliseconds"),
-        QStringLiteral("microseconds"),
-        QStringLiteral("nanoseconds"),
-        QStringLiteral("complex"),
-        QStringLiteral("exception"),
-        QStringLiteral("bad_exception"),
-        QStringLiteral("nested_exception"),
-        QStringLiteral("exception_ptr"),
-        QStringLiteral("terminate_handler"),
-        QStringLiteral("unexpected_handler"),
-        QStringLiteral("initializer_list"),
-        QStringLiteral("iterator"),
-        QStringLiteral("numeric_limits"),
-        QStringLiteral("locale"),
-        QStringLiteral("auto_ptr"),
-        QStringLiteral("auto_ptr_ref"),
-        QStringLiteral("shared_ptr"),
-        QStringLiteral("weak_ptr"),
-        QStringLiteral("unique_ptr"),
-        QStringLiteral("default_delete"),
-        QStringLiteral("ratio"),
-        QStringLiteral("regex"),
-        QStringLiteral("basic_string"),
-        QStringLiteral("string"),
-        QStringLiteral("u16string"),
-        QStringLiteral("u32string"),
-        QStringLiteral("wstring"),
-        QStringLiteral("tuple"),
-        QStringLiteral("tuple_size"),
-        QStringLiteral("tuple_element"),
-        QStringLiteral("type_index"),
-        QStringLiteral("type_info"),
-        QStringLiteral("bad_cast"),
-        QStringLiteral("bad_typeid"),
-        QStringLiteral("pair"),
-        QStringLiteral("valarray"),
-        QStringLiteral("slice"),
-        QStringLiteral("gslice"),
-        QStringLiteral("slice_array"),
-        QStringLiteral("gslice_array"),
-        QStringLiteral("mask_array"),
-        QStringLiteral("indirect_array"),
-        QStringLiteral("string_view"),
-        QStringLiteral("wstring_view"),
-        QStringLiteral("u16string_view"),
-        QStringLiteral("u32string_view"),
-        QStringLiteral("any"),
-        QStringLiteral("optional"),
-        QStringLiteral("variant"),
-        QStringLiteral("byte"),
-        QStringLiteral("path"),
-        QStringLiteral("filesystem_error"),
-        QStringLiteral("directory_entry"),
-        QStringLiteral("directory_iterator"),
-        QStringLiteral("recursive_directory_iterator"),
-        QStringLiteral("file_status"),
-        QStringLiteral("space_info"),
-        QStringLiteral("file_type"),
-        QStringLiteral("perms"),
-        QStringLiteral("perm_options"),
-        QStringLiteral("copy_options"),
-        QStringLiteral("directory_options"),
-        QStringLiteral("file_time_type"),
+const CLikeHighlighter::Grammar &CppHighlighter::grammar()
+{
+    static const Grammar instance {
+        defaultFormats(),
+        keywords,
+        classnames,
+        ppDirectives,
+        false,
+        RawStrings::Cpp,
     };
+    return instance;
+}
+
+CppHighlighter::CppHighlighter(QTextDocument *parent)
+    : CLikeHighlighter(grammar(), parent)
+{
 }
 
 } // namespace aske
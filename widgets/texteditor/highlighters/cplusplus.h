@@ -15,6 +15,9 @@ class CppHighlighter : public CLikeHighlighter
 
 public:
     CppHighlighter(QTextDocument *parent = 0);
+
+protected:
+    static const Grammar &grammar();
 };
 
 } // namespace aske
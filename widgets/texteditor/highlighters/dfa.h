@@ -0,0 +1,221 @@
+#ifndef DFA_H
+#define DFA_H
+
+#include "keywords.h"
+#include <QStringView>
+
+namespace aske {
+
+/*!
+ * @brief Tables of grammars compiled by `grammarc` and their interpreter.
+ *
+ * @details
+ * Grammar files (`texteditor/grammars/ *.xml`) are compiled at build time
+ * into one deterministic automaton per context. Lexing is a table walk
+ * with Kate semantics: at every position the first rule of the context
+ * which matches wins and takes it's longest match, characters not matched
+ * by any rule get the context's attribute. No regular expression is
+ * evaluated at runtime.
+ */
+namespace Dfa {
+
+//! Kate default styles
+enum class Style : quint8 {
+    Normal, Keyword, ControlFlow, Operator, BuiltIn, Variable,
+    Extension, Preprocessor, Attribute, DataType, DecVal, BaseN,
+    Float, Constant, Char, SpecialChar, String, VerbatimString,
+    SpecialString, Import, Comment, Documentation, Annotation,
+    CommentVar, RegionMarker, Information, Warning, Alert,
+    Function, Others, Error,
+};
+
+constexpr int StyleCount = static_cast<int>(Style::Error) + 1;
+
+//! Context switch: pop `pops` contexts then push `push` (if not -1)
+struct Action {
+    qint16 pops;
+    qint16 push;
+};
+
+struct Rule {
+    qint16 attribute;
+    qint16 keywords;    //! keyword list of `keyword` rule, -1 for others
+    qint16 nextKeyword; //! next `keyword` rule of the context or -1
+    Action action;
+};
+
+struct Context {
+    const quint16 *transitions; //! [state * classCount + class], state 0 is dead
+    const qint16 *accepts;      //! rule accepted in state or -1
+    const qint16 *fallbacks;    //! non-keyword rule accepted in state or -1
+    const Rule *rules;
+    qint16 attribute;
+    Action lineEnd;
+};
+
+struct Grammar {
+    const char *name;
+    const quint8 *classes;      //! symbol class of ASCII code units, [128] is non-ASCII
+    int classCount;
+    const Context *contexts;
+    int contextCount;
+    const KeywordSet *lists;
+    const Style *styles;        //! style of every attribute
+    int attributeCount;
+};
+
+/*!
+ * @brief Context stack packed into a block state.
+ *
+ * @details
+ * The root context is implicit, up to 3 nested contexts are kept
+ * (a byte each) and their count is in bits 24-25. Pushing onto a full
+ * stack forgets the outermost nested context.
+ */
+class ContextStack
+{
+public:
+    static constexpr int MaxDepth = 3;
+
+    explicit ContextStack(int state) {
+        if(state > 0) {
+            m_depth = (state >> 24) & 3;
+            for(int i = 0; i < m_depth; ++i) {
+                m_items[i] = (state >> (8 * i)) & 0xFF;
+            }
+        }
+    }
+
+    int state() const {
+        int state = m_depth << 24;
+        for(int i = 0; i < m_depth; ++i) {
+            state |= m_items[i] << (8 * i);
+        }
+        return state;
+    }
+
+    int top() const { return m_depth ? m_items[m_depth - 1] : 0; }
+
+    void apply(const Action &action) {
+        m_depth = action.pops < m_depth ? m_depth - action.pops : 0;
+        if(action.push < 0) {
+            return;
+        }
+        if(m_depth == MaxDepth) {
+            m_items[0] = m_items[1];
+            m_items[1] = m_items[2];
+            --m_depth;
+        }
+        m_items[m_depth++] = action.push;
+    }
+
+private:
+    int m_items[MaxDepth] {};
+    int m_depth {0};
+};
+
+/*!
+ * @brief Lex one line of `text`.
+ *
+ * @details
+ * `state` is the state of the previous line (-1 for none). Calls
+ * `report(start, length, attribute)` for every run of characters having
+ * the same attribute and returns the state of this line.
+ */
+template<class Report>
+int lex(const Grammar &grammar, QStringView text, int state, Report report)
+{
+    ContextStack stack(state);
+    const qsizetype length = text.size();
+
+    qsizetype runStart = 0;
+    qsizetype runEnd = 0;
+    int runAttribute = -1;
+    auto run = [&](qsizetype start, qsizetype end, int attribute) {
+        if(attribute == runAttribute && start == runEnd) {
+            runEnd = end;
+            return;
+        }
+        if(runAttribute >= 0) {
+            report(runStart, runEnd - runStart, runAttribute);
+        }
+        runStart = start;
+        runEnd = end;
+        runAttribute = attribute;
+    };
+
+    qsizetype i = 0;
+    while(i < length) {
+        const Context &context = grammar.contexts[stack.top()];
+
+        // one walk finds the first rule (in grammar order) which matches
+        // here and it's longest match, plus the same for non-keyword rules
+        int rule = -1;
+        int fallback = -1;
+        qsizetype end = i;
+        qsizetype fallbackEnd = i;
+        int s = 1;
+        for(qsizetype j = i; j < length; ++j) {
+            const char16_t c = text[j].unicode();
+            s = context.transitions[s * grammar.classCount + grammar.classes[c < 128 ? c : 128]];
+            if(s == 0) {
+                break;
+            }
+            const int accept = context.accepts[s];
+            if(accept >= 0 && (rule < 0 || accept <= rule)) {
+                rule = accept;
+                end = j + 1;
+            }
+            const int nonKeyword = context.fallbacks[s];
+            if(nonKeyword >= 0 && (fallback < 0 || nonKeyword <= fallback)) {
+                fallback = nonKeyword;
+                fallbackEnd = j + 1;
+            }
+        }
+
+        if(rule < 0) {
+            run(i, i + 1, context.attribute);
+            ++i;
+            continue;
+        }
+
+        // all keyword rules match the same words: first list having the
+        // word wins unless a non-keyword rule comes before it
+        const QStringView word = text.mid(i, end - i);
+        const Rule *matched = nullptr;
+        for(int r = rule; r >= 0; r = context.rules[r].nextKeyword) {
+            if(fallback >= 0 && fallback < r) {
+                break;
+            }
+            if(context.rules[r].keywords < 0 || grammar.lists[context.rules[r].keywords].contains(word)) {
+                matched = &context.rules[r];
+                break;
+            }
+        }
+        if(!matched && fallback >= 0) {
+            matched = &context.rules[fallback];
+            end = fallbackEnd;
+        }
+
+        if(!matched) {
+            run(i, end, context.attribute);
+        } else {
+            run(i, end, matched->attribute);
+            stack.apply(matched->action);
+        }
+        i = end;
+    }
+
+    if(runAttribute >= 0) {
+        report(runStart, runEnd - runStart, runAttribute);
+    }
+
+    stack.apply(grammar.contexts[stack.top()].lineEnd);
+    return stack.state();
+}
+
+} // namespace Dfa
+
+} // namespace aske
+
+#endif // DFA_H
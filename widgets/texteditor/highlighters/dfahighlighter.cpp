@@ -0,0 +1,71 @@
+#include "dfahighlighter.h"
+
+namespace aske {
+
+DfaHighlighter::DfaHighlighter(const Dfa::Grammar &grammar, QTextDocument *parent)
+    : Highlighter(styleFormats(), parent)
+    , m_grammar(grammar)
+{
+}
+
+const Highlighter::Formats &DfaHighlighter::styleFormats()
+{
+    static const Formats instance = [] {
+        using Dfa::Style;
+
+        Formats formats(Dfa::StyleCount);
+        auto color = [&](Style style, const QColor &color) {
+            formats[static_cast<int>(style)].setForeground(color);
+        };
+
+        // same palette as hand written highlighters
+        color(Style::Keyword, QColor(0, 0, 255));
+        color(Style::ControlFlow, QColor(0, 0, 255));
+        color(Style::BuiltIn, QColor(30, 130, 160));
+        color(Style::DataType, QColor(30, 130, 160));
+        color(Style::Variable, QColor(85, 140, 46));
+        color(Style::Extension, QColor(30, 130, 160));
+        color(Style::Preprocessor, QColor(100, 100, 100));
+        color(Style::Attribute, QColor(120, 120, 255));
+        color(Style::DecVal, QColor(0, 0, 170));
+        color(Style::BaseN, QColor(0, 0, 170));
+        color(Style::Float, QColor(0, 0, 170));
+        color(Style::Constant, QColor(0, 0, 170));
+        color(Style::Char, Qt::darkGreen);
+        color(Style::SpecialChar, QColor(0, 103, 124));
+        color(Style::String, Qt::darkGreen);
+        color(Style::VerbatimString, Qt::darkGreen);
+        color(Style::SpecialString, QColor(0, 103, 124));
+        color(Style::Import, QColor(100, 100, 100));
+        color(Style::Comment, Qt::darkGreen);
+        color(Style::Documentation, Qt::darkGreen);
+        color(Style::Annotation, QColor(100, 100, 100));
+        color(Style::CommentVar, QColor(30, 130, 160));
+        color(Style::RegionMarker, QColor(100, 100, 100));
+        color(Style::Information, QColor(30, 130, 160));
+        color(Style::Warning, Qt::darkRed);
+        color(Style::Alert, Qt::red);
+        color(Style::Function, Qt::darkMagenta);
+        color(Style::Others, QColor(0, 103, 124));
+        color(Style::Error, Qt::red);
+
+        formats[static_cast<int>(Style::ControlFlow)].setFontWeight(QFont::Bold);
+        formats[static_cast<int>(Style::Alert)].setFontWeight(QFont::Bold);
+        formats[static_cast<int>(Style::Error)].setFontUnderline(true);
+
+        return formats;
+    }();
+    return instance;
+}
+
+int DfaHighlighter::lexBlock(const QString &text, int previousState)
+{
+    return Dfa::lex(m_grammar, text, previousState, [&](qsizetype start, qsizetype length, int attribute) {
+        const Dfa::Style style = m_grammar.styles[attribute];
+        if(style != Dfa::Style::Normal) {
+            addRun(static_cast<int>(start), static_cast<int>(length), style);
+        }
+    });
+}
+
+} // namespace aske
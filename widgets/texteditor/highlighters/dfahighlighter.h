@@ -0,0 +1,40 @@
+#ifndef DFA_HIGHLIGHTER_H
+#define DFA_HIGHLIGHTER_H
+
+#include "highlighter.h"
+#include "dfa.h"
+#include <QTextCharFormat>
+#include <QVector>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+namespace aske {
+
+/*!
+ * @brief Highlighter driven by a grammar compiled at build time.
+ *
+ * @details
+ * Context stack of the grammar is kept in the block state, so multi-line
+ * constructs (block comments, heredocs, CDATA) continue into next blocks.
+ */
+class DfaHighlighter : public Highlighter
+{
+    Q_OBJECT
+
+public:
+    DfaHighlighter(const Dfa::Grammar &grammar, QTextDocument *parent = 0);
+
+protected:
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
+
+    /*! Formats of Kate default styles, indexed by `Dfa::Style`. */
+    static const Formats &styleFormats();
+
+    const Dfa::Grammar &m_grammar;
+};
+
+} // namespace aske
+
+#endif // DFA_HIGHLIGHTER_H
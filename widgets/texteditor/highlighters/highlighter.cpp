@@ -0,0 +1,273 @@
+#include "highlighter.h"
+
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+
+#include <algorithm>
+
+namespace aske {
+
+Highlighter::Highlighter(const Formats &formats, QTextDocument *parent)
+    : QSyntaxHighlighter(parent)
+    , m_formats(formats)
+{
+    m_idleTimer.setSingleShot(true);
+    m_idleTimer.setInterval(0);
+    connect(&m_idleTimer, &QTimer::timeout, this, &Highlighter::highlightPending);
+}
+
+QVector<Highlighter::Token> Highlighter::tokens(const QTextBlock &block)
+{
+    auto data = static_cast<BlockData *>(block.userData());
+    if(!data || data->pending) {
+        return {};
+    }
+    return data->tokens;
+}
+
+QVector<Highlighter::Token> Highlighter::lexLine(const QString &text, int &state)
+{
+    QVector<Token> tokens;
+
+    m_runs.clear();
+    state = lexBlock(text, state);
+    storeTokens(text, tokens);
+    m_runs.clear();
+
+    return tokens;
+}
+
+void Highlighter::setVisibleBlocks(int first, int last)
+{
+    m_firstVisible = first;
+    m_lastVisible = last;
+
+    if(hasPendingBlocks()) {
+        m_idleTimer.start();
+    }
+}
+
+void Highlighter::setSuspended(bool suspended)
+{
+    m_suspended = suspended;
+
+    if(!m_suspended && hasPendingBlocks()) {
+        m_idleTimer.start();
+    }
+}
+
+bool Highlighter::isVisible(int blockNumber) const
+{
+    return blockNumber >= m_firstVisible && blockNumber <= m_lastVisible;
+}
+
+void Highlighter::markPending(int blockNumber)
+{
+    if(m_firstPending < 0 || blockNumber < m_firstPending) {
+        m_firstPending = blockNumber;
+    }
+}
+
+void Highlighter::addRun(int start, int length, int format)
+{
+    if(length <= 0) {
+        return;
+    }
+
+    if(!m_runs.isEmpty()) {
+        Run &last = m_runs.last();
+        if(last.format == format && last.start + last.length == start) {
+            last.length += length;
+            return;
+        }
+    }
+    m_runs.append({start, length, format});
+}
+
+void Highlighter::storeTokens(const QString &text, QVector<Token> &tokens)
+{
+    tokens.clear();
+
+    // runs are disjoint unless one overrides another (e.g. Rust macros),
+    // then the last run wins for every character
+    bool disjoint = true;
+    for(int i = 1; i < m_runs.size() && disjoint; ++i) {
+        disjoint = m_runs[i].start >= m_runs[i - 1].start + m_runs[i - 1].length;
+    }
+
+    QVarLengthArray<Run, 64> flat;
+    if(!disjoint) {
+        QVarLengthArray<int, 256> kinds(text.size());
+        std::fill(kinds.begin(), kinds.end(), -1);
+        for(const Run &run : m_runs) {
+            const int start = qMin(run.start, static_cast<int>(text.size()));
+            const int end = qMin(run.start + run.length, static_cast<int>(text.size()));
+            std::fill(kinds.begin() + start, kinds.begin() + end, run.format);
+        }
+        for(int i = 0; i < kinds.size();) {
+            int j = i + 1;
+            while(j < kinds.size() && kinds[j] == kinds[i]) {
+                ++j;
+            }
+            if(kinds[i] >= 0) {
+                flat.append({i, j - i, kinds[i]});
+            }
+            i = j;
+        }
+    }
+    const QVarLengthArray<Run, 64> &runs = disjoint ? m_runs : flat;
+
+    auto addBrackets = [&](int from, int to) {
+        for(int i = from; i < to; ++i) {
+            switch(text.at(i).unicode()) {
+            case '(': case ')': case '[': case ']': case '{': case '}':
+                tokens.append({i, 1, Token::Bracket});
+                break;
+            default:
+                break;
+            }
+        }
+    };
+
+    int end = 0;
+    for(const Run &run : runs) {
+        addBrackets(end, run.start);
+        tokens.append({run.start, run.length, static_cast<qint16>(run.format)});
+        end = run.start + run.length;
+    }
+    addBrackets(end, static_cast<int>(text.size()));
+}
+
+bool Highlighter::restoreFromMemo(const QString &text, int previousState, BlockData *data)
+{
+    const MemoEntry *entry = m_memo.object({text, previousState});
+    if(!entry) {
+        ++m_memoMisses;
+        return false;
+    }
+
+    ++m_memoHits;
+    m_runs.append(entry->runs.constData(), entry->runs.size());
+    data->tokens = entry->tokens;
+    setCurrentBlockState(entry->state);
+    return true;
+}
+
+void Highlighter::applyRuns()
+{
+    for(const Run &run : m_runs) {
+        setFormat(run.start, run.length, m_formats.at(run.format));
+    }
+    m_runs.clear();
+}
+
+void Highlighter::highlightBlock(const QString &text)
+{
+    const int number = currentBlock().blockNumber();
+    BlockData *data = static_cast<BlockData *>(currentBlockUserData());
+
+    // first highlighted block of this event: start its time slice and
+    // let idle callback close the slice once we are back in event loop
+    if(!m_slice.isValid()) {
+        m_slice.start();
+        m_idleTimer.start();
+    }
+
+    // blocks were removed or inserted above watermark: move it back so
+    // idle pass does not miss shifted pending blocks
+    if(hasPendingBlocks() && number < m_firstPending) {
+        m_firstPending = number;
+    }
+
+    const bool forced = m_force || isVisible(number);
+    m_force = false;
+
+    if(!forced && (m_suspended || m_slice.elapsed() >= EventBudget)) {
+        // keep block state untouched: cascade stops here and
+        // will be continued from this block by idle pass
+        if(!data) {
+            data = new BlockData;
+            setCurrentBlockUserData(data);
+        }
+        data->pending = true;
+        markPending(number);
+
+        // formats not set here are removed, the block keeps its previous
+        // colors until the idle pass gets to it
+        for(const QTextLayout::FormatRange &range : currentBlock().layout()->formats()) {
+            setFormat(range.start, range.length, range.format);
+        }
+        return;
+    }
+
+    if(!data) {
+        data = new BlockData;
+        setCurrentBlockUserData(data);
+    }
+    data->pending = false;
+
+    m_runs.clear();
+    const int previousState = previousBlockState();
+    if(!restoreFromMemo(text, previousState, data)) {
+        const int state = lexBlock(text, previousState);
+        setCurrentBlockState(state);
+        storeTokens(text, data->tokens);
+        m_memo.insert({text, previousState},
+                      new MemoEntry {QVector<Run>(m_runs.cbegin(), m_runs.cend()), data->tokens, state});
+    }
+    applyRuns();
+
+    emit tokensChanged(currentBlock());
+}
+
+void Highlighter::highlightPending()
+{
+    m_slice.invalidate();
+
+    QTextDocument *doc = document();
+    if(!doc || !hasPendingBlocks() || m_suspended) {
+        return;
+    }
+
+    auto isPending = [](const QTextBlock &block) {
+        auto data = static_cast<BlockData *>(block.userData());
+        return data && data->pending;
+    };
+
+    const int from = m_firstPending;
+    m_firstPending = -1;
+    m_slice.start();
+
+    // visible blocks first
+    QTextBlock block = doc->findBlockByNumber(m_firstVisible);
+    while(block.isValid() && block.blockNumber() <= m_lastVisible) {
+        if(isPending(block)) {
+            m_force = true;
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+
+    // then everything else, starting from the lowest pending block
+    block = doc->findBlockByNumber(from);
+    while(block.isValid()) {
+        if(m_slice.elapsed() >= IdleBudget) {
+            markPending(block.blockNumber());
+            break;
+        }
+        if(isPending(block)) {
+            m_force = true;
+            rehighlightBlock(block);
+        }
+        block = block.next();
+    }
+
+    m_slice.invalidate();
+
+    if(hasPendingBlocks()) {
+        m_idleTimer.start();
+    }
+}
+
+} // namespace aske
@@ -0,0 +1,223 @@
+#ifndef HIGHLIGHTER_H
+#define HIGHLIGHTER_H
+
+#include <QCache>
+#include <QHash>
+#include <QSyntaxHighlighter>
+#include <QTextBlock>
+#include <QTextBlockUserData>
+#include <QTextCharFormat>
+#include <QVarLengthArray>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <initializer_list>
+#include <utility>
+
+QT_BEGIN_NAMESPACE
+class QTextDocument;
+QT_END_NAMESPACE
+
+namespace aske {
+
+/*!
+ * @brief Base class for all aske highlighters.
+ *
+ * @details
+ * Lexing of a single block is delegated to `lexBlock()`, the base class only
+ * decides *when* a block gets lexed:
+ *  - blocks inside the visible range are always highlighted immediately;
+ *  - other blocks are highlighted until the time budget of the current event
+ *    is exhausted. The rest is marked as pending and finished later in small
+ *    time-sliced batches from idle callbacks.
+ *
+ * A postponed block keeps its previous state, so a big state cascade (e.g. a
+ * comment opened at the top of a file) stops at the budget and continues in
+ * the next idle batch instead of blocking a keystroke.
+ *
+ * Lexers report formatting through `addRun()`. Runs refer to formats by
+ * number, which is an index in the highlighter's flat `Formats` array.
+ *
+ * The result of every lexing pass is also kept in the block as a token
+ * array, see `tokens()`. Bracket matching, word navigation or a minimap read
+ * it instead of lexing the text again.
+ *
+ * Lexing results are memoized by (block text, previous state). When a state
+ * change is reverted (e.g. `/*` typed and removed) the blocks it touched are
+ * restored from the memo instead of being lexed twice.
+ */
+class Highlighter : public ::QSyntaxHighlighter
+{
+    Q_OBJECT
+
+public:
+    //! Formats indexed by a highlighter's `HighlightElement`
+    using Formats = QVector<QTextCharFormat>;
+
+    //! Lexed token of a block
+    struct Token {
+        enum : qint16 {
+            Bracket = -1, //! `()[]{}` outside of any formatted run
+        };
+
+        int offset;
+        int length;
+        qint16 kind;  //! Format number or `Bracket`
+    };
+
+    Highlighter(const Formats &formats, QTextDocument *parent = 0);
+
+    /*! Tokens of `block`, ordered by offset and not overlapping.
+     *
+     * @details
+     * Tokens are replaced every time the block is lexed. A block which was
+     * edited but is still waiting for highlighting has no tokens.
+     */
+    static QVector<Token> tokens(const QTextBlock &block);
+
+    /*! Set range of block numbers currently shown by a viewport. */
+    void setVisibleBlocks(int first, int last);
+
+    /*! Lex only visible blocks while `suspended`.
+     *
+     * @details
+     * Other blocks changed meanwhile are marked pending and get highlighted
+     * in idle time once the highlighter is resumed. Used around big edits.
+     */
+    void setSuspended(bool suspended);
+
+    /*! Whether some blocks are still waiting for highlighting. */
+    bool hasPendingBlocks() const { return m_firstPending >= 0; }
+
+    /*! Lex one line without a document.
+     *
+     * @details
+     * Used for headless highlighting. `state` is the state of the previous
+     * line (-1 for the first one) and is replaced with the state of `text`.
+     * Returns tokens like `tokens()`, their kinds index `formats()`.
+     */
+    QVector<Token> lexLine(const QString &text, int &state);
+
+    /*! Formats indexed by `Token::kind`. */
+    const Formats &formats() const { return m_formats; }
+
+    static constexpr int MemoSize = 4096; //! Blocks kept in lexing memo
+
+    /*! Blocks restored from the lexing memo. */
+    quint64 memoHits() const { return m_memoHits; }
+
+    /*! Blocks lexed because the memo had no result for them. */
+    quint64 memoMisses() const { return m_memoMisses; }
+
+    /*! Reset `memoHits()` and `memoMisses()`. */
+    void resetMemoCounters() { m_memoHits = m_memoMisses = 0; }
+
+signals:
+    /*! Tokens of `block` were replaced. */
+    void tokensChanged(const QTextBlock &block);
+
+protected:
+    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE final;
+
+    /*! Lex block `text` and set it's formats.
+     *
+     * @details
+     * `previousState` is the state of the previous block (-1 if it has no
+     * state). Returns the state of the current block.
+     */
+    virtual int lexBlock(const QString &text, int previousState) = 0;
+
+    /*! Format `length` characters from `start` with `formats[format]`.
+     *
+     * @details
+     * Runs are collected while a block is lexed, a run adjacent to the
+     * previous one with the same format extends it. All runs are applied
+     * at once when `lexBlock()` returns, later runs override earlier ones.
+     */
+    void addRun(int start, int length, int format);
+
+    template<class Element>
+    void addRun(int start, int length, Element element) {
+        addRun(start, length, static_cast<int>(element));
+    }
+
+    /*! Build flat `Formats` array from element-format pairs. */
+    template<class Element>
+    static Formats makeFormats(std::initializer_list<std::pair<Element, QTextCharFormat>> formats) {
+        Formats result;
+        for(const auto &f : formats) {
+            const int index = static_cast<int>(f.first);
+            if(index >= result.size()) {
+                result.resize(index + 1);
+            }
+            result[index] = f.second;
+        }
+        return result;
+    }
+
+    //! Per-block data attached to every highlighted block
+    class BlockData : public QTextBlockUserData
+    {
+    public:
+        bool pending {false}; //! Block is waiting for idle-time highlighting
+        QVector<Token> tokens; //! Tokens of the last lexing pass
+    };
+
+private:
+    struct Run {
+        int start;
+        int length;
+        int format;
+    };
+
+    //! Key of lexing memo: lexer output depends only on these
+    struct MemoKey {
+        QString text;
+        int previousState;
+
+        bool operator==(const MemoKey &other) const {
+            return previousState == other.previousState && text == other.text;
+        }
+        friend size_t qHash(const MemoKey &key, size_t seed = 0) {
+            return qHashMulti(seed, key.text, key.previousState);
+        }
+    };
+
+    //! Memoized result of `lexBlock()`
+    struct MemoEntry {
+        QVector<Run> runs;
+        QVector<Token> tokens;
+        int state;
+    };
+
+    bool restoreFromMemo(const QString &text, int previousState, BlockData *data);
+
+    void applyRuns();
+    void storeTokens(const QString &text, QVector<Token> &tokens);
+    void highlightPending();
+    void markPending(int blockNumber);
+    bool isVisible(int blockNumber) const;
+
+    static constexpr qint64 EventBudget = 8; //! ms of highlighting per event
+    static constexpr qint64 IdleBudget = 8;  //! ms of highlighting per idle batch
+
+    const Formats &m_formats;
+    QVarLengthArray<Run, 64> m_runs;         //! Runs of the block being lexed
+
+    QCache<MemoKey, MemoEntry> m_memo {MemoSize};
+    quint64 m_memoHits {0};
+    quint64 m_memoMisses {0};
+
+    int m_firstVisible {0};
+    int m_lastVisible {-1};
+    int m_firstPending {-1}; //! Lowest block number which may be pending
+
+    bool m_force {false};    //! Highlight next block regardless of budget
+    bool m_suspended {false};
+    QElapsedTimer m_slice;   //! Time spent on highlighting in current event
+    QTimer m_idleTimer;
+};
+
+} // namespace aske
+
+#endif // HIGHLIGHTER_H
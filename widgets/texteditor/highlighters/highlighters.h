@@ -9,5 +9,6 @@
 #include "shell.h"
 #include "tab.h"
 #include "sql.h"
+#include "dfahighlighter.h"
 
 #endif // HIGHLIGHTERS_H
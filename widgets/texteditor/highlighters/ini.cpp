@@ -2,29 +2,51 @@
 
 namespace aske {
 
+const IniHighlighter::Grammar &IniHighlighter::grammar()
+{
+    static const Grammar instance = [] {
+        QTextCharFormat SectionFormat;
+        QTextCharFormat KeyFormat;
+        QTextCharFormat CommentFormat;
+
+        SectionFormat.setForeground(Qt::darkGreen);
+        KeyFormat.setForeground(QColor(120, 120, 255));
+        CommentFormat.setForeground(QColor(30, 130, 160));
+
+        Grammar grammar;
+        grammar.formats = makeFormats<HighlightElement>({
+            { HighlightElement::Section, SectionFormat },
+            { HighlightElement::Key, KeyFormat },
+            { HighlightElement::Comment, CommentFormat },
+        });
+
+        return grammar;
+    }();
+    return instance;
+}
+
 IniHighlighter::IniHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+    : Highlighter(grammar().formats, parent)
 {
-    m_sectionFormat.setForeground(Qt::darkGreen);
-    m_keyFormat.setForeground(QColor(120, 120, 255));
-    m_commentFormat.setForeground(QColor(30, 130, 160));
 }
 
-void IniHighlighter::highlightBlock(const QString &text)
+int IniHighlighter::lexBlock(const QString &text, int /* previousState */)
 {
     QStringView r(text);
     r = r.trimmed();
 
     if(r.startsWith('[')) {
-        setFormat(0, static_cast<int>(text.size()), m_sectionFormat);
+        addRun(0, static_cast<int>(text.size()), HighlightElement::Section);
     } else if(r.startsWith(';') || r.startsWith('#')) {
-        setFormat(0, static_cast<int>(text.size()), m_commentFormat);
+        addRun(0, static_cast<int>(text.size()), HighlightElement::Comment);
     } else {
         qsizetype i = text.indexOf('=');
         if(i != -1) {
-            setFormat(0, i+1, m_keyFormat);
+            addRun(0, i+1, HighlightElement::Key);
         }
     }
+
+    return -1;
 }
 
 } // aske
@@ -1,7 +1,7 @@
 #ifndef INI_HIGHLIGHTER_H
 #define INI_HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include "highlighter.h"
 #include <QTextCharFormat>
 
 QT_BEGIN_NAMESPACE
@@ -10,7 +10,7 @@ QT_END_NAMESPACE
 
 namespace aske {
 
-class IniHighlighter : public ::QSyntaxHighlighter
+class IniHighlighter : public Highlighter
 {
     Q_OBJECT
 
@@ -18,11 +18,20 @@ public:
     IniHighlighter(QTextDocument *parent = 0);
 
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
 
-    QTextCharFormat m_sectionFormat;
-    QTextCharFormat m_keyFormat;
-    QTextCharFormat m_commentFormat;
+    enum class HighlightElement {
+        Section,
+        Key,
+        Comment,
+    };
+
+    //! Immutable language data shared by all highlighters of a language
+    struct Grammar {
+        Formats formats;
+    };
+
+    static const Grammar &grammar();
 };
 
 
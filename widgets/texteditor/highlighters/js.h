@@ -15,6 +15,9 @@ class JSHighlighter : public CLikeHighlighter
 
 public:
     JSHighlighter(QTextDocument *parent = 0);
+
+protected:
+    static const Grammar &grammar();
 };
 
 } // namespace aske
@@ -0,0 +1,243 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <array>
+#include <cstddef>
+#include <string_view>
+#include <QStringView>
+
+namespace aske {
+
+namespace KeywordsPrivate {
+
+constexpr std::size_t nextPow2(std::size_t n) {
+    std::size_t p = 1;
+    while(p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+//! ASCII-only lower case folding.
+constexpr quint32 fold(quint32 c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+//! FNV-1a over code units. Same result for ASCII `char` and `char16_t` words.
+template<class Char>
+constexpr quint32 hash(const Char *s, std::size_t size, bool caseInsensitive) {
+    quint32 h = 2166136261u;
+    for(std::size_t i = 0; i < size; ++i) {
+        const quint32 c = static_cast<quint32>(s[i]);
+        h ^= caseInsensitive ? fold(c) : c;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+//! Mixes word hash `h` with bucket displacement `d` into slot hash.
+constexpr quint32 mix(quint32 h, quint32 d) {
+    h ^= d * 0x9E3779B9u;
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+    return h;
+}
+
+} // namespace KeywordsPrivate
+
+/*!
+ * @brief Non-owning view of a `KeywordTable`.
+ *
+ * @details
+ * Cheap to copy, so every highlighter instance can hold it by value.
+ * Default constructed view is an empty set.
+ */
+class KeywordSet
+{
+public:
+    constexpr KeywordSet() = default;
+    constexpr KeywordSet(const std::string_view *slots, const quint16 *displacement,
+                         quint32 slotMask, quint32 buckets, std::size_t maxLength,
+                         bool caseInsensitive)
+        : m_slots(slots)
+        , m_displacement(displacement)
+        , m_slotMask(slotMask)
+        , m_buckets(buckets)
+        , m_maxLength(maxLength)
+        , m_caseInsensitive(caseInsensitive)
+    {}
+
+    /*! Whether `word` is in set. Does not allocate. */
+    bool contains(QStringView word) const {
+        const std::size_t size = static_cast<std::size_t>(word.size());
+        if(!m_slots || size == 0 || size > m_maxLength) {
+            return false;
+        }
+
+        const quint32 h = KeywordsPrivate::hash(word.utf16(), size, m_caseInsensitive);
+        const quint32 d = m_displacement[h % m_buckets];
+        const std::string_view &key = m_slots[KeywordsPrivate::mix(h, d) & m_slotMask];
+
+        if(key.size() != size) {
+            return false;
+        }
+        for(std::size_t i = 0; i < size; ++i) {
+            quint32 c = word[static_cast<qsizetype>(i)].unicode();
+            quint32 k = static_cast<unsigned char>(key[i]);
+            if(m_caseInsensitive) {
+                c = KeywordsPrivate::fold(c);
+                k = KeywordsPrivate::fold(k);
+            }
+            if(c != k) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+private:
+    const std::string_view *m_slots {nullptr};
+    const quint16 *m_displacement {nullptr};
+    quint32 m_slotMask {0};
+    quint32 m_buckets {1};
+    std::size_t m_maxLength {0};
+    bool m_caseInsensitive {false};
+};
+
+/*!
+ * @brief Compile-time perfect hash table of ASCII words.
+ *
+ * @details
+ * Built by "hash and displace": words are distributed into buckets by
+ * their hash, then for every bucket (biggest first) a displacement is
+ * searched which puts all of it's words into free slots. Lookup costs one
+ * pass over the word, one table probe and one comparison.
+ *
+ * Duplicated words are a compile-time error. For `Qt::CaseInsensitive`
+ * tables words which differ only in ASCII case are duplicates too.
+ *
+ * Use `makeKeywordTable()` to create one:
+ * @code
+ * constexpr auto keywords = makeKeywordTable({"if", "else", "while"});
+ * @endcode
+ */
+template<std::size_t N>
+class KeywordTable
+{
+public:
+    static constexpr std::size_t Slots = KeywordsPrivate::nextPow2(N * 2);
+    static constexpr std::size_t Buckets = N / 2 + 1;
+
+    constexpr explicit KeywordTable(const std::string_view (&words)[N],
+                                    Qt::CaseSensitivity cs = Qt::CaseSensitive)
+        : m_caseInsensitive(cs == Qt::CaseInsensitive)
+    {
+        std::array<quint32, N> hashes {};
+        std::array<std::size_t, Buckets + 1> offsets {};
+        std::array<std::size_t, N> members {};
+        std::array<bool, Slots> used {};
+
+        for(std::size_t i = 0; i < N; ++i) {
+            hashes[i] = KeywordsPrivate::hash(words[i].data(), words[i].size(), m_caseInsensitive);
+            ++offsets[hashes[i] % Buckets + 1];
+            if(words[i].size() > m_maxLength) {
+                m_maxLength = words[i].size();
+            }
+        }
+
+        // counting sort of words by bucket
+        std::size_t maxBucket = 0;
+        for(std::size_t b = 0; b < Buckets; ++b) {
+            if(offsets[b + 1] > maxBucket) {
+                maxBucket = offsets[b + 1];
+            }
+            offsets[b + 1] += offsets[b];
+        }
+        {
+            std::array<std::size_t, Buckets> fill {};
+            for(std::size_t i = 0; i < N; ++i) {
+                const std::size_t b = hashes[i] % Buckets;
+                members[offsets[b] + fill[b]++] = i;
+            }
+        }
+
+        // place buckets, biggest first
+        for(std::size_t size = maxBucket; size > 0; --size) {
+            for(std::size_t b = 0; b < Buckets; ++b) {
+                const std::size_t begin = offsets[b];
+                const std::size_t end = offsets[b + 1];
+                if(end - begin != size) {
+                    continue;
+                }
+
+                for(std::size_t i = begin; i < end; ++i) {
+                    for(std::size_t j = begin; j < i; ++j) {
+                        if(hashes[members[i]] == hashes[members[j]]) {
+                            throw "KeywordTable: duplicated word or hash collision";
+                        }
+                    }
+                }
+
+                quint32 d = 1;
+                for(;; ++d) {
+                    if(d > 0xFFFF) {
+                        throw "KeywordTable: no displacement found";
+                    }
+
+                    bool fits = true;
+                    for(std::size_t i = begin; i < end && fits; ++i) {
+                        const std::size_t slot = KeywordsPrivate::mix(hashes[members[i]], d) & (Slots - 1);
+                        if(used[slot]) {
+                            fits = false;
+                        }
+                        for(std::size_t j = begin; j < i && fits; ++j) {
+                            if(slot == (KeywordsPrivate::mix(hashes[members[j]], d) & (Slots - 1))) {
+                                fits = false;
+                            }
+                        }
+                    }
+                    if(fits) {
+                        break;
+                    }
+                }
+
+                m_displacement[b] = static_cast<quint16>(d);
+                for(std::size_t i = begin; i < end; ++i) {
+                    const std::size_t slot = KeywordsPrivate::mix(hashes[members[i]], d) & (Slots - 1);
+                    used[slot] = true;
+                    m_slots[slot] = words[members[i]];
+                }
+            }
+        }
+    }
+
+    constexpr operator KeywordSet() const {
+        return KeywordSet(m_slots.data(), m_displacement.data(),
+                          static_cast<quint32>(Slots - 1), static_cast<quint32>(Buckets),
+                          m_maxLength, m_caseInsensitive);
+    }
+
+    bool contains(QStringView word) const {
+        return KeywordSet(*this).contains(word);
+    }
+
+private:
+    std::array<std::string_view, Slots> m_slots {};
+    std::array<quint16, Buckets> m_displacement {};
+    std::size_t m_maxLength {0};
+    bool m_caseInsensitive {false};
+};
+
+/*! Build `KeywordTable` from the list of words at compile time. */
+template<std::size_t N>
+constexpr KeywordTable<N> makeKeywordTable(const std::string_view (&words)[N],
+                                           Qt::CaseSensitivity cs = Qt::CaseSensitive) {
+    return KeywordTable<N>(words, cs);
+}
+
+} // namespace aske
+
+#endif // KEYWORDS_H
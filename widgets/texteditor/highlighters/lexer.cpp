@@ -0,0 +1,119 @@
+#include "lexer.h"
+
+#include <cstring>
+#include <QtAlgorithms>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ASKE_LEXER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace aske {
+
+namespace Lexer {
+
+#ifdef ASKE_LEXER_SSE2
+namespace {
+
+// lanes of `v` within [lo, hi], code units above 0x7FFF compare as negative
+inline __m128i inRange(__m128i v, short lo, short hi) {
+    return _mm_and_si128(_mm_cmpgt_epi16(v, _mm_set1_epi16(lo - 1)),
+                         _mm_cmplt_epi16(v, _mm_set1_epi16(hi + 1)));
+}
+
+// lanes of `v` which are ASCII characters of classes `mask`
+inline __m128i classify(__m128i v, quint8 mask) {
+    __m128i in = _mm_setzero_si128();
+    if(mask & Space) {
+        in = _mm_or_si128(in, _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16(' ')), inRange(v, '\t', '\r')));
+    }
+    if(mask & Digit) {
+        in = _mm_or_si128(in, inRange(v, '0', '9'));
+    }
+    if(mask & Letter) {
+        // ASCII letters differ from their lower case only by bit 5
+        const __m128i lower = _mm_or_si128(v, _mm_set1_epi16(0x20));
+        in = _mm_or_si128(in, inRange(lower, 'a', 'z'));
+    }
+    if(mask & Word) {
+        in = _mm_or_si128(in, _mm_or_si128(_mm_cmpeq_epi16(v, _mm_set1_epi16('_')),
+                                           _mm_cmpeq_epi16(v, _mm_set1_epi16('$'))));
+    }
+    return in;
+}
+
+inline __m128i load(const QChar *s) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i *>(s));
+}
+
+} // namespace
+#endif
+
+qsizetype skip(const QChar *s, qsizetype from, qsizetype size, quint8 mask)
+{
+    qsizetype i = from;
+    while(i < size) {
+#ifdef ASKE_LEXER_SSE2
+        while(i + 8 <= size) {
+            const int bits = _mm_movemask_epi8(classify(load(s + i), mask));
+            if(bits != 0xFFFF) {
+                i += qCountTrailingZeroBits(static_cast<quint32>(~bits)) / 2;
+                break;
+            }
+            i += 8;
+        }
+        if(i >= size) {
+            break;
+        }
+#endif
+        // ASCII miss ends the run, non-ASCII needs Unicode lookup
+        if(!(classOf(s[i].unicode()) & mask)) {
+            return i;
+        }
+        ++i;
+    }
+    return size;
+}
+
+qsizetype find(const QChar *s, qsizetype from, qsizetype size, char16_t a, char16_t b)
+{
+    qsizetype i = from;
+#ifdef ASKE_LEXER_SSE2
+    const __m128i va = _mm_set1_epi16(static_cast<short>(a));
+    const __m128i vb = _mm_set1_epi16(static_cast<short>(b));
+    for(; i + 8 <= size; i += 8) {
+        const __m128i v = load(s + i);
+        const int bits = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi16(v, va), _mm_cmpeq_epi16(v, vb)));
+        if(bits) {
+            return i + qCountTrailingZeroBits(static_cast<quint32>(bits)) / 2;
+        }
+    }
+#endif
+    for(; i < size; ++i) {
+        const char16_t c = s[i].unicode();
+        if(c == a || c == b) {
+            return i;
+        }
+    }
+    return size;
+}
+
+qsizetype find(const QChar *s, qsizetype from, qsizetype size, const char *needle)
+{
+    const qsizetype length = static_cast<qsizetype>(std::strlen(needle));
+    const char16_t first = static_cast<unsigned char>(needle[0]);
+    for(qsizetype i = find(s, from, size, first, first); i + length <= size; i = find(s, i + 1, size, first, first)) {
+        qsizetype k = 1;
+        while(k < length && s[i + k].unicode() == static_cast<unsigned char>(needle[k])) {
+            ++k;
+        }
+        if(k == length) {
+            return i;
+        }
+    }
+    return size;
+}
+
+} // namespace Lexer
+
+} // namespace aske
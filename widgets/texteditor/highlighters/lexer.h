@@ -0,0 +1,75 @@
+#ifndef LEXER_H
+#define LEXER_H
+
+#include <array>
+#include <QChar>
+
+namespace aske {
+
+/*!
+ * @brief Character classification and scanning helpers for hand-written lexers.
+ *
+ * @details
+ * ASCII code units are classified by a 128-entry table, only non-ASCII
+ * ones fall back to `QChar` Unicode lookups. Scanning functions process
+ * 8 code units at a time with SSE2 where it is available.
+ */
+namespace Lexer {
+
+enum Class : quint8 {
+    Space  = 0x01, //! `QChar::isSpace()`
+    Digit  = 0x02, //! `QChar::isDigit()`
+    Letter = 0x04, //! `QChar::isLetter()`
+    Word   = 0x08, //! `_` and `$`: identifier characters which are not letters or digits
+};
+
+namespace LexerPrivate {
+
+constexpr std::array<quint8, 128> makeAsciiClasses() {
+    std::array<quint8, 128> classes {};
+    for(int c = 0; c < 128; ++c) {
+        if(c == ' ' || (c >= '\t' && c <= '\r')) {
+            classes[c] = Space;
+        } else if(c >= '0' && c <= '9') {
+            classes[c] = Digit;
+        } else if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
+            classes[c] = Letter;
+        } else if(c == '_' || c == '$') {
+            classes[c] = Word;
+        }
+    }
+    return classes;
+}
+
+constexpr std::array<quint8, 128> asciiClasses = makeAsciiClasses();
+
+} // namespace LexerPrivate
+
+/*! Classes of code unit `c`. */
+inline quint8 classOf(char16_t c) {
+    if(c < 128) {
+        return LexerPrivate::asciiClasses[c];
+    }
+    const QChar ch(c);
+    return (ch.isSpace() ? Space : 0) | (ch.isDigit() ? Digit : 0) | (ch.isLetter() ? Letter : 0);
+}
+
+/*! Whether backslash followed by `c` is an escape in a C-like or Python string. */
+inline bool isEscape(char16_t c) {
+    return c == '\\' || c == '\'' || c == '"' || c == 'b' || c == 'r' || c == 'f' || c == 't' || c == 'v';
+}
+
+/*! Index of the first code unit in `[from, size)` having no class of `mask`, `size` if none. */
+qsizetype skip(const QChar *s, qsizetype from, qsizetype size, quint8 mask);
+
+/*! Index of the first `a` or `b` in `[from, size)`, `size` if none. */
+qsizetype find(const QChar *s, qsizetype from, qsizetype size, char16_t a, char16_t b);
+
+/*! Index of the first occurrence of ASCII `needle` in `[from, size)`, `size` if none. */
+qsizetype find(const QChar *s, qsizetype from, qsizetype size, const char *needle);
+
+} // namespace Lexer
+
+} // namespace aske
+
+#endif // LEXER_H
@@ -0,0 +1,71 @@
+#include "lexerstate.h"
+#include "lexer.h"
+
+#include <QStringView>
+
+namespace aske {
+
+namespace Lexer {
+
+qsizetype closeString(const QChar *s, qsizetype from, qsizetype size, State &state)
+{
+    const QString &delimiter = state.delimiter;
+    const char16_t close = delimiter.at(0).unicode();
+    const bool escapes = state.kind == State::String;
+
+    qsizetype i = from;
+    for(;;) {
+        i = find(s, i, size, close, escapes ? u'\\' : close);
+        if(i == size) {
+            return size;
+        }
+        if(escapes && s[i] == QLatin1Char('\\')) {
+            i = qMin(i + 2, size);
+            continue;
+        }
+        if(QStringView(s + i, size - i).startsWith(delimiter)) {
+            i += delimiter.size();
+            state = State();
+            return i;
+        }
+        ++i;
+    }
+}
+
+qsizetype closeComment(const QChar *s, qsizetype from, qsizetype size, State &state, bool nested)
+{
+    if(!nested) {
+        const qsizetype end = find(s, from, size, "*/");
+        if(end == size) {
+            return size;
+        }
+        state = State();
+        return end + 2;
+    }
+
+    qsizetype i = from;
+    for(;;) {
+        i = find(s, i, size, '*', '/');
+        if(i + 1 >= size) {
+            return size;
+        }
+        if(s[i] == QLatin1Char('*') && s[i + 1] == QLatin1Char('/')) {
+            i += 2;
+            if(--state.depth == 0) {
+                state = State();
+                return i;
+            }
+        } else if(s[i] == QLatin1Char('/') && s[i + 1] == QLatin1Char('*')) {
+            i += 2;
+            if(state.depth < 255) {
+                ++state.depth;
+            }
+        } else {
+            ++i;
+        }
+    }
+}
+
+} // namespace Lexer
+
+} // namespace aske
@@ -0,0 +1,105 @@
+#ifndef LEXERSTATE_H
+#define LEXERSTATE_H
+
+#include <QChar>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace aske {
+
+namespace Lexer {
+
+/*!
+ * @brief Full state of a hand-written lexer at the end of a block.
+ *
+ * @details
+ * Describes the construct which continues into the next block: nesting
+ * depth of a comment, closing delimiter of a raw or multi-line string.
+ */
+struct State {
+    enum Kind : quint8 {
+        Start,     //! Nothing continues
+        Comment,   //! Block comment, `depth` comments are open
+        String,    //! Multi-line string closed by `delimiter`, backslash escapes
+        RawString, //! Multi-line string closed by `delimiter`, no escapes
+    };
+
+    Kind kind {Start};
+    quint8 depth {0};
+    QString delimiter;
+
+    bool operator==(const State &other) const {
+        return kind == other.kind && depth == other.depth && delimiter == other.delimiter;
+    }
+
+    friend size_t qHash(const State &state, size_t seed = 0) {
+        return qHashMulti(seed, state.kind, state.depth, state.delimiter);
+    }
+};
+
+/*!
+ * @brief Interns `State`s, so a block state holds only a compact ID.
+ *
+ * @details
+ * Equal states always get the same ID, so `QSyntaxHighlighter` still stops
+ * a rehighlight cascade as soon as the block states converge. ID 0 is the
+ * `Start` state, unknown IDs (e.g. -1 of a never highlighted block) map to
+ * it too.
+ */
+class StateTable
+{
+public:
+    StateTable() {
+        m_states.append(State());
+        m_ids.insert(State(), 0);
+    }
+
+    /*! ID of `state`, interned on first use. */
+    int id(const State &state) {
+        if(state.kind == State::Start) {
+            return 0;
+        }
+        auto it = m_ids.constFind(state);
+        if(it != m_ids.cend()) {
+            return *it;
+        }
+        const int id = static_cast<int>(m_states.size());
+        m_states.append(state);
+        m_ids.insert(state, id);
+        return id;
+    }
+
+    /*! State interned with `id`. */
+    const State &state(int id) const {
+        return (id > 0 && id < static_cast<int>(m_states.size())) ? m_states.at(id) : m_states.at(0);
+    }
+
+private:
+    QVector<State> m_states;
+    QHash<State, int> m_ids;
+};
+
+/*! Scan string of `state` from `from` up to it's closing delimiter.
+ *
+ * @details
+ * Returns index after the delimiter and resets `state` to `Start`, or `size`
+ * if the string continues into the next block.
+ */
+qsizetype closeString(const QChar *s, qsizetype from, qsizetype size, State &state);
+
+/*! Scan C-style block comment of `state` from `from` up to it's end.
+ *
+ * @details
+ * With `nested` every comment opener inside increases `depth` and must be
+ * closed too.
+ * Returns index after the comment and resets `state` to `Start`, or `size`
+ * if the comment continues into the next block.
+ */
+qsizetype closeComment(const QChar *s, qsizetype from, qsizetype size, State &state, bool nested);
+
+} // namespace Lexer
+
+} // namespace aske
+
+#endif // LEXERSTATE_H
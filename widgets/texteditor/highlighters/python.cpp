@@ -1,208 +1,181 @@
 #include "python.h"
+#include "lexer.h"
 
 namespace aske {
 
-PythonHighlighter::PythonHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+namespace {
+
+//
+// KEYWORDS
+//
+
+constexpr auto keywords = makeKeywordTable({
+    "and",
+    "del",
+    "from",
+    "not",
+    "while",
+    "as",
+    "elif",
+    "global",
+    "or",
+    "with",
+    "assert",
+    "else",
+    "if",
+    "pass",
+    "yeld",
+    "break",
+    "except",
+    "import",
+    "print",
+    "class",
+    "exec",
+    "in",
+    "raise",
+    "continue",
+    "finally",
+    "is",
+    "return",
+    "def",
+    "for",
+    "lambda",
+    "try",
+    "None",
+    "True",
+    "False",
+});
+
+} // namespace
+
+const PythonHighlighter::Grammar &PythonHighlighter::grammar()
 {
-    QTextCharFormat KeywordFormat;
-    QTextCharFormat ClassnameFormat;
-    QTextCharFormat StringFormat;
-    QTextCharFormat CommentFormat;
-    QTextCharFormat LiteralFormat;
-
-    KeywordFormat.setForeground(QColor(0, 0, 255));
-    ClassnameFormat.setForeground(QColor(30, 130, 160));
-    StringFormat.setForeground(Qt::darkGreen);
-    CommentFormat.setForeground(Qt::darkGreen);
-    LiteralFormat.setForeground(QColor(0, 0, 170));
-
-    m_colors = {
-        { HighlightElement::Keyword, KeywordFormat },
-        { HighlightElement::Classname, ClassnameFormat },
-        { HighlightElement::String, StringFormat },
-        { HighlightElement::Comment, CommentFormat },
-        { HighlightElement::Literal, LiteralFormat },
-    };
-
-    //
-    // KEYWORDS
-    //
-
-    m_keywords = QStringList {
-        QStringLiteral("and"),
-        QStringLiteral("del"),
-        QStringLiteral("from"),
-        QStringLiteral("not"),
-        QStringLiteral("while"),
-        QStringLiteral("as"),
-        QStringLiteral("elif"),
-        QStringLiteral("global"),
-        QStringLiteral("or"),
-        QStringLiteral("with"),
-        QStringLiteral("assert"),
-        QStringLiteral("else"),
-        QStringLiteral("if"),
-        QStringLiteral("pass"),
-        QStringLiteral("yeld"),
-        QStringLiteral("break"),
-        QStringLiteral("except"),
-        QStringLiteral("import"),
-        QStringLiteral("print"),
-        QStringLiteral("class"),
-        QStringLiteral("exec"),
-        QStringLiteral("in"),
-        QStringLiteral("raise"),
-        QStringLiteral("continue"),
-        QStringLiteral("finally"),
-        QStringLiteral("is"),
-        QStringLiteral("return"),
-        QStringLiteral("def"),
-        QStringLiteral("for"),
-        QStringLiteral("lambda"),
-        QStringLiteral("try"),
-        QStringLiteral("exec"),
-        QStringLiteral("None"),
-        QStringLiteral("True"),
-        QStringLiteral("False"),
-    };
-
-    //
-    // CLASSNAMES
-    //
-
-    m_classnames = QStringList {
-    };
+    static const Grammar instance = [] {
+        QTextCharFormat KeywordFormat;
+        QTextCharFormat ClassnameFormat;
+        QTextCharFormat StringFormat;
+        QTextCharFormat CommentFormat;
+        QTextCharFormat LiteralFormat;
+
+        KeywordFormat.setForeground(QColor(0, 0, 255));
+        ClassnameFormat.setForeground(QColor(30, 130, 160));
+        StringFormat.setForeground(Qt::darkGreen);
+        CommentFormat.setForeground(Qt::darkGreen);
+        LiteralFormat.setForeground(QColor(0, 0, 170));
+
+        Grammar grammar;
+        grammar.formats = makeFormats<HighlightElement>({
+            { HighlightElement::Keyword, KeywordFormat },
+            { HighlightElement::Classname, ClassnameFormat },
+            { HighlightElement::String, StringFormat },
+            { HighlightElement::Comment, CommentFormat },
+            { HighlightElement::Literal, LiteralFormat },
+        });
+
+        grammar.keywords = keywords;
+
+        return grammar;
+    }();
+    return instance;
 }
 
-void PythonHighlighter::highlightBlock(const QString &text)
+namespace {
+
+//! Whether `token` is a string prefix like `r`, `b`, `f`, `rb`
+bool isStringPrefix(QStringView token)
 {
-    // parsing state
-    enum {
-        Start = 0,
-        Number = 1,
-        Identifier = 2,
-        String = 3,
-        Comment = 4,
-    };
-
-    int blockState = previousBlockState();
-    int state = blockState & 15;
-    if (blockState < 0) {
-        state = Start;
+    if (token.size() > 2) {
+        return false;
     }
+    for (QChar c : token) {
+        switch (c.toLower().unicode()) {
+        case 'r': case 'b': case 'f': case 'u':
+            break;
+        default:
+            return false;
+        }
+    }
+    return true;
+}
 
-    int start = 0;
-    int i = 0;
-
-    while (i <= text.length()) {
-        QChar ch = (i < text.length()) ? text.at(i) : QChar();
-        QChar next_ch = (i < text.length() - 1) ? text.at(i + 1) : QChar();
-        QChar next_next_ch = (i < text.length() - 2) ? text.at(i + 2) : QChar();
-
-        switch (state) {
+} // namespace
 
-        case Start:
-            start = i;
-            if (ch.isSpace()) {
-                ++i;
-            } else if (ch.isDigit() || (ch == '-' && !next_ch.isLetter())) {
-                ++i;
-                state = Number;
-            } else if ((ch == '\'') && (next_ch == '\'') && (next_next_ch == '\'')) {
-                i += 3;
-                state = Comment;
-            } else if ((ch == '\'') || (ch == '\"')) {
-                ++i;
-                state = String;
-            } else if (ch.isLetter() || (ch == '_') || (ch == '$')) {
-                ++i;
-                state = Identifier;
-            } else if (ch == '#') {
-                i = text.length();
-                setFormat(start, text.length(), m_colors[HighlightElement::Comment]);
-            } else {
-                ++i;
-                state = Start;
-            }
-            break;
+PythonHighlighter::PythonHighlighter(QTextDocument *parent)
+    : Highlighter(grammar().formats, parent)
+    , m_grammar(grammar())
+{
+}
 
-        case Number:
-            if (ch.isSpace() || !(ch.isDigit() || ch.isLetter())) {
-                setFormat(start, i - start, m_colors[HighlightElement::Literal]);
-                state = Start;
-            } else {
-                ++i;
-            }
-            break;
+int PythonHighlighter::lexBlock(const QString &text, int previousState)
+{
+    const QChar *s = text.constData();
+    const qsizetype size = text.size();
+    qsizetype i = 0;
+
+    // continue triple-quoted string opened in previous blocks, it is closed
+    // only by the same quote variant which opened it
+    Lexer::State state = m_states.state(previousState);
+    if (state.kind != Lexer::State::Start) {
+        i = Lexer::closeString(s, 0, size, state);
+        addRun(0, i, HighlightElement::Comment);
+    }
 
-        case Identifier:
-            if (ch.isSpace() ||
-                (!(ch.isDigit() || ch.isLetter() || (ch == '_') || (ch == '$')))) {
-                QString token = text.mid(start, i - start).trimmed();
-                if (m_keywords.contains(token)) {
-                    setFormat(start, i - start, m_colors[HighlightElement::Keyword]);
-                } else if (m_classnames.contains(token)) {
-                    setFormat(start, i - start, m_colors[HighlightElement::Classname]);
+    while (i < size) {
+        const qsizetype start = i;
+        const char16_t ch = s[i].unicode();
+        const char16_t next = (i + 1 < size) ? s[i + 1].unicode() : 0;
+        const char16_t nextNext = (i + 2 < size) ? s[i + 2].unicode() : 0;
+        const quint8 cls = Lexer::classOf(ch);
+
+        if (cls & Lexer::Space) {
+            i = Lexer::skip(s, i + 1, size, Lexer::Space);
+        } else if ((cls & Lexer::Digit) || (ch == '-' && !(Lexer::classOf(next) & Lexer::Letter))) {
+            i = Lexer::skip(s, i + 1, size, Lexer::Digit | Lexer::Letter);
+            addRun(start, i - start, HighlightElement::Literal);
+        } else if ((ch == '\'' || ch == '"') && next == ch && nextNext == ch) {
+            state = {Lexer::State::String, 0, QString(3, QChar(ch))};
+            i = Lexer::closeString(s, start + 3, size, state);
+            addRun(start, i - start, HighlightElement::Comment);
+        } else if (ch == '\'' || ch == '"') {
+            // string ends at the same quote, backslash escapes only valid escape characters
+            i = start + 1;
+            for (;;) {
+                i = Lexer::find(s, i, size, ch, '\\');
+                if (i == size) {
+                    // unterminated string is not highlighted
+                    break;
                 }
-                state = Start;
-            } else {
-                ++i;
-            }
-            break;
-
-        case String:
-            if ((ch == '\\') &&
-                ((next_ch == '\\') || (next_ch == '\'') || (next_ch == '\"') ||
-                 (next_ch == 'b') || (next_ch == 'r') || (next_ch == 'f') ||
-                 (next_ch == 't') || (next_ch == 'v'))) {
-                // Accept all valid escapes as part of string
-                ++i;
-                ++i;
-            }
-            else if (ch == text.at(start)) {
-                QChar prev_prev = (i > 1) ? text.at(i - 2) : QChar();
-                QChar prev = (i > 0) ? text.at(i - 1) : QChar();
-                if ((!(prev == '\\')) || ((prev_prev == '\\') && (prev == '\\'))) {
-                    ++i;
-                    setFormat(start, i - start, m_colors[HighlightElement::String]);
-                    state = Start;
-                } else {
-                    // If (ch == '\\') and we are here, there's an error.
-                    // For example, an invalid escape sequence.
-                    ++i;
+                if (s[i] == QLatin1Char('\\')) {
+                    i += (i + 1 < size && Lexer::isEscape(s[i + 1].unicode())) ? 2 : 1;
+                    continue;
                 }
-            } else {
-                // If (ch == '\\') and we are here, there's an error
-                // For example, an invalid escape sequence.
                 ++i;
+                addRun(start, i - start, HighlightElement::String);
+                break;
             }
-            break;
-
-        case Comment:
-            if ((ch == '\'') && (next_ch == '\'') && (next_next_ch == '\'')) {
-                i += 3;
-                setFormat(start, i - start, m_colors[HighlightElement::Comment]);
-                state = Start;
-            } else {
-                ++i;
+        } else if (cls & (Lexer::Letter | Lexer::Word)) {
+            i = Lexer::skip(s, i + 1, size, Lexer::Digit | Lexer::Letter | Lexer::Word);
+            const QStringView token(s + start, i - start);
+            if (isStringPrefix(token) && i + 2 < size && (s[i] == QLatin1Char('\'') || s[i] == QLatin1Char('"'))
+                    && s[i + 1] == s[i] && s[i + 2] == s[i]) {
+                // prefixed triple-quoted string: r""", b''', f""" ...
+                state = {Lexer::State::String, 0, QString(3, s[i])};
+                i = Lexer::closeString(s, i + 3, size, state);
+                addRun(start, i - start, HighlightElement::Comment);
+            } else if (m_grammar.keywords.contains(token)) {
+                addRun(start, i - start, HighlightElement::Keyword);
+            } else if (m_grammar.classnames.contains(token)) {
+                addRun(start, i - start, HighlightElement::Classname);
             }
+        } else if (ch == '#') {
+            addRun(start, size - start, HighlightElement::Comment);
             break;
-
-        default:
-            state = Start;
-            break;
+        } else {
+            ++i;
         }
     }
 
-    if (state == Comment) {
-        setFormat(start, text.length(), m_colors[HighlightElement::Comment]);
-    } else {
-        state = Start;
-    }
-
-    blockState = (state & 15);
-    setCurrentBlockState(blockState);
+    return m_states.id(state);
 }
 
 } // aske
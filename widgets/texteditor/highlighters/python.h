@@ -1,7 +1,9 @@
 #ifndef PYTHON_HIGHLIGHTER_H
 #define PYTHON_HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include "highlighter.h"
+#include "keywords.h"
+#include "lexerstate.h"
 #include <QTextCharFormat>
 
 QT_BEGIN_NAMESPACE
@@ -10,7 +12,7 @@ QT_END_NAMESPACE
 
 namespace aske {
 
-class PythonHighlighter : public ::QSyntaxHighlighter
+class PythonHighlighter : public Highlighter
 {
     Q_OBJECT
 
@@ -18,7 +20,7 @@ public:
     PythonHighlighter(QTextDocument *parent = 0);
 
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
 
     enum class HighlightElement {
         Keyword,
@@ -28,9 +30,17 @@ protected:
         Literal,
     };
 
-    QMap<HighlightElement, QTextCharFormat> m_colors;
-    QStringList m_keywords;
-    QStringList m_classnames;
+    //! Immutable language data shared by all highlighters of a language
+    struct Grammar {
+        Formats formats;
+        KeywordSet keywords;
+        KeywordSet classnames;
+    };
+
+    static const Grammar &grammar();
+
+    const Grammar &m_grammar;
+    Lexer::StateTable m_states; //! Block state is an ID in this table
 };
 
 } // namespace aske
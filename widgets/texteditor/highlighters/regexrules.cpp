@@ -0,0 +1,37 @@
+#include "regexrules.h"
+
+#include <QDebug>
+
+namespace aske {
+
+RegexRuleSet::RegexRuleSet(std::initializer_list<Rule> rules, QRegularExpression::PatternOptions options)
+{
+    QString pattern;
+    int index = 1;
+
+    for(const Rule &rule : rules) {
+        if(!pattern.isEmpty()) {
+            pattern += '|';
+        }
+        pattern += '(';
+        pattern += rule.pattern;
+        pattern += ')';
+
+        m_groups.append({rule.id, index});
+
+        // skip wrapper group and rule's own capture groups
+        index += 1 + QRegularExpression(rule.pattern).captureCount();
+    }
+
+    m_regexp.setPattern(pattern);
+    m_regexp.setPatternOptions(options);
+
+    if(!m_regexp.isValid()) {
+        qWarning() << "Invalid highlighting rules:" << m_regexp.errorString();
+    }
+
+    // compile and JIT right now, not on the first lines highlighted
+    m_regexp.optimize();
+}
+
+} // namespace aske
@@ -0,0 +1,67 @@
+#ifndef REGEXRULES_H
+#define REGEXRULES_H
+
+#include <initializer_list>
+#include <QRegularExpression>
+#include <QVector>
+
+namespace aske {
+
+/*!
+ * @brief Immutable set of regular expression rules scanned in one pass.
+ *
+ * @details
+ * All rules are merged into a single alternation `(rule0)|(rule1)|...`
+ * which is compiled and JIT-optimized once, so a line is scanned only once
+ * regardless of the number of rules. When several rules match at the same
+ * position the one listed first wins.
+ *
+ * Rule sets are meant to be shared by all highlighter instances, keep them
+ * in function-local statics:
+ * @code
+ * static const RegexRuleSet rules {
+ *     { Number, QStringLiteral("\\d+") },
+ *     { Word, QStringLiteral("\\w+") },
+ * };
+ * @endcode
+ */
+class RegexRuleSet
+{
+public:
+    struct Rule {
+        int id;           //! Value reported back for matches of this rule
+        QString pattern;  //! Regular expression of the rule
+    };
+
+    RegexRuleSet(std::initializer_list<Rule> rules,
+                 QRegularExpression::PatternOptions options = QRegularExpression::NoPatternOption);
+
+    /*! Calls `callback(id, start, length)` for every match in `text`. */
+    template<class Callback>
+    void match(const QString &text, Callback callback) const {
+        QRegularExpressionMatchIterator matchIterator = m_regexp.globalMatch(text);
+        while (matchIterator.hasNext()) {
+            QRegularExpressionMatch match = matchIterator.next();
+            for(const Group &group : m_groups) {
+                const qsizetype start = match.capturedStart(group.index);
+                if(start >= 0) {
+                    callback(group.id, static_cast<int>(start), static_cast<int>(match.capturedLength(group.index)));
+                    break;
+                }
+            }
+        }
+    }
+
+private:
+    struct Group {
+        int id;    //! Rule id
+        int index; //! Capture group which wraps the rule
+    };
+
+    QRegularExpression m_regexp;
+    QVector<Group> m_groups;
+};
+
+} // namespace aske
+
+#endif // REGEXRULES_H
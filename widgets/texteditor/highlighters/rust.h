@@ -9,6 +9,8 @@ QT_END_NAMESPACE
 
 namespace aske {
 
+class RegexRuleSet;
+
 class RustHighlighter : public CLikeHighlighter
 {
     Q_OBJECT
@@ -17,8 +19,10 @@ public:
     RustHighlighter(QTextDocument *parent = 0);
 
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
-    QTextCharFormat m_macrosFormat;
+    static const Grammar &grammar();
+    static const RegexRuleSet &rules();
+
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
 };
 
 } // namespace aske
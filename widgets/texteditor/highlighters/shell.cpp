@@ -1,43 +1,65 @@
 #include "shell.h"
 
-#include <QRegularExpressionMatchIterator>
+#include "regexrules.h"
 
 namespace aske {
 
-ShellHighlighter::ShellHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+// listed in priority order: first matching rule wins
+const RegexRuleSet &ShellHighlighter::rules()
 {
-    QTextCharFormat CommandFormat;
-    QTextCharFormat KeyFormat;
-    QTextCharFormat CommentFormat;
-    QTextCharFormat VarFormat;
-    QTextCharFormat LabelFormat;
-    QTextCharFormat ParamFormat;
+    static const RegexRuleSet set {
+        { static_cast<int>(HighlightElement::Param), QStringLiteral(R"(\s/[\w\d]+)") },
+        { static_cast<int>(HighlightElement::Label), QStringLiteral(R"([\s]*:[\w\d_]+)") },
+        { static_cast<int>(HighlightElement::Var), QStringLiteral(R"((\$|%{1,2})[\w\d_~]+%?)") },
+        { static_cast<int>(HighlightElement::Key), QStringLiteral(R"(-{1,2}[\w\d_]+)") },
+    };
+    return set;
+}
 
-    CommandFormat.setFontWeight(QFont::Bold);
-    CommandFormat.setForeground(Qt::darkMagenta);
-    KeyFormat.setForeground(QColor(120, 120, 255));
-    CommentFormat.setForeground(QColor(30, 130, 160));
-    VarFormat.setForeground(QColor(85, 140, 46));
-    LabelFormat.setForeground(Qt::blue);
-    LabelFormat.setFontWeight(QFont::Bold);
-    ParamFormat.setForeground(QColor(0, 103, 124));
+const ShellHighlighter::Grammar &ShellHighlighter::grammar()
+{
+    static const Grammar instance = [] {
+        QTextCharFormat CommandFormat;
+        QTextCharFormat KeyFormat;
+        QTextCharFormat CommentFormat;
+        QTextCharFormat VarFormat;
+        QTextCharFormat LabelFormat;
+        QTextCharFormat ParamFormat;
 
-    m_colors = {
-        { HighlightElement::Comand, CommandFormat },
-        { HighlightElement::Key, KeyFormat },
-        { HighlightElement::Comment, CommentFormat },
-        { HighlightElement::Var, VarFormat },
-        { HighlightElement::Label, LabelFormat },
-        { HighlightElement::Param, ParamFormat },
-    };
+        CommandFormat.setFontWeight(QFont::Bold);
+        CommandFormat.setForeground(Qt::darkMagenta);
+        KeyFormat.setForeground(QColor(120, 120, 255));
+        CommentFormat.setForeground(QColor(30, 130, 160));
+        VarFormat.setForeground(QColor(85, 140, 46));
+        LabelFormat.setForeground(Qt::blue);
+        LabelFormat.setFontWeight(QFont::Bold);
+        ParamFormat.setForeground(QColor(0, 103, 124));
+
+        Grammar grammar;
+        grammar.formats = makeFormats<HighlightElement>({
+            { HighlightElement::Comand, CommandFormat },
+            { HighlightElement::Key, KeyFormat },
+            { HighlightElement::Comment, CommentFormat },
+            { HighlightElement::Var, VarFormat },
+            { HighlightElement::Label, LabelFormat },
+            { HighlightElement::Param, ParamFormat },
+        });
+
+        return grammar;
+    }();
+    return instance;
 }
 
-void ShellHighlighter::highlightBlock(const QString &text_)
+ShellHighlighter::ShellHighlighter(QTextDocument *parent)
+    : Highlighter(grammar().formats, parent)
+{
+}
+
+int ShellHighlighter::lexBlock(const QString &text_, int /* previousState */)
 {
     if(text_.startsWith('#') || text_.startsWith("rem ", Qt::CaseInsensitive)) {
-        setFormat(0, static_cast<int>(text_.size()), m_colors[HighlightElement::Comment]);
-        return;
+        addRun(0, static_cast<int>(text_.size()), HighlightElement::Comment);
+        return -1;
     }
 
     QStringView text(text_);
@@ -55,21 +77,14 @@ void ShellHighlighter::highlightBlock(const QString &text_)
             ++i;
         }
 
-        setFormat(static_cast<int>(text_.data() - comand.data()), i, m_colors[HighlightElement::Comand]);
+        addRun(static_cast<int>(comand.data() - text_.data()), i, HighlightElement::Comand);
     }
 
-    auto doRegexp = [&text_, this](HighlightElement el, const QString &regexp){
-        QRegularExpressionMatchIterator matchIterator = QRegularExpression(regexp).globalMatch(text_);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(static_cast<int>(match.capturedStart()), static_cast<int>(match.capturedLength()), m_colors[el]);
-        }
-    };
+    rules().match(text_, [this](int id, int start, int length) {
+        addRun(start, length, static_cast<HighlightElement>(id));
+    });
 
-    doRegexp(HighlightElement::Key, R"(-{1,2}[\w\d_]+)");
-    doRegexp(HighlightElement::Var, R"((\$|%{1,2})[\w\d_~]+%?)");
-    doRegexp(HighlightElement::Label, R"([\s]*:[\w\d_]+)");
-    doRegexp(HighlightElement::Param, R"(\s/[\w\d]+)");
+    return -1;
 }
 
 } // aske
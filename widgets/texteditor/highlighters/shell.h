@@ -1,7 +1,7 @@
 #ifndef SHELL_HIGHLIGHTER_H
 #define SHELL_HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include "highlighter.h"
 #include <QTextCharFormat>
 
 QT_BEGIN_NAMESPACE
@@ -10,7 +10,9 @@ QT_END_NAMESPACE
 
 namespace aske {
 
-class ShellHighlighter : public ::QSyntaxHighlighter
+class RegexRuleSet;
+
+class ShellHighlighter : public Highlighter
 {
     Q_OBJECT
 
@@ -18,7 +20,7 @@ public:
     ShellHighlighter(QTextDocument *parent = 0);
 
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
 
     enum class HighlightElement {
         Comand,
@@ -29,7 +31,14 @@ protected:
         Param
     };
 
-    QMap<HighlightElement, QTextCharFormat> m_colors;
+    static const RegexRuleSet &rules();
+
+    //! Immutable language data shared by all highlighters of a language
+    struct Grammar {
+        Formats formats;
+    };
+
+    static const Grammar &grammar();
 };
 
 } // namespace aske
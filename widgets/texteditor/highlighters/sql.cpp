@@ -1,223 +1,323 @@
 #include "sql.h"
 
-#include <QRegularExpression>
-
 namespace aske {
 
+namespace {
+
+//
+// KEYWORDS
+//
+
+constexpr auto keywords = makeKeywordTable({
+    "ADD",
+    "EXCEPT",
+    "PERCENT",
+    "ALL",
+    "EXEC",
+    "PLAN",
+    "ALTER",
+    "EXECUTE",
+    "PRECISION",
+    "AND",
+    "EXISTS",
+    "PRIMARY",
+    "ANY",
+    "EXIT",
+    "PRINT",
+    "AS",
+    "FETCH",
+    "PROC",
+    "ASC",
+    "FILE",
+    "PROCEDURE",
+    "AUTHORIZATION",
+    "FILLFACTOR",
+    "PUBLIC",
+    "BACKUP",
+    "FOR",
+    "RAISERROR",
+    "BEGIN",
+    "FOREIGN",
+    "READ",
+    "BETWEEN",
+    "FREETEXT",
+    "READTEXT",
+    "BREAK",
+    "FREETEXTTABLE",
+    "RECONFIGURE",
+    "BROWSE",
+    "FROM",
+    "REFERENCES",
+    "BULK",
+    "FULL",
+    "REPLICATION",
+    "BY",
+    "FUNCTION",
+    "RESTORE",
+    "CASCADE",
+    "GOTO",
+    "RESTRICT",
+    "CASE",
+    "GRANT",
+    "RETURN",
+    "CHECK",
+    "GROUP",
+    "REVOKE",
+    "CHECKPOINT",
+    "HAVING",
+    "RIGHT",
+    "CLOSE",
+    "HOLDLOCK",
+    "ROLLBACK",
+    "CLUSTERED",
+    "IDENTITY",
+    "ROWCOUNT",
+    "COALESCE",
+    "IDENTITY_INSERT",
+    "ROWGUIDCOL",
+    "COLLATE",
+    "IDENTITYCOL",
+    "RULE",
+    "COLUMN",
+    "IF",
+    "SAVE",
+    "COMMIT",
+    "IN",
+    "SCHEMA",
+    "COMPUTE",
+    "INDEX",
+    "SELECT",
+    "CONSTRAINT",
+    "INNER",
+    "SESSION_USER",
+    "CONTAINS",
+    "INSERT",
+    "SET",
+    "CONTAINSTABLE",
+    "INTERSECT",
+    "SETUSER",
+    "CONTINUE",
+    "INTO",
+    "SHUTDOWN",
+    "CONVERT",
+    "IS",
+    "SOME",
+    "CREATE",
+    "JOIN",
+    "STATISTICS",
+    "CROSS",
+    "KEY",
+    "SYSTEM_USER",
+    "CURRENT",
+    "KILL",
+    "TABLE",
+    "CURRENT_DATE",
+    "LEFT",
+    "TEXTSIZE",
+    "CURRENT_TIME",
+    "LIKE",
+    "THEN",
+    "CURRENT_TIMESTAMP",
+    "LINENO",
+    "TO",
+    "CURRENT_USER",
+    "LOAD",
+    "TOP",
+    "CURSOR",
+    "NATIONAL",
+    "TRAN",
+    "DATABASE",
+    "NOCHECK",
+    "TRANSACTION",
+    "DBCC",
+    "NONCLUSTERED",
+    "TRIGGER",
+    "DEALLOCATE",
+    "NOT",
+    "TRUNCATE",
+    "DECLARE",
+    "NULL",
+    "TSEQUAL",
+    "DEFAULT",
+    "NULLIF",
+    "UNION",
+    "DELETE",
+    "OF",
+    "UNIQUE",
+    "DENY",
+    "OFF",
+    "UPDATE",
+    "DESC",
+    "OFFSETS",
+    "UPDATETEXT",
+    "DISK",
+    "ON",
+    "USE",
+    "DISTINCT",
+    "OPEN",
+    "USER",
+    "DISTRIBUTED",
+    "OPENDATASOURCE",
+    "VALUES",
+    "DOUBLE",
+    "OPENQUERY",
+    "VARYING",
+    "DROP",
+    "OPENROWSET",
+    "VIEW",
+    "DUMMY",
+    "OPENXML",
+    "WAITFOR",
+    "DUMP",
+    "OPTION",
+    "WHEN",
+    "ELSE",
+    "OR",
+    "WHERE",
+    "END",
+    "ORDER",
+    "WHILE",
+    "ERRLVL",
+    "OUTER",
+    "WITH",
+    "ESCAPE",
+    "OVER",
+    "WRITETEXT",
+}, Qt::CaseInsensitive);
+
+} // namespace
+
+const SqlHighlighter::Grammar &SqlHighlighter::grammar()
+{
+    static const Grammar instance = [] {
+        QTextCharFormat KeywordFormat;
+        QTextCharFormat CommentFormat;
+        QTextCharFormat LiteralFormat;
+        QTextCharFormat StringFormat;
+
+        KeywordFormat.setForeground(Qt::blue);
+        CommentFormat.setForeground(Qt::darkGreen);
+        LiteralFormat.setForeground(QColor(0, 0, 170));
+        StringFormat.setForeground(Qt::darkRed);
+
+        Grammar grammar;
+        grammar.formats = makeFormats<HighlightElement>({
+            { HighlightElement::Keyword, KeywordFormat },
+            { HighlightElement::Comment, CommentFormat },
+            { HighlightElement::Literal, LiteralFormat },
+            { HighlightElement::String, StringFormat },
+        });
+
+        grammar.keywords = keywords;
+
+        return grammar;
+    }();
+    return instance;
+}
+
 SqlHighlighter::SqlHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+    : Highlighter(grammar().formats, parent)
+    , m_grammar(grammar())
+{
+}
+
+int SqlHighlighter::lexBlock(const QString &text, int previousState)
 {
-    QTextCharFormat KeywordFormat;
-    QTextCharFormat CommentFormat;
-    QTextCharFormat LiteralFormat;
-
-    KeywordFormat.setForeground(Qt::blue);
-    CommentFormat.setForeground(Qt::darkGreen);
-    LiteralFormat.setForeground(QColor(0, 0, 170));
-
-    m_colors = {
-        { HighlightElement::Keyword, KeywordFormat },
-        { HighlightElement::Comment, CommentFormat },
-        { HighlightElement::Literal, LiteralFormat },
+    // parsing state
+    enum {
+        Start = 0,
+        Comment = 1,
+        SingleQuoted = 2,
+        DoubleQuoted = 3,
     };
 
-    //
-    // KEYWORDS
-    //
-
-    m_keywords = QStringList {
-        QStringLiteral("ADD"),
-        QStringLiteral("EXCEPT"),
-        QStringLiteral("PERCENT"),
-        QStringLiteral("ALL"),
-        QStringLiteral("EXEC"),
-        QStringLiteral("PLAN"),
-        QStringLiteral("ALTER"),
-        QStringLiteral("EXECUTE"),
-        QStringLiteral("PRECISION"),
-        QStringLiteral("AND"),
-        QStringLiteral("EXISTS"),
-        QStringLiteral("PRIMARY"),
-        QStringLiteral("ANY"),
-        QStringLiteral("EXIT"),
-        QStringLiteral("PRINT"),
-        QStringLiteral("AS"),
-        QStringLiteral("FETCH"),
-        QStringLiteral("PROC"),
-        QStringLiteral("ASC"),
-        QStringLiteral("FILE"),
-        QStringLiteral("PROCEDURE"),
-        QStringLiteral("AUTHORIZATION"),
-        QStringLiteral("FILLFACTOR"),
-        QStringLiteral("PUBLIC"),
-        QStringLiteral("BACKUP"),
-        QStringLiteral("FOR"),
-        QStringLiteral("RAISERROR"),
-        QStringLiteral("BEGIN"),
-        QStringLiteral("FOREIGN"),
-        QStringLiteral("READ"),
-        QStringLiteral("BETWEEN"),
-        QStringLiteral("FREETEXT"),
-        QStringLiteral("READTEXT"),
-        QStringLiteral("BREAK"),
-        QStringLiteral("FREETEXTTABLE"),
-        QStringLiteral("RECONFIGURE"),
-        QStringLiteral("BROWSE"),
-        QStringLiteral("FROM"),
-        QStringLiteral("REFERENCES"),
-        QStringLiteral("BULK"),
-        QStringLiteral("FULL"),
-        QStringLiteral("REPLICATION"),
-        QStringLiteral("BY"),
-        QStringLiteral("FUNCTION"),
-        QStringLiteral("RESTORE"),
-        QStringLiteral("CASCADE"),
-        QStringLiteral("GOTO"),
-        QStringLiteral("RESTRICT"),
-        QStringLiteral("CASE"),
-        QStringLiteral("GRANT"),
-        QStringLiteral("RETURN"),
-        QStringLiteral("CHECK"),
-        QStringLiteral("GROUP"),
-        QStringLiteral("REVOKE"),
-        QStringLiteral("CHECKPOINT"),
-        QStringLiteral("HAVING"),
-        QStringLiteral("RIGHT"),
-        QStringLiteral("CLOSE"),
-        QStringLiteral("HOLDLOCK"),
-        QStringLiteral("ROLLBACK"),
-        QStringLiteral("CLUSTERED"),
-        QStringLiteral("IDENTITY"),
-        QStringLiteral("ROWCOUNT"),
-        QStringLiteral("COALESCE"),
-        QStringLiteral("IDENTITY_INSERT"),
-        QStringLiteral("ROWGUIDCOL"),
-        QStringLiteral("COLLATE"),
-        QStringLiteral("IDENTITYCOL"),
-        QStringLiteral("RULE"),
-        QStringLiteral("COLUMN"),
-        QStringLiteral("IF"),
-        QStringLiteral("SAVE"),
-        QStringLiteral("COMMIT"),
-        QStringLiteral("IN"),
-        QStringLiteral("SCHEMA"),
-        QStringLiteral("COMPUTE"),
-        QStringLiteral("INDEX"),
-        QStringLiteral("SELECT"),
-        QStringLiteral("CONSTRAINT"),
-        QStringLiteral("INNER"),
-        QStringLiteral("SESSION_USER"),
-        QStringLiteral("CONTAINS"),
-        QStringLiteral("INSERT"),
-        QStringLiteral("SET"),
-        QStringLiteral("CONTAINSTABLE"),
-        QStringLiteral("INTERSECT"),
-        QStringLiteral("SETUSER"),
-        QStringLiteral("CONTINUE"),
-        QStringLiteral("INTO"),
-        QStringLiteral("SHUTDOWN"),
-        QStringLiteral("CONVERT"),
-        QStringLiteral("IS"),
-        QStringLiteral("SOME"),
-        QStringLiteral("CREATE"),
-        QStringLiteral("JOIN"),
-        QStringLiteral("STATISTICS"),
-        QStringLiteral("CROSS"),
-        QStringLiteral("KEY"),
-        QStringLiteral("SYSTEM_USER"),
-        QStringLiteral("CURRENT"),
-        QStringLiteral("KILL"),
-        QStringLiteral("TABLE"),
-        QStringLiteral("CURRENT_DATE"),
-        QStringLiteral("LEFT"),
-        QStringLiteral("TEXTSIZE"),
-        QStringLiteral("CURRENT_TIME"),
-        QStringLiteral("LIKE"),
-        QStringLiteral("THEN"),
-        QStringLiteral("CURRENT_TIMESTAMP"),
-        QStringLiteral("LINENO"),
-        QStringLiteral("TO"),
-        QStringLiteral("CURRENT_USER"),
-        QStringLiteral("LOAD"),
-        QStringLiteral("TOP"),
-        QStringLiteral("CURSOR"),
-        QStringLiteral("NATIONAL"),
-        QStringLiteral("TRAN"),
-        QStringLiteral("DATABASE"),
-        QStringLiteral("NOCHECK"),
-        QStringLiteral("TRANSACTION"),
-        QStringLiteral("DBCC"),
-        QStringLiteral("NONCLUSTERED"),
-        QStringLiteral("TRIGGER"),
-        QStringLiteral("DEALLOCATE"),
-        QStringLiteral("NOT"),
-        QStringLiteral("TRUNCATE"),
-        QStringLiteral("DECLARE"),
-        QStringLiteral("NULL"),
-        QStringLiteral("TSEQUAL"),
-        QStringLiteral("DEFAULT"),
-        QStringLiteral("NULLIF"),
-        QStringLiteral("UNION"),
-        QStringLiteral("DELETE"),
-        QStringLiteral("OF"),
-        QStringLiteral("UNIQUE"),
-        QStringLiteral("DENY"),
-        QStringLiteral("OFF"),
-        QStringLiteral("UPDATE"),
-        QStringLiteral("DESC"),
-        QStringLiteral("OFFSETS"),
-        QStringLiteral("UPDATETEXT"),
-        QStringLiteral("DISK"),
-        QStringLiteral("ON"),
-        QStringLiteral("USE"),
-        QStringLiteral("DISTINCT"),
-        QStringLiteral("OPEN"),
-        QStringLiteral("USER"),
-        QStringLiteral("DISTRIBUTED"),
-        QStringLiteral("OPENDATASOURCE"),
-        QStringLiteral("VALUES"),
-        QStringLiteral("DOUBLE"),
-        QStringLiteral("OPENQUERY"),
-        QStringLiteral("VARYING"),
-        QStringLiteral("DROP"),
-        QStringLiteral("OPENROWSET"),
-        QStringLiteral("VIEW"),
-        QStringLiteral("DUMMY"),
-        QStringLiteral("OPENXML"),
-        QStringLiteral("WAITFOR"),
-        QStringLiteral("DUMP"),
-        QStringLiteral("OPTION"),
-        QStringLiteral("WHEN"),
-        QStringLiteral("ELSE"),
-        QStringLiteral("OR"),
-        QStringLiteral("WHERE"),
-        QStringLiteral("END"),
-        QStringLiteral("ORDER"),
-        QStringLiteral("WHILE"),
-        QStringLiteral("ERRLVL"),
-        QStringLiteral("OUTER"),
-        QStringLiteral("WITH"),
-        QStringLiteral("ESCAPE"),
-        QStringLiteral("OVER"),
-        QStringLiteral("WRITETEXT"),
+    int state = previousState < 0 ? Start : previousState;
+
+    const int length = static_cast<int>(text.size());
+    int start = 0;
+    int i = 0;
+
+    auto isWordChar = [](QChar ch) {
+        return ch.isLetterOrNumber() || ch == '_' || ch == '$' || ch == '@' || ch == '#';
     };
-}
 
-void SqlHighlighter::highlightBlock(const QString &text)
-{
-    if(text.startsWith("--")) {
-        setFormat(0, text.size(), m_colors[HighlightElement::Comment]);
-        return;
-    }
+    while(i < length) {
+        switch(state) {
+
+        case Comment: {
+            int end = static_cast<int>(text.indexOf(QLatin1String("*/"), i));
+            i = (end < 0) ? length : end + 2;
+            addRun(start, i - start, HighlightElement::Comment);
+            if(end >= 0) {
+                state = Start;
+            }
+            break;
+        }
 
-    for(const QString &keyword : m_keywords) {
-        QRegularExpression expr(QString("\\b%1\\b").arg(keyword), QRegularExpression::CaseInsensitiveOption);
-        QRegularExpressionMatchIterator matchIterator = expr.globalMatch(text);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), m_colors[HighlightElement::Keyword]);
+        case SingleQuoted:
+        case DoubleQuoted: {
+            const QChar quote = (state == SingleQuoted) ? '\'' : '"';
+            while(i < length) {
+                if(text.at(i) == quote) {
+                    // doubled quote is an escaped one
+                    if(i + 1 < length && text.at(i + 1) == quote) {
+                        i += 2;
+                        continue;
+                    }
+                    ++i;
+                    state = Start;
+                    break;
+                }
+                ++i;
+            }
+            addRun(start, i - start, HighlightElement::String);
+            break;
+        }
+
+        default: {
+            start = i;
+            const QChar ch = text.at(i);
+            const QChar next_ch = (i + 1 < length) ? text.at(i + 1) : QChar();
+
+            if(ch == '-' && next_ch == '-') {
+                addRun(start, length - start, HighlightElement::Comment);
+                i = length;
+            } else if(ch == '/' && next_ch == '*') {
+                i += 2;
+                state = Comment;
+            } else if(ch == '\'') {
+                ++i;
+                state = SingleQuoted;
+            } else if(ch == '"') {
+                ++i;
+                state = DoubleQuoted;
+            } else if(ch.isDigit()) {
+                while(i < length && (text.at(i).isLetterOrNumber() || text.at(i) == '.')) {
+                    ++i;
+                }
+                addRun(start, i - start, HighlightElement::Literal);
+            } else if(isWordChar(ch)) {
+                while(i < length && isWordChar(text.at(i))) {
+                    ++i;
+                }
+                if(m_grammar.keywords.contains(QStringView(text).mid(start, i - start))) {
+                    addRun(start, i - start, HighlightElement::Keyword);
+                }
+            } else {
+                ++i;
+            }
+
+            // an opener ending the line is not reached by its state's case
+            if(state != Start && i == length) {
+                addRun(start, i - start, state == Comment ? HighlightElement::Comment : HighlightElement::String);
+            }
+            break;
+        }
         }
     }
+
+    // comments and strings are the only constructs which span over blocks
+    return state;
 }
 
 } // aske
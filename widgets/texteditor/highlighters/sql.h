@@ -1,7 +1,8 @@
 #ifndef SQL_HIGHLIGHTER_H
 #define SQL_HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include "highlighter.h"
+#include "keywords.h"
 #include <QTextCharFormat>
 
 QT_BEGIN_NAMESPACE
@@ -10,7 +11,7 @@ QT_END_NAMESPACE
 
 namespace aske {
 
-class SqlHighlighter : public ::QSyntaxHighlighter
+class SqlHighlighter : public Highlighter
 {
     Q_OBJECT
 
@@ -18,16 +19,24 @@ public:
     SqlHighlighter(QTextDocument *parent = 0);
 
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
 
     enum class HighlightElement {
         Keyword,
         Comment,
         Literal,
+        String,
     };
 
-    QMap<HighlightElement, QTextCharFormat> m_colors;
-    QStringList m_keywords;
+    //! Immutable language data shared by all highlighters of a language
+    struct Grammar {
+        Formats formats;
+        KeywordSet keywords;
+    };
+
+    static const Grammar &grammar();
+
+    const Grammar &m_grammar;
 };
 
 } // namespace aske
@@ -1,38 +1,55 @@
 #include "tab.h"
 
-#include <QRegularExpressionMatchIterator>
+#include "regexrules.h"
 
 namespace aske {
 
-TabHighlighter::TabHighlighter(QTextDocument *parent)
-    : QSyntaxHighlighter(parent)
+// listed in priority order: first matching rule wins
+const RegexRuleSet &TabHighlighter::rules()
 {
-    QTextCharFormat DashFormat;
-    QTextCharFormat NumberFormat;
-    QTextCharFormat SpecialFormat;
-
-    DashFormat.setForeground(Qt::lightGray);
-    NumberFormat.setForeground(Qt::black);
-    SpecialFormat.setForeground(QColor(100, 100, 100));
-
-    m_rules = {
-        { HighlightElement::Dash, {DashFormat, QStringLiteral("[-–—|]{1,}")} },
-        { HighlightElement::Number, {NumberFormat, QStringLiteral("\\d{1,}")} },
-        { HighlightElement::Special, {SpecialFormat, QStringLiteral("\\b[A-Ze]\\b|#|[^\\s\\w\\d-–—|]")} },
+    static const RegexRuleSet set {
+        { static_cast<int>(HighlightElement::Special), QStringLiteral("\\b[A-Ze]\\b|#|[^\\s\\w\\d-–—|]") },
+        { static_cast<int>(HighlightElement::Number), QStringLiteral("\\d{1,}") },
+        { static_cast<int>(HighlightElement::Dash), QStringLiteral("[-–—|]{1,}") },
     };
+    return set;
 }
 
-void TabHighlighter::highlightBlock(const QString &text)
+const TabHighlighter::Grammar &TabHighlighter::grammar()
+{
+    static const Grammar instance = [] {
+        QTextCharFormat DashFormat;
+        QTextCharFormat NumberFormat;
+        QTextCharFormat SpecialFormat;
+
+        DashFormat.setForeground(Qt::lightGray);
+        NumberFormat.setForeground(Qt::black);
+        SpecialFormat.setForeground(QColor(100, 100, 100));
+
+        Grammar grammar;
+        grammar.formats = makeFormats<HighlightElement>({
+            { HighlightElement::Dash, DashFormat },
+            { HighlightElement::Number, NumberFormat },
+            { HighlightElement::Special, SpecialFormat },
+        });
+
+        return grammar;
+    }();
+    return instance;
+}
+
+TabHighlighter::TabHighlighter(QTextDocument *parent)
+    : Highlighter(grammar().formats, parent)
 {
-    for(auto key : m_rules.keys()) {
-        auto rule = m_rules[key];
-
-        QRegularExpressionMatchIterator matchIterator = QRegularExpression(rule.regexp).globalMatch(text);
-        while (matchIterator.hasNext()) {
-            QRegularExpressionMatch match = matchIterator.next();
-            setFormat(match.capturedStart(), match.capturedLength(), rule.format);
-        }
-    }
+}
+
+int TabHighlighter::lexBlock(const QString &text, int /* previousState */)
+{
+    rules().match(text, [this](int id, int start, int length) {
+        addRun(start, length, static_cast<HighlightElement>(id));
+    });
+
+    return -1;
 }
 
 } // aske
@@ -1,7 +1,7 @@
 #ifndef TAB_HIGHLIGHTER_H
 #define TAB_HIGHLIGHTER_H
 
-#include <QSyntaxHighlighter>
+#include "highlighter.h"
 #include <QTextCharFormat>
 
 QT_BEGIN_NAMESPACE
@@ -10,7 +10,9 @@ QT_END_NAMESPACE
 
 namespace aske {
 
-class TabHighlighter : public ::QSyntaxHighlighter
+class RegexRuleSet;
+
+class TabHighlighter : public Highlighter
 {
     Q_OBJECT
 
@@ -18,7 +20,7 @@ public:
     TabHighlighter(QTextDocument *parent = 0);
 
 protected:
-    virtual void highlightBlock(const QString &text) Q_DECL_OVERRIDE;
+    virtual int lexBlock(const QString &text, int previousState) Q_DECL_OVERRIDE;
 
     enum class HighlightElement {
         Dash,
@@ -26,12 +28,14 @@ protected:
         Special,
     };
 
-    struct Rule {
-        QTextCharFormat format;
-        QString regexp;
+    static const RegexRuleSet &rules();
+
+    //! Immutable language data shared by all highlighters of a language
+    struct Grammar {
+        Formats formats;
     };
 
-    QMap<HighlightElement, Rule> m_rules;
+    static const Grammar &grammar();
 };
 
 
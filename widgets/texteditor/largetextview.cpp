@@ -0,0 +1,704 @@
+#include "largetextview.h"
+
+#include <algorithm>
+#include <climits>
+#include <QClipboard>
+#include <QGuiApplication>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace {
+
+constexpr int TabStop = 4; //! Tab width in spaces, same as TextEditor's
+
+//! Position after character `c` drawn at `x`, tabs end at multiples of `tab`
+int nextX(const QFontMetrics &metrics, int tab, int x, QChar c)
+{
+    return c == QLatin1Char('\t') ? (x / tab + 1) * tab : x + metrics.horizontalAdvance(c);
+}
+
+//! Advance of first `length` characters of `text`, tabs expanded
+int advance(const QFontMetrics &metrics, const QString &text, int length)
+{
+    const int tab = TabStop * metrics.horizontalAdvance(QLatin1Char(' '));
+    int x = 0;
+    for(int i = 0; i < length && i < text.size(); ++i) {
+        x = nextX(metrics, tab, x, text.at(i));
+    }
+    return x;
+}
+
+//! Advances at UTF-8 byte offsets `edges` of `text`, `edges` are sorted so the line is walked once
+QVector<int> advancesAt(const QFontMetrics &metrics, const QString &text, const QVector<qint64> &edges)
+{
+    const int tab = TabStop * metrics.horizontalAdvance(QLatin1Char(' '));
+    QVector<int> advances;
+    advances.reserve(edges.size());
+    qint64 bytes = 0;
+    int x = 0;
+    int i = 0;
+    for(qint64 edge : edges) {
+        while(i < text.size() && bytes < edge) {
+            const QChar c = text.at(i);
+            bytes += c.unicode() < 0x80 ? 1 : c.unicode() < 0x800 ? 2 : c.isHighSurrogate() ? 4 : c.isLowSurrogate() ? 0 : 3;
+            x = nextX(metrics, tab, x, c);
+            ++i;
+        }
+        advances.append(x);
+    }
+    return advances;
+}
+
+void drawLine(QPainter &painter, const QFontMetrics &metrics, int x, int y, const QString &text)
+{
+    const int tab = TabStop * metrics.horizontalAdvance(QLatin1Char(' '));
+    int from = 0;
+    int offset = 0;
+    while(from < text.size()) {
+        int to = static_cast<int>(text.indexOf(QLatin1Char('\t'), from));
+        if(to < 0) {
+            to = static_cast<int>(text.size());
+        }
+        const QString part = text.mid(from, to - from);
+        painter.drawText(x + offset, y, part);
+        offset += metrics.horizontalAdvance(part);
+        if(to < text.size()) {
+            offset = (offset / tab + 1) * tab;
+        }
+        from = to + 1;
+    }
+}
+
+} // namespace
+
+LargeTextView::LargeTextView(QWidget *parent)
+    : QAbstractScrollArea(parent)
+{
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+}
+
+bool LargeTextView::openFile(const QString &fileName)
+{
+    if(!m_text.open(fileName)) {
+        return false;
+    }
+    reset();
+    return true;
+}
+
+void LargeTextView::setText(const PieceTable::Snapshot &text)
+{
+    m_text.restore(text);
+    reset();
+}
+
+void LargeTextView::reset()
+{
+    m_cursor = 0;
+    m_anchor = 0;
+    m_column = -1;
+    m_textWidth = 0;
+    m_undo.clear();
+    m_redo.clear();
+    m_lastEdit = Edit::None;
+    ++m_revision;
+
+    verticalScrollBar()->setValue(0);
+    horizontalScrollBar()->setValue(0);
+    updateScrollBars();
+    viewport()->update();
+    emit textChanged();
+    emit cursorPositionChanged();
+}
+
+bool LargeTextView::saveFile(const QString &fileName)
+{
+    return m_text.save(fileName);
+}
+
+void LargeTextView::replace(const QVector<SearchEngine::Replacement> &replacements)
+{
+    if(replacements.isEmpty()) {
+        return;
+    }
+
+    beginEdit(Edit::None);
+
+    // from the end, so offsets of the rest stay valid
+    qint64 cursor = m_cursor;
+    for(auto it = replacements.crbegin(); it != replacements.crend(); ++it) {
+        m_text.remove(it->offset, it->length);
+        m_text.insert(it->offset, it->text);
+        if(it->offset + it->length <= m_cursor) {
+            cursor += it->text.size() - it->length;
+        } else if(it->offset < m_cursor) {
+            cursor = it->offset;
+        }
+    }
+    m_cursor = qBound<qint64>(0, cursor, m_text.size());
+    m_column = -1;
+    edited();
+}
+
+void LargeTextView::setCursorPosition(qint64 offset)
+{
+    moveCursor(qBound<qint64>(0, offset, m_text.size()));
+}
+
+void LargeTextView::setLineNumbersVisible(bool visible)
+{
+    m_lineNumbers = visible;
+    viewport()->update();
+}
+
+void LargeTextView::setSearchEngine(const SearchEngine *engine)
+{
+    m_search = engine;
+    viewport()->update();
+}
+
+qint64 LargeTextView::firstVisibleLine() const
+{
+    return rowCount() ? lineOfRow(verticalScrollBar()->value()) : 0;
+}
+
+int LargeTextView::visibleLineCount() const
+{
+    return qMax(1, viewport()->height() / lineHeight());
+}
+
+void LargeTextView::setFilter(const QVector<qint64> &lines)
+{
+    m_filtered = true;
+    m_filterLines = lines;
+    updateScrollBars();
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeTextView::appendFilter(const QVector<qint64> &lines)
+{
+    // scroll position is a row, rows shown so far stay where they are
+    m_filterLines.append(lines);
+    updateScrollBars();
+    viewport()->update();
+}
+
+void LargeTextView::clearFilter()
+{
+    if(!m_filtered) {
+        return;
+    }
+    m_filtered = false;
+    m_filterLines.clear();
+    updateScrollBars();
+    ensureCursorVisible();
+    viewport()->update();
+}
+
+void LargeTextView::undo()
+{
+    if(m_undo.isEmpty()) {
+        return;
+    }
+    m_redo.append({m_text.snapshot(), m_cursor});
+    const UndoStep step = m_undo.takeLast();
+    m_text.restore(step.text);
+    m_cursor = step.cursor;
+    m_lastEdit = Edit::None;
+    edited();
+}
+
+void LargeTextView::redo()
+{
+    if(m_redo.isEmpty()) {
+        return;
+    }
+    m_undo.append({m_text.snapshot(), m_cursor});
+    const UndoStep step = m_redo.takeLast();
+    m_text.restore(step.text);
+    m_cursor = step.cursor;
+    m_lastEdit = Edit::None;
+    edited();
+}
+
+void LargeTextView::copy()
+{
+    const auto [from, to] = selection();
+    if(from < to && to - from <= MaxCopyBytes) {
+        QGuiApplication::clipboard()->setText(QString::fromUtf8(m_text.read(from, to - from)));
+    }
+}
+
+void LargeTextView::cut()
+{
+    if(m_readOnly || m_filtered || !hasSelection()) {
+        return;
+    }
+    copy();
+    removeSelection();
+}
+
+void LargeTextView::paste()
+{
+    const QString text = QGuiApplication::clipboard()->text();
+    if(!m_readOnly && !m_filtered && !text.isEmpty()) {
+        insert(text.toUtf8());
+    }
+}
+
+void LargeTextView::selectAll()
+{
+    m_anchor = 0;
+    moveCursor(m_text.size(), false, true);
+}
+
+void LargeTextView::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(viewport());
+    painter.fillRect(event->rect(), palette().base());
+
+    const QFontMetrics metrics(font());
+    const int height = lineHeight();
+    const int gutter = gutterWidth();
+    const int left = gutter + 4 - horizontalScrollBar()->value();
+    const qint64 count = rowCount();
+    const qint64 cursorLine = m_text.lineAt(m_cursor);
+    const auto [selectionFrom, selectionTo] = selection();
+    const int widthBefore = m_textWidth;
+
+    qint64 row = verticalScrollBar()->value();
+    for(int y = 0; y < viewport()->height() && row < count; y += height, ++row) {
+        const qint64 line = lineOfRow(row);
+        const qint64 start = m_text.lineStart(line);
+        const qint64 lineEnd = m_text.lineEnd(line);
+        const qint64 end = qMin(lineEnd, start + MaxLineBytes);
+        const QByteArray bytes = m_text.read(start, end - start);
+        const QString text = QString::fromUtf8(bytes);
+
+        if(line == cursorLine && !m_readOnly) {
+            painter.fillRect(gutter, y, viewport()->width() - gutter, height, QColor(245, 245, 245));
+        }
+
+        painter.setClipRect(gutter, 0, viewport()->width() - gutter, viewport()->height());
+
+        // edges of matches and of the selection are measured in one pass over the line
+        const QVector<SearchEngine::Match> matches = m_search ? m_search->matchesIn(start, end + 1) : QVector<SearchEngine::Match>();
+        const bool selected = selectionFrom < selectionTo && selectionFrom <= lineEnd && selectionTo > start;
+        if(!matches.isEmpty() || selected) {
+            QVector<qint64> edges;
+            edges.reserve(matches.size() * 2 + 2);
+            for(const SearchEngine::Match &match : matches) {
+                edges.append(qBound<qint64>(0, match.offset - start, bytes.size()));
+                edges.append(qBound<qint64>(0, match.offset + match.length - start, bytes.size()));
+            }
+            if(selected) {
+                edges.append(qBound<qint64>(0, selectionFrom - start, bytes.size()));
+                edges.append(qBound<qint64>(0, selectionTo - start, bytes.size()));
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+            const QVector<int> advances = advancesAt(metrics, text, edges);
+            auto xAt = [&](qint64 offset) {
+                const qint64 edge = qBound<qint64>(0, offset - start, bytes.size());
+                return left + advances.at(std::lower_bound(edges.cbegin(), edges.cend(), edge) - edges.cbegin());
+            };
+            for(const SearchEngine::Match &match : matches) {
+                const int x = xAt(match.offset);
+                painter.fillRect(x, y, qMax(2, xAt(match.offset + match.length) - x), height, QColor(255, 235, 130));
+            }
+            if(selected) {
+                // a selected line feed is shown as a space
+                const int x = xAt(selectionFrom);
+                const int width = xAt(selectionTo) - x + (selectionTo > lineEnd ? metrics.horizontalAdvance(QLatin1Char(' ')) : 0);
+                painter.fillRect(x, y, width, height, QColor(173, 214, 255));
+            }
+        }
+        painter.setPen(palette().text().color());
+        drawLine(painter, metrics, left, y + metrics.ascent(), text);
+        m_textWidth = qMax(m_textWidth, advance(metrics, text, static_cast<int>(text.size())));
+
+        if(line == cursorLine && hasFocus()) {
+            const int column = static_cast<int>(QString::fromUtf8(m_text.read(start, m_cursor - start)).size());
+            const int x = left + advance(metrics, text, column);
+            painter.fillRect(x, y, 1, height, palette().text());
+        }
+        painter.setClipping(false);
+
+        if(m_lineNumbers) {
+            painter.setPen(Qt::lightGray);
+            painter.drawText(0, y, gutter - 10, height, Qt::AlignRight, QString::number(line + 1));
+        }
+    }
+
+    if(m_textWidth != widthBefore) {
+        updateScrollBars();
+    }
+}
+
+void LargeTextView::keyPressEvent(QKeyEvent *event)
+{
+    if(m_filtered && (event->matches(QKeySequence::Undo) || event->matches(QKeySequence::Redo))) {
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+    if(event->matches(QKeySequence::Undo)) {
+        undo();
+        return;
+    }
+    if(event->matches(QKeySequence::Redo)) {
+        redo();
+        return;
+    }
+    if(event->matches(QKeySequence::Copy)) {
+        copy();
+        return;
+    }
+    if(event->matches(QKeySequence::Cut)) {
+        cut();
+        return;
+    }
+    if(event->matches(QKeySequence::Paste)) {
+        paste();
+        return;
+    }
+    if(event->matches(QKeySequence::SelectAll)) {
+        selectAll();
+        return;
+    }
+
+    const qint64 line = m_text.lineAt(m_cursor);
+    const qint64 row = rowOfLine(line);
+    const qint64 lastRow = rowCount() - 1;
+    const bool control = event->modifiers() & Qt::ControlModifier;
+    const bool select = event->modifiers() & Qt::ShiftModifier;
+    const int column = m_column >= 0 ? m_column : columnOf(m_cursor);
+
+    // vertical moves go by rows, which skip lines filtered out
+    auto moveToRow = [&](qint64 target) {
+        if(lastRow >= 0) {
+            moveCursor(positionInLine(lineOfRow(qBound<qint64>(0, target, lastRow)), column), true, select);
+            m_column = column;
+        }
+    };
+
+    switch(event->key()) {
+    case Qt::Key_Left:
+        moveCursor(previousPosition(m_cursor), false, select);
+        return;
+    case Qt::Key_Right:
+        moveCursor(nextPosition(m_cursor), false, select);
+        return;
+    case Qt::Key_Up:
+        moveToRow(row - 1);
+        return;
+    case Qt::Key_Down:
+        moveToRow(row + 1);
+        return;
+    case Qt::Key_PageUp:
+        moveToRow(row - visibleLineCount());
+        return;
+    case Qt::Key_PageDown:
+        moveToRow(row + visibleLineCount());
+        return;
+    case Qt::Key_Home:
+        moveCursor(control ? 0 : m_text.lineStart(line), false, select);
+        return;
+    case Qt::Key_End:
+        moveCursor(control ? m_text.size() : m_text.lineEnd(line), false, select);
+        return;
+    default:
+        break;
+    }
+
+    if(m_readOnly || m_filtered) {
+        QAbstractScrollArea::keyPressEvent(event);
+        return;
+    }
+
+    switch(event->key()) {
+    case Qt::Key_Backspace:
+        if(hasSelection()) {
+            removeSelection();
+        } else {
+            remove(previousPosition(m_cursor), m_cursor, Edit::Deleting);
+        }
+        return;
+    case Qt::Key_Delete:
+        if(hasSelection()) {
+            removeSelection();
+        } else {
+            remove(m_cursor, nextPosition(m_cursor), Edit::Deleting);
+        }
+        return;
+    case Qt::Key_Return:
+    case Qt::Key_Enter:
+        insert("\n");
+        return;
+    default:
+        break;
+    }
+
+    const QString text = event->text();
+    if(!text.isEmpty() && !control && (text.at(0).isPrint() || text.at(0) == QLatin1Char('\t'))) {
+        insert(text.toUtf8());
+        return;
+    }
+
+    QAbstractScrollArea::keyPressEvent(event);
+}
+
+void LargeTextView::mousePressEvent(QMouseEvent *event)
+{
+    if(rowCount() > 0 && event->button() == Qt::LeftButton) {
+        moveCursor(positionAt(event->position()), false, event->modifiers() & Qt::ShiftModifier);
+    }
+}
+
+void LargeTextView::mouseMoveEvent(QMouseEvent *event)
+{
+    if(rowCount() > 0 && (event->buttons() & Qt::LeftButton)) {
+        moveCursor(positionAt(event->position()), false, true);
+    }
+}
+
+qint64 LargeTextView::positionAt(const QPointF &point) const
+{
+    const qint64 row = verticalScrollBar()->value() + static_cast<qint64>(qMax(0.0, point.y())) / lineHeight();
+    const qint64 line = lineOfRow(qMin(row, rowCount() - 1));
+    const int x = static_cast<int>(point.x()) - gutterWidth() - 4 + horizontalScrollBar()->value();
+
+    const qint64 start = m_text.lineStart(line);
+    const QString text = QString::fromUtf8(m_text.read(start, qMin(m_text.lineEnd(line), start + MaxLineBytes) - start));
+    const QFontMetrics metrics(font());
+
+    // first column whose middle is right of the click
+    const int tab = TabStop * metrics.horizontalAdvance(QLatin1Char(' '));
+    int column = 0;
+    int columnX = 0;
+    while(column < text.size()) {
+        const int nextColumnX = nextX(metrics, tab, columnX, text.at(column));
+        if((columnX + nextColumnX) / 2 > x) {
+            break;
+        }
+        columnX = nextColumnX;
+        ++column;
+    }
+
+    return positionInLine(line, column);
+}
+
+void LargeTextView::resizeEvent(QResizeEvent *event)
+{
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBars();
+}
+
+void LargeTextView::beginEdit(Edit edit)
+{
+    if(edit == Edit::None || edit != m_lastEdit) {
+        m_undo.append({m_text.snapshot(), m_cursor});
+    }
+    m_redo.clear();
+    m_lastEdit = edit;
+}
+
+void LargeTextView::insert(const QByteArray &text)
+{
+    // typed text replaces the selection in the same undo step
+    if(hasSelection()) {
+        beginEdit(Edit::None);
+        const auto [from, to] = selection();
+        m_text.remove(from, to - from);
+        m_cursor = from;
+    } else {
+        beginEdit(Edit::Typing);
+    }
+    m_text.insert(m_cursor, text);
+    m_cursor += text.size();
+    m_column = -1;
+    edited();
+}
+
+void LargeTextView::remove(qint64 from, qint64 to, Edit edit)
+{
+    if(from >= to) {
+        return;
+    }
+    beginEdit(edit);
+    m_text.remove(from, to - from);
+    m_cursor = from;
+    m_column = -1;
+    edited();
+}
+
+void LargeTextView::removeSelection()
+{
+    const auto [from, to] = selection();
+    remove(from, to, Edit::None);
+}
+
+void LargeTextView::edited()
+{
+    // an edit ends the selection
+    m_anchor = m_cursor;
+    ++m_revision;
+    updateScrollBars();
+    ensureCursorVisible();
+    viewport()->update();
+    emit textChanged();
+    emit cursorPositionChanged();
+}
+
+qint64 LargeTextView::previousPosition(qint64 offset) const
+{
+    if(offset <= 0) {
+        return 0;
+    }
+
+    const QByteArray before = m_text.read(qMax<qint64>(offset - 4, 0), qMin<qint64>(offset, 4));
+    qsizetype i = before.size() - 1;
+    if(before.at(i) == '\n') {
+        return (i > 0 && before.at(i - 1) == '\r') ? offset - 2 : offset - 1;
+    }
+    // step over UTF-8 continuation bytes
+    while(i > 0 && (static_cast<uchar>(before.at(i)) & 0xC0) == 0x80) {
+        --i;
+    }
+    return offset - (before.size() - i);
+}
+
+qint64 LargeTextView::nextPosition(qint64 offset) const
+{
+    if(offset >= m_text.size()) {
+        return m_text.size();
+    }
+
+    const QByteArray after = m_text.read(offset, 2);
+    const uchar lead = static_cast<uchar>(after.at(0));
+    qint64 length = 1;
+    if(lead == '\r' && after.size() > 1 && after.at(1) == '\n') {
+        length = 2;
+    } else if(lead >= 0xF0) {
+        length = 4;
+    } else if(lead >= 0xE0) {
+        length = 3;
+    } else if(lead >= 0xC0) {
+        length = 2;
+    }
+    return qMin(offset + length, m_text.size());
+}
+
+qint64 LargeTextView::positionInLine(qint64 line, int column) const
+{
+    const qint64 start = m_text.lineStart(line);
+    const qint64 end = m_text.lineEnd(line);
+    const QString text = QString::fromUtf8(m_text.read(start, qMin(end, start + MaxLineBytes) - start));
+    return qMin(start + text.left(column).toUtf8().size(), end);
+}
+
+int LargeTextView::columnOf(qint64 offset) const
+{
+    const qint64 start = m_text.lineStart(m_text.lineAt(offset));
+    return static_cast<int>(QString::fromUtf8(m_text.read(start, offset - start)).size());
+}
+
+void LargeTextView::moveCursor(qint64 offset, bool keepColumn, bool select)
+{
+    m_cursor = offset;
+    if(!select) {
+        m_anchor = offset;
+    }
+    if(!keepColumn) {
+        m_column = -1;
+    }
+    m_lastEdit = Edit::None;
+    ensureCursorVisible();
+    viewport()->update();
+    emit cursorPositionChanged();
+}
+
+void LargeTextView::ensureCursorVisible()
+{
+    const qint64 line = m_text.lineAt(m_cursor);
+    const qint64 row = rowOfLine(line);
+    const qint64 first = verticalScrollBar()->value();
+    const int visible = visibleLineCount();
+    if(row < first) {
+        verticalScrollBar()->setValue(static_cast<int>(qMin<qint64>(row, INT_MAX)));
+    } else if(row >= first + visible) {
+        verticalScrollBar()->setValue(static_cast<int>(qMin<qint64>(row - visible + 1, INT_MAX)));
+    }
+
+    const qint64 start = m_text.lineStart(line);
+    const QString text = QString::fromUtf8(m_text.read(start, qMin(m_cursor - start, MaxLineBytes)));
+    const int x = advance(QFontMetrics(font()), text, static_cast<int>(text.size()));
+    const int width = viewport()->width() - gutterWidth() - 8;
+    QScrollBar *bar = horizontalScrollBar();
+    if(x < bar->value()) {
+        bar->setValue(x);
+    } else if(x > bar->value() + width) {
+        m_textWidth = qMax(m_textWidth, x);
+        updateScrollBars();
+        bar->setValue(x - width);
+    }
+}
+
+void LargeTextView::updateScrollBars()
+{
+    const int visible = visibleLineCount();
+    verticalScrollBar()->setRange(0, static_cast<int>(qMin<qint64>(qMax<qint64>(rowCount() - visible, 0), INT_MAX)));
+    verticalScrollBar()->setPageStep(visible);
+
+    const int width = viewport()->width() - gutterWidth() - 8;
+    horizontalScrollBar()->setRange(0, qMax(0, m_textWidth - width));
+    horizontalScrollBar()->setPageStep(width);
+}
+
+qint64 LargeTextView::rowCount() const
+{
+    return m_filtered ? m_filterLines.size() : m_text.lineCount();
+}
+
+qint64 LargeTextView::lineOfRow(qint64 row) const
+{
+    return m_filtered ? m_filterLines.at(row) : row;
+}
+
+qint64 LargeTextView::rowOfLine(qint64 line) const
+{
+    if(!m_filtered) {
+        return line;
+    }
+
+    // a line filtered out is shown by the next row
+    const auto it = std::lower_bound(m_filterLines.cbegin(), m_filterLines.cend(), line);
+    return qMin<qint64>(it - m_filterLines.cbegin(), qMax<qsizetype>(m_filterLines.size() - 1, 0));
+}
+
+int LargeTextView::lineHeight() const
+{
+    return qMax(1, QFontMetrics(font()).lineSpacing());
+}
+
+int LargeTextView::gutterWidth() const
+{
+    if(!m_lineNumbers) {
+        return 0;
+    }
+
+    int digits = 1;
+    for(qint64 max = m_text.lineCount(); max >= 10; max /= 10) {
+        ++digits;
+    }
+    return 3 + QFontMetrics(font()).boundingRect(QLatin1Char('9')).width() * digits + 15;
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
@@ -0,0 +1,165 @@
+//! @file
+
+#ifndef LARGETEXTVIEW_H
+#define LARGETEXTVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QVector>
+#include "piecetable.h"
+#include "searchengine.h"
+
+namespace aske {
+namespace TextEditorPrivate {
+
+/*!
+ * @brief Editor view of a `PieceTable` for files too big for `QTextDocument`.
+ *
+ * @details
+ * Nothing is laid out ahead: every paint decodes and draws only the lines
+ * which are visible, so memory and time do not depend on the file size.
+ * Vertical scrolling is line based, lines are never wrapped.
+ *
+ * Cursor is a byte offset in the text, the selection lasts from an anchor
+ * offset to the cursor. Undo and redo keep text snapshots, consecutive
+ * typing or deleting is one undo step.
+ *
+ * A filter projects the text to a list of its lines: rows of the view map
+ * to those lines, the gutter shows their own numbers. The text is not
+ * copied and is read-only while filtered.
+ */
+class LargeTextView : public QAbstractScrollArea
+{
+    Q_OBJECT
+
+public:
+    explicit LargeTextView(QWidget *parent = 0);
+
+    /*! Open `fileName` without reading it in. */
+    bool openFile(const QString &fileName);
+
+    /*! Show `text`, e.g. a snapshot of another editor. */
+    void setText(const PieceTable::Snapshot &text);
+
+    /*! Write text to `fileName`. */
+    bool saveFile(const QString &fileName);
+
+    /*! Text shown by the view. */
+    const PieceTable &text() const { return m_text; }
+
+    /*! Apply `replacements` ordered by offset as one undo step. */
+    void replace(const QVector<SearchEngine::Replacement> &replacements);
+
+    /*! Number which changes with every edit of the text. */
+    quint64 revision() const { return m_revision; }
+
+    /*! Cursor position, byte offset in `text()`. */
+    qint64 cursorPosition() const { return m_cursor; }
+    void setCursorPosition(qint64 offset);
+
+    /*! Selected byte range, empty if nothing is selected. */
+    std::pair<qint64, qint64> selection() const { return {qMin(m_anchor, m_cursor), qMax(m_anchor, m_cursor)}; }
+    bool hasSelection() const { return m_anchor != m_cursor; }
+
+    /*! Whether line numbers are shown. */
+    void setLineNumbersVisible(bool visible);
+
+    /*! Paint matches of `engine` found in visible lines, nullptr to paint none. */
+    void setSearchEngine(const SearchEngine *engine);
+
+    void setReadOnly(bool readOnly) { m_readOnly = readOnly; }
+    bool isReadOnly() const { return m_readOnly; }
+
+    qint64 firstVisibleLine() const;
+    int visibleLineCount() const;
+
+    /*! Show only `lines`, in ascending order. */
+    void setFilter(const QVector<qint64> &lines);
+
+    /*! Add `lines` after the shown ones, for lines found in batches. */
+    void appendFilter(const QVector<qint64> &lines);
+
+    void clearFilter();
+    bool isFiltered() const { return m_filtered; }
+
+public slots:
+    void undo();
+    void redo();
+
+    /*! Copy selection to the clipboard, a selection over `MaxCopyBytes` is not copied. */
+    void copy();
+    void cut();
+    void paste();
+    void selectAll();
+
+signals:
+    void textChanged();
+    void cursorPositionChanged();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void keyPressEvent(QKeyEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+
+private:
+    //! Kind of the last edit, equal consecutive edits are one undo step
+    enum class Edit {
+        None,
+        Typing,
+        Deleting,
+    };
+
+    struct UndoStep {
+        PieceTable::Snapshot text;
+        qint64 cursor;
+    };
+
+    void reset();
+    void insert(const QByteArray &text);
+    void removeSelection();
+    void remove(qint64 from, qint64 to, Edit edit);
+    void beginEdit(Edit edit);
+    void edited();
+
+    qint64 previousPosition(qint64 offset) const;
+    qint64 nextPosition(qint64 offset) const;
+    qint64 positionInLine(qint64 line, int column) const;
+    int columnOf(qint64 offset) const;
+
+    qint64 positionAt(const QPointF &point) const;
+    void moveCursor(qint64 offset, bool keepColumn = false, bool select = false);
+    void ensureCursorVisible();
+    void updateScrollBars();
+
+    qint64 rowCount() const;
+    qint64 lineOfRow(qint64 row) const;
+    qint64 rowOfLine(qint64 line) const;
+
+    int lineHeight() const;
+    int gutterWidth() const;
+
+    static constexpr qint64 MaxLineBytes = 64 * 1024; //! Longer lines are shown cut
+    static constexpr qint64 MaxCopyBytes = 256 * 1024 * 1024; //! Larger selections are not copied
+
+    PieceTable m_text;
+    qint64 m_cursor {0};
+    qint64 m_anchor {0};         //! Other end of the selection, equal to `m_cursor` if none
+    int m_column {-1};           //! Column kept by vertical moves, -1 if none
+    bool m_readOnly {false};
+    bool m_lineNumbers {true};
+    int m_textWidth {0};         //! Widest line painted so far
+    const SearchEngine *m_search {nullptr};
+    quint64 m_revision {0};
+    bool m_filtered {false};
+    QVector<qint64> m_filterLines; //! Line of every row while filtered
+
+    QVector<UndoStep> m_undo;
+    QVector<UndoStep> m_redo;
+    Edit m_lastEdit {Edit::None};
+};
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // LARGETEXTVIEW_H
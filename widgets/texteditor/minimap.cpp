@@ -0,0 +1,218 @@
+#include "minimap.h"
+
+#include <climits>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextBlock>
+#include <QTextDocument>
+#include "highlighters/highlighter.h"
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace {
+
+constexpr int TabStop = 4; //! Tab width in spaces, same as TextEditor's
+
+} // namespace
+
+Minimap::Minimap(QPlainTextEdit *editor)
+    : QWidget(editor)
+    , m_editor(editor)
+    , m_tiles(CacheTiles)
+{
+    setCursor(Qt::PointingHandCursor);
+
+    QTextDocument *document = editor->document();
+    m_revision = document->revision();
+    m_blockCount = document->blockCount();
+    connect(document, &QTextDocument::contentsChange, this, &Minimap::onContentsChange);
+
+    // viewport indicator moves, tiles stay
+    connect(editor->verticalScrollBar(), &QScrollBar::valueChanged, this, qOverload<>(&QWidget::update));
+    connect(editor->verticalScrollBar(), &QScrollBar::rangeChanged, this, qOverload<>(&QWidget::update));
+}
+
+void Minimap::setHighlighter(const Highlighter *highlighter)
+{
+    if(m_highlighter) {
+        disconnect(m_highlighter, nullptr, this, nullptr);
+    }
+    m_highlighter = highlighter;
+
+    m_colors.clear();
+    if(m_highlighter) {
+        for(const QTextCharFormat &format : m_highlighter->formats()) {
+            const QBrush brush = format.foreground();
+            m_colors.append(brush.style() != Qt::NoBrush ? brush.color().rgba() : TextColor);
+        }
+
+        // blocks are colored again as they are highlighted
+        connect(m_highlighter, &Highlighter::tokensChanged, this, [this](const QTextBlock &block) {
+            invalidate(block.blockNumber(), block.blockNumber());
+        });
+    }
+
+    m_tiles.clear();
+    update();
+}
+
+void Minimap::paintEvent(QPaintEvent *event)
+{
+    QPainter painter(this);
+    painter.fillRect(event->rect(), palette().base());
+
+    const int blockCount = m_editor->document()->blockCount();
+    const int offset = scrollOffset();
+    const int tileHeight = TileLines * LineHeight;
+    for(int index = offset / tileHeight; index * TileLines < blockCount; ++index) {
+        const int y = index * tileHeight - offset;
+        if(y > event->rect().bottom()) {
+            break;
+        }
+        if(y + tileHeight > event->rect().top()) {
+            painter.drawImage(0, y, tile(index));
+        }
+    }
+
+    const auto [first, last] = visibleBlocks();
+    painter.fillRect(QRect(0, first * LineHeight - offset, width(), (last - first + 1) * LineHeight),
+                     QColor::fromRgba(ViewportColor));
+}
+
+void Minimap::mousePressEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::LeftButton) {
+        m_dragOffset = scrollOffset();
+        scrollTo(static_cast<int>(event->position().y()));
+    }
+}
+
+void Minimap::mouseMoveEvent(QMouseEvent *event)
+{
+    if(event->buttons() & Qt::LeftButton) {
+        scrollTo(static_cast<int>(event->position().y()));
+    }
+}
+
+void Minimap::onContentsChange(int position, int /* removed */, int added)
+{
+    // formatting by highlighter does not change revision, `tokensChanged` reports it
+    QTextDocument *document = m_editor->document();
+    if(document->revision() == m_revision) {
+        return;
+    }
+    m_revision = document->revision();
+
+    // blocks after inserted or removed ones move to other tiles
+    const int first = document->findBlock(position).blockNumber();
+    if(document->blockCount() != m_blockCount) {
+        m_blockCount = document->blockCount();
+        invalidate(first, -1);
+    } else {
+        invalidate(first, document->findBlock(position + added).blockNumber());
+    }
+}
+
+void Minimap::invalidate(int first, int last)
+{
+    const int firstTile = qMax(0, first) / TileLines;
+    const int lastTile = last < 0 ? INT_MAX : last / TileLines;
+
+    // only a few tiles are cached, dropping them is cheap
+    const QList<int> tiles = m_tiles.keys();
+    bool dropped = false;
+    for(int index : tiles) {
+        if(index >= firstTile && index <= lastTile) {
+            m_tiles.remove(index);
+            dropped = true;
+        }
+    }
+    if(dropped) {
+        update();
+    }
+}
+
+const QImage &Minimap::tile(int index)
+{
+    if(const QImage *image = m_tiles.object(index)) {
+        return *image;
+    }
+
+    auto image = new QImage(Width, TileLines * LineHeight, QImage::Format_ARGB32_Premultiplied);
+    image->fill(Qt::transparent);
+
+    QTextBlock block = m_editor->document()->findBlockByNumber(index * TileLines);
+    for(int line = 0; line < TileLines && block.isValid(); ++line, block = block.next()) {
+        renderLine(block, reinterpret_cast<QRgb *>(image->scanLine(line * LineHeight)));
+    }
+
+    m_tiles.insert(index, image);
+    return *image;
+}
+
+void Minimap::renderLine(const QTextBlock &block, QRgb *line) const
+{
+    const QString text = block.text();
+    const QVector<Highlighter::Token> tokens = m_highlighter ? Highlighter::tokens(block) : QVector<Highlighter::Token>();
+
+    auto token = tokens.cbegin();
+    int x = 0;
+    for(int i = 0; i < text.size() && x < Width; ++i) {
+        const QChar c = text.at(i);
+        if(c == QLatin1Char('\t')) {
+            x += TabStop - x % TabStop;
+            continue;
+        }
+        if(!c.isSpace()) {
+            while(token != tokens.cend() && token->offset + token->length <= i) {
+                ++token;
+            }
+            const bool colored = token != tokens.cend() && token->offset <= i
+                    && token->kind >= 0 && token->kind < m_colors.size();
+            line[x] = qPremultiply(colored ? m_colors.at(token->kind) : TextColor);
+        }
+        ++x;
+    }
+}
+
+std::pair<int, int> Minimap::visibleBlocks() const
+{
+    // scroll bar counts lines, wrapped blocks take several
+    const QScrollBar *scrollBar = m_editor->verticalScrollBar();
+    const QTextDocument *document = m_editor->document();
+    const QTextBlock first = document->findBlockByLineNumber(scrollBar->value());
+    const QTextBlock last = document->findBlockByLineNumber(scrollBar->value() + scrollBar->pageStep() - 1);
+    return {first.isValid() ? first.blockNumber() : 0,
+            last.isValid() ? last.blockNumber() : document->blockCount() - 1};
+}
+
+int Minimap::scrollOffset() const
+{
+    // a tall document moves under the minimap in proportion to the editor
+    const int blockCount = m_editor->document()->blockCount();
+    const qint64 overflow = qint64(blockCount) * LineHeight - height();
+    if(overflow <= 0) {
+        return 0;
+    }
+
+    const auto [first, last] = visibleBlocks();
+    const int maxFirst = qMax(1, blockCount - (last - first + 1));
+    return static_cast<int>(qMin<qint64>(overflow, overflow * first / maxFirst));
+}
+
+void Minimap::scrollTo(int y)
+{
+    // block under `y` goes to the middle of the editor
+    const auto [first, last] = visibleBlocks();
+    const int blockCount = m_editor->document()->blockCount();
+    const int target = qBound(0, (y + m_dragOffset) / LineHeight - (last - first + 1) / 2, blockCount - 1);
+
+    const QTextBlock block = m_editor->document()->findBlockByNumber(target);
+    m_editor->verticalScrollBar()->setValue(block.firstLineNumber());
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
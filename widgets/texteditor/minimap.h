@@ -0,0 +1,81 @@
+//! @file
+
+#ifndef MINIMAP_H
+#define MINIMAP_H
+
+#include <QCache>
+#include <QImage>
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QPlainTextEdit;
+class QTextBlock;
+QT_END_NAMESPACE
+
+namespace aske {
+
+class Highlighter;
+
+namespace TextEditorPrivate {
+
+/*!
+ * @brief Downsampled picture of the whole document next to an editor.
+ *
+ * @details
+ * Every block is a line of pixels, every character a pixel colored by the
+ * highlighter's tokens. The picture is rendered in tiles of `TileLines`
+ * blocks which are kept in a small cache: painting only blits the tiles in
+ * view, an edit or a new highlighting pass drops the tiles of the blocks it
+ * touched. The viewport indicator is drawn over the tiles on every paint.
+ *
+ * A document taller than the minimap scrolls along with the editor, so the
+ * cost does not depend on the number of lines.
+ */
+class Minimap : public QWidget
+{
+    Q_OBJECT
+
+public:
+    static constexpr int Width = 100; //! Pixels, a pixel per character
+
+    explicit Minimap(QPlainTextEdit *editor);
+
+    /*! Color text by tokens of `highlighter`, none for plain text. */
+    void setHighlighter(const Highlighter *highlighter);
+
+    QSize sizeHint() const override { return QSize(Width, 0); }
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+private:
+    static constexpr int LineHeight = 2;   //! Pixels per block, the second one is a gap
+    static constexpr int TileLines = 256;  //! Blocks per tile
+    static constexpr int CacheTiles = 16;  //! Tiles kept rendered
+    static constexpr QRgb TextColor = 0x80808080;
+    static constexpr QRgb ViewportColor = 0x18000000;
+
+    void onContentsChange(int position, int removed, int added);
+    void invalidate(int first, int last);
+    const QImage &tile(int index);
+    void renderLine(const QTextBlock &block, QRgb *line) const;
+
+    std::pair<int, int> visibleBlocks() const;
+    int scrollOffset() const;
+    void scrollTo(int y);
+
+    QPlainTextEdit *m_editor;
+    const Highlighter *m_highlighter {nullptr};
+    QVector<QRgb> m_colors;       //! Token colors indexed by token kind
+    QCache<int, QImage> m_tiles;  //! Rendered tiles by index
+    int m_revision {0};           //! Revision of the document tiles follow
+    int m_blockCount {0};
+    int m_dragOffset {0};         //! Scroll offset when dragging started
+};
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // MINIMAP_H
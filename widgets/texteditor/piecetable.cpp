@@ -0,0 +1,495 @@
+#include "piecetable.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <QFile>
+#include <QSaveFile>
+#include <QThread>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace PieceTablePrivate {
+
+static constexpr qint64 AddBufferSize = 1024 * 1024; //! Minimal capacity of an add buffer
+static constexpr qint64 MinIndexPartSize = 16 * 1024 * 1024; //! Smaller buffers are indexed by fewer threads
+
+//! Storage of piece bytes, bytes once written are never changed
+struct Buffer {
+    const char *data {nullptr};
+    qint64 capacity {0};
+    qint64 used {0};
+    bool appendable {false};        //! Add buffer, inserted text is appended to it
+
+    std::unique_ptr<char[]> owned;  //! Add buffer or copied text
+    std::unique_ptr<QFile> file;    //! Keeps mapping of the original file alive
+    std::vector<qint64> lineFeeds;  //! Offsets of all `\n`, only for non-appendable buffers
+
+    /*!
+     * Fill `lineFeeds`, threads count line feeds of their parts first, so
+     * the index is allocated once at its exact size and filled in place.
+     */
+    void indexLineFeeds() {
+        const qint64 parts = qBound<qint64>(1, used / MinIndexPartSize, QThread::idealThreadCount());
+        const qint64 partSize = used / parts + 1;
+        auto forEachPart = [&](auto job) {
+            std::vector<std::thread> workers;
+            for(qint64 part = 1; part < parts; ++part) {
+                workers.emplace_back(job, part);
+            }
+            job(0);
+            for(std::thread &worker : workers) {
+                worker.join();
+            }
+        };
+        auto forEachLineFeed = [&](qint64 part, auto visit) {
+            const char *p = data + qMin(used, part * partSize);
+            const char *end = data + qMin(used, (part + 1) * partSize);
+            while((p = static_cast<const char *>(std::memchr(p, '\n', end - p)))) {
+                visit(p - data);
+                ++p;
+            }
+        };
+
+        std::vector<qint64> firsts(parts + 1, 0);
+        forEachPart([&](qint64 part) {
+            qint64 count = 0;
+            forEachLineFeed(part, [&](qint64) { ++count; });
+            firsts[part + 1] = count;
+        });
+        for(qint64 part = 0; part < parts; ++part) {
+            firsts[part + 1] += firsts[part];
+        }
+
+        lineFeeds.resize(firsts[parts]);
+        forEachPart([&](qint64 part) {
+            qint64 *out = lineFeeds.data() + firsts[part];
+            forEachLineFeed(part, [&](qint64 offset) { *out++ = offset; });
+        });
+    }
+
+    /*! Number of `\n` in `[from, to)`. */
+    qint64 countLineFeeds(qint64 from, qint64 to) const {
+        if(!appendable) {
+            return std::lower_bound(lineFeeds.cbegin(), lineFeeds.cend(), to)
+                   - std::lower_bound(lineFeeds.cbegin(), lineFeeds.cend(), from);
+        }
+        return std::count(data + from, data + to, '\n');
+    }
+
+    /*! Offset of `k`-th (from 0) `\n` in `[from, to)`, `to` if there is none. */
+    qint64 findLineFeed(qint64 from, qint64 to, qint64 k) const {
+        if(!appendable) {
+            auto it = std::lower_bound(lineFeeds.cbegin(), lineFeeds.cend(), from) + k;
+            return (it < lineFeeds.cend() && *it < to) ? *it : to;
+        }
+        const char *p = data + from;
+        const char *end = data + to;
+        while((p = static_cast<const char *>(std::memchr(p, '\n', end - p)))) {
+            if(k-- == 0) {
+                return p - data;
+            }
+            ++p;
+        }
+        return to;
+    }
+};
+
+struct Piece {
+    quint32 buffer;
+    qint64 start;
+    qint64 length;
+    qint64 lineFeeds;
+};
+
+using NodePtr = std::shared_ptr<const Node>;
+
+//! Treap node, aggregates cover the whole subtree
+struct Node {
+    Piece piece;
+    quint32 priority;
+    NodePtr left;
+    NodePtr right;
+    qint64 bytes;
+    qint64 lineFeeds;
+};
+
+} // namespace PieceTablePrivate
+
+using namespace PieceTablePrivate;
+
+namespace {
+
+quint32 nextPriority()
+{
+    static thread_local quint32 state = 2463534242u;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+qint64 bytesOf(const NodePtr &node) { return node ? node->bytes : 0; }
+qint64 lineFeedsOf(const NodePtr &node) { return node ? node->lineFeeds : 0; }
+
+NodePtr makeNode(const Piece &piece, quint32 priority, NodePtr left, NodePtr right)
+{
+    const qint64 bytes = bytesOf(left) + piece.length + bytesOf(right);
+    const qint64 lineFeeds = lineFeedsOf(left) + piece.lineFeeds + lineFeedsOf(right);
+    return std::make_shared<Node>(Node {piece, priority, std::move(left), std::move(right), bytes, lineFeeds});
+}
+
+//! Split `node` into first `offset` bytes and the rest
+std::pair<NodePtr, NodePtr> split(const NodePtr &node, qint64 offset, const Buffers &buffers)
+{
+    if(!node) {
+        return {};
+    }
+
+    const qint64 leftBytes = bytesOf(node->left);
+    const Piece &piece = node->piece;
+
+    if(offset <= leftBytes) {
+        auto parts = split(node->left, offset, buffers);
+        return {parts.first, makeNode(piece, node->priority, parts.second, node->right)};
+    }
+    if(offset >= leftBytes + piece.length) {
+        auto parts = split(node->right, offset - leftBytes - piece.length, buffers);
+        return {makeNode(piece, node->priority, node->left, parts.first), parts.second};
+    }
+
+    // offset is inside of the piece
+    const qint64 head = offset - leftBytes;
+    const qint64 headLineFeeds = buffers[piece.buffer]->countLineFeeds(piece.start, piece.start + head);
+    const Piece first {piece.buffer, piece.start, head, headLineFeeds};
+    const Piece second {piece.buffer, piece.start + head, piece.length - head, piece.lineFeeds - headLineFeeds};
+    return {makeNode(first, node->priority, node->left, nullptr),
+            makeNode(second, node->priority, nullptr, node->right)};
+}
+
+NodePtr merge(const NodePtr &a, const NodePtr &b)
+{
+    if(!a) {
+        return b;
+    }
+    if(!b) {
+        return a;
+    }
+    if(a->priority > b->priority) {
+        return makeNode(a->piece, a->priority, a->left, merge(a->right, b));
+    }
+    return makeNode(b->piece, b->priority, merge(a, b->left), b->right);
+}
+
+const Node *lastNode(const Node *node)
+{
+    while(node && node->right) {
+        node = node->right.get();
+    }
+    return node;
+}
+
+NodePtr extendLast(const NodePtr &node, qint64 bytes, qint64 lineFeeds)
+{
+    if(!node->right) {
+        Piece piece = node->piece;
+        piece.length += bytes;
+        piece.lineFeeds += lineFeeds;
+        return makeNode(piece, node->priority, node->left, nullptr);
+    }
+    return makeNode(node->piece, node->priority, node->left, extendLast(node->right, bytes, lineFeeds));
+}
+
+void collect(const Node *node, qint64 base, qint64 from, qint64 to, const Buffers &buffers, QByteArray &out)
+{
+    if(!node || from >= to) {
+        return;
+    }
+
+    const qint64 begin = base + bytesOf(node->left);
+    const qint64 end = begin + node->piece.length;
+
+    if(from < begin) {
+        collect(node->left.get(), base, from, qMin(to, begin), buffers, out);
+    }
+    const qint64 a = qMax(from, begin);
+    const qint64 b = qMin(to, end);
+    if(a < b) {
+        out.append(buffers[node->piece.buffer]->data + node->piece.start + (a - begin), b - a);
+    }
+    if(to > end) {
+        collect(node->right.get(), end, qMax(from, end), to, buffers, out);
+    }
+}
+
+} // namespace
+
+//
+// SNAPSHOT
+//
+
+PieceTable::Snapshot::Snapshot()
+    : m_buffers(std::make_shared<const Buffers>())
+{
+}
+
+qint64 PieceTable::Snapshot::size() const
+{
+    return bytesOf(m_root);
+}
+
+qint64 PieceTable::Snapshot::lineCount() const
+{
+    return lineFeedsOf(m_root) + 1;
+}
+
+qint64 PieceTable::Snapshot::lineStart(qint64 line) const
+{
+    if(line <= 0) {
+        return 0;
+    }
+    if(line >= lineCount()) {
+        return size();
+    }
+
+    // line starts after it's `line`-th line feed
+    qint64 k = line;
+    qint64 base = 0;
+    const Node *node = m_root.get();
+    while(node) {
+        const qint64 leftLineFeeds = lineFeedsOf(node->left);
+        if(k <= leftLineFeeds) {
+            node = node->left.get();
+            continue;
+        }
+        base += bytesOf(node->left);
+        k -= leftLineFeeds;
+
+        const Piece &piece = node->piece;
+        if(k <= piece.lineFeeds) {
+            const Buffer &buffer = *(*m_buffers)[piece.buffer];
+            const qint64 at = buffer.findLineFeed(piece.start, piece.start + piece.length, k - 1);
+            return base + (at - piece.start) + 1;
+        }
+        k -= piece.lineFeeds;
+        base += piece.length;
+        node = node->right.get();
+    }
+    return size();
+}
+
+qint64 PieceTable::Snapshot::lineEnd(qint64 line) const
+{
+    const qint64 start = lineStart(line);
+    qint64 end = line + 1 < lineCount() ? lineStart(line + 1) - 1 : size();
+    if(end > start && read(end - 1, 1) == "\r") {
+        --end;
+    }
+    return end;
+}
+
+qint64 PieceTable::Snapshot::lineAt(qint64 offset) const
+{
+    qint64 line = 0;
+    const Node *node = m_root.get();
+    while(node) {
+        const qint64 leftBytes = bytesOf(node->left);
+        if(offset < leftBytes) {
+            node = node->left.get();
+            continue;
+        }
+        offset -= leftBytes;
+        line += lineFeedsOf(node->left);
+
+        const Piece &piece = node->piece;
+        if(offset < piece.length) {
+            const Buffer &buffer = *(*m_buffers)[piece.buffer];
+            return line + buffer.countLineFeeds(piece.start, piece.start + offset);
+        }
+        offset -= piece.length;
+        line += piece.lineFeeds;
+        node = node->right.get();
+    }
+    return line;
+}
+
+QByteArray PieceTable::Snapshot::read(qint64 offset, qint64 length) const
+{
+    QByteArray out;
+    const qint64 from = qBound<qint64>(0, offset, size());
+    const qint64 to = qBound<qint64>(from, offset + length, size());
+    out.reserve(to - from);
+    collect(m_root.get(), 0, from, to, *m_buffers, out);
+    return out;
+}
+
+QString PieceTable::Snapshot::line(qint64 line) const
+{
+    const qint64 start = lineStart(line);
+    return QString::fromUtf8(read(start, lineEnd(line) - start));
+}
+
+void PieceTable::Snapshot::visit(qint64 from, qint64 to, const std::function<bool(const char *, qint64)> &chunk) const
+{
+    // explicit stack of nodes with offsets of their subtrees: subtrees
+    // before `from` are skipped, visiting stops after `to` or when asked to
+    std::vector<std::pair<const Node *, qint64>> stack;
+    const Node *node = m_root.get();
+    qint64 base = 0;
+    while(node || !stack.empty()) {
+        while(node) {
+            stack.push_back({node, base});
+            node = from < base + bytesOf(node->left) ? node->left.get() : nullptr;
+        }
+        const Node *current = stack.back().first;
+        const qint64 begin = stack.back().second + bytesOf(current->left);
+        const qint64 end = begin + current->piece.length;
+        stack.pop_back();
+        if(begin >= to) {
+            return;
+        }
+
+        const qint64 a = qMax(from, begin);
+        const qint64 b = qMin(to, end);
+        if(a < b && !chunk((*m_buffers)[current->piece.buffer]->data + current->piece.start + (a - begin), b - a)) {
+            return;
+        }
+        node = current->right.get();
+        base = end;
+    }
+}
+
+//
+// PIECE TABLE
+//
+
+PieceTable::PieceTable() = default;
+PieceTable::~PieceTable() = default;
+
+bool PieceTable::open(const QString &fileName)
+{
+    auto buffer = std::make_shared<Buffer>();
+    buffer->file = std::make_unique<QFile>(fileName);
+    if(!buffer->file->open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const qint64 size = buffer->file->size();
+    if(size > 0) {
+        buffer->data = reinterpret_cast<const char *>(buffer->file->map(0, size));
+        if(!buffer->data) {
+            // no mmap for this file system, fall back to a copy
+            buffer->owned.reset(new char[size]);
+            if(buffer->file->read(buffer->owned.get(), size) != size) {
+                return false;
+            }
+            buffer->data = buffer->owned.get();
+        }
+    }
+    buffer->capacity = buffer->used = size;
+    buffer->indexLineFeeds();
+
+    m_text.m_buffers = std::make_shared<const Buffers>(Buffers {buffer});
+    m_text.m_root = size > 0
+            ? makeNode({0, 0, size, static_cast<qint64>(buffer->lineFeeds.size())}, nextPriority(), nullptr, nullptr)
+            : nullptr;
+    return true;
+}
+
+void PieceTable::setText(const QByteArray &text)
+{
+    auto buffer = std::make_shared<Buffer>();
+    buffer->owned.reset(new char[qMax<qsizetype>(text.size(), 1)]);
+    std::memcpy(buffer->owned.get(), text.constData(), text.size());
+    buffer->data = buffer->owned.get();
+    buffer->capacity = buffer->used = text.size();
+    buffer->indexLineFeeds();
+
+    m_text.m_buffers = std::make_shared<const Buffers>(Buffers {buffer});
+    m_text.m_root = !text.isEmpty()
+            ? makeNode({0, 0, text.size(), static_cast<qint64>(buffer->lineFeeds.size())}, nextPriority(), nullptr, nullptr)
+            : nullptr;
+}
+
+Buffer *PieceTable::addBuffer(qint64 space)
+{
+    const Buffers &buffers = *m_text.m_buffers;
+    if(!buffers.empty()) {
+        Buffer *last = buffers.back().get();
+        if(last->appendable && last->capacity - last->used >= space) {
+            return last;
+        }
+    }
+
+    auto buffer = std::make_shared<Buffer>();
+    buffer->capacity = qMax(space, AddBufferSize);
+    buffer->owned.reset(new char[buffer->capacity]);
+    buffer->data = buffer->owned.get();
+    buffer->appendable = true;
+
+    // snapshots keep their own buffer lists, so list is never changed in place
+    auto list = std::make_shared<Buffers>(buffers);
+    list->push_back(buffer);
+    m_text.m_buffers = list;
+    return buffer.get();
+}
+
+void PieceTable::insert(qint64 offset, const QByteArray &text)
+{
+    if(text.isEmpty()) {
+        return;
+    }
+    offset = qBound<qint64>(0, offset, size());
+
+    Buffer *buffer = addBuffer(text.size());
+    const quint32 index = static_cast<quint32>(m_text.m_buffers->size() - 1);
+    const qint64 start = buffer->used;
+    std::memcpy(buffer->owned.get() + start, text.constData(), text.size());
+    buffer->used += text.size();
+
+    const Piece piece {index, start, text.size(), static_cast<qint64>(std::count(text.cbegin(), text.cend(), '\n'))};
+
+    auto parts = split(m_text.m_root, offset, *m_text.m_buffers);
+
+    // typing appends to the piece typed before instead of adding a new one
+    const Node *last = lastNode(parts.first.get());
+    if(last && last->piece.buffer == index && last->piece.start + last->piece.length == start) {
+        parts.first = extendLast(parts.first, piece.length, piece.lineFeeds);
+    } else {
+        parts.first = merge(parts.first, makeNode(piece, nextPriority(), nullptr, nullptr));
+    }
+    m_text.m_root = merge(parts.first, parts.second);
+}
+
+void PieceTable::remove(qint64 offset, qint64 length)
+{
+    offset = qBound<qint64>(0, offset, size());
+    length = qBound<qint64>(0, length, size() - offset);
+    if(length == 0) {
+        return;
+    }
+
+    auto head = split(m_text.m_root, offset, *m_text.m_buffers);
+    auto tail = split(head.second, length, *m_text.m_buffers);
+    m_text.m_root = merge(head.first, tail.second);
+}
+
+bool PieceTable::save(const QString &fileName) const
+{
+    // original file may be mapped: write a new file and replace it
+    QSaveFile file(fileName);
+    if(!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    bool ok = true;
+    m_text.forEachChunk([&](const char *data, qint64 size) {
+        ok = file.write(data, size) == size;
+        return ok;
+    });
+    return ok && file.commit();
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
@@ -0,0 +1,138 @@
+//! @file
+
+#ifndef PIECETABLE_H
+#define PIECETABLE_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <QByteArray>
+#include <QString>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace PieceTablePrivate {
+struct Buffer;
+struct Node;
+using Buffers = std::vector<std::shared_ptr<Buffer>>;
+} // namespace PieceTablePrivate
+
+/*!
+ * @brief Editable UTF-8 text over a memory mapped file.
+ *
+ * @details
+ * Text is a sequence of pieces. A piece is a range of either the original
+ * file, which is mapped and never copied, or of an append-only add buffer
+ * holding inserted text. Pieces live in a persistent balanced tree which
+ * caches byte and line feed counts of every subtree, so edits and lookups
+ * between offsets and lines are O(log n).
+ *
+ * Edits never change existing nodes or buffer bytes, they build a new tree
+ * sharing all untouched nodes. A `Snapshot` is therefore just a saved root:
+ * undo restores one in O(1), and a worker thread may read a snapshot while
+ * the text is being edited.
+ *
+ * Lines are separated by `\n`, a `\r` before it is not part of the line.
+ */
+class PieceTable
+{
+public:
+    //! Immutable state of the text, cheap to copy
+    class Snapshot
+    {
+    public:
+        Snapshot();
+
+        /*! Size in bytes. */
+        qint64 size() const;
+
+        /*! Number of lines, an empty text has one line. */
+        qint64 lineCount() const;
+
+        /*! Offset of the first byte of `line`. */
+        qint64 lineStart(qint64 line) const;
+
+        /*! Offset after the last byte of `line`, line break excluded. */
+        qint64 lineEnd(qint64 line) const;
+
+        /*! Line containing byte at `offset`. */
+        qint64 lineAt(qint64 offset) const;
+
+        /*! `length` bytes from `offset`. */
+        QByteArray read(qint64 offset, qint64 length) const;
+
+        /*! Decoded text of `line` without line break. */
+        QString line(qint64 line) const;
+
+        /*! Call `chunk(data, size)` for every piece in text order, stop when it returns false. */
+        template<class Chunk>
+        void forEachChunk(Chunk chunk) const;
+
+        /*! Same for bytes in range [`from`, `to`), the first and the last piece are cut. */
+        template<class Chunk>
+        void forEachChunk(qint64 from, qint64 to, Chunk chunk) const;
+
+    private:
+        friend class PieceTable;
+
+        std::shared_ptr<const PieceTablePrivate::Node> m_root;
+        std::shared_ptr<const PieceTablePrivate::Buffers> m_buffers;
+
+        void visit(qint64 from, qint64 to, const std::function<bool(const char *, qint64)> &chunk) const;
+    };
+
+    PieceTable();
+    ~PieceTable();
+
+    /*! Map `fileName` as the original text. Returns false if it can not be read. */
+    bool open(const QString &fileName);
+
+    /*! Replace the whole text with a copy of `text`. */
+    void setText(const QByteArray &text);
+
+    qint64 size() const { return m_text.size(); }
+    qint64 lineCount() const { return m_text.lineCount(); }
+    qint64 lineStart(qint64 line) const { return m_text.lineStart(line); }
+    qint64 lineEnd(qint64 line) const { return m_text.lineEnd(line); }
+    qint64 lineAt(qint64 offset) const { return m_text.lineAt(offset); }
+    QByteArray read(qint64 offset, qint64 length) const { return m_text.read(offset, length); }
+    QString line(qint64 line) const { return m_text.line(line); }
+
+    /*! Insert UTF-8 `text` at `offset`. */
+    void insert(qint64 offset, const QByteArray &text);
+
+    /*! Remove `length` bytes from `offset`. */
+    void remove(qint64 offset, qint64 length);
+
+    /*! Current state of the text. */
+    const Snapshot &snapshot() const { return m_text; }
+
+    /*! Go back (or forth) to `snapshot` of this table. */
+    void restore(const Snapshot &snapshot) { m_text = snapshot; }
+
+    /*! Write pieces to `fileName` one after another. */
+    bool save(const QString &fileName) const;
+
+private:
+    PieceTablePrivate::Buffer *addBuffer(qint64 space);
+
+    Snapshot m_text;
+};
+
+template<class Chunk>
+void PieceTable::Snapshot::forEachChunk(Chunk chunk) const
+{
+    visit(0, size(), chunk);
+}
+
+template<class Chunk>
+void PieceTable::Snapshot::forEachChunk(qint64 from, qint64 to, Chunk chunk) const
+{
+    visit(from, to, chunk);
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // PIECETABLE_H
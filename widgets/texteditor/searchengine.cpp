@@ -0,0 +1,461 @@
+#include "searchengine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <QByteArrayMatcher>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+
+namespace aske {
+namespace TextEditorPrivate {
+
+namespace {
+
+constexpr qint64 SliceSize = 1024 * 1024; //! Literal search checks for cancel after every slice
+
+//! Whether `query` is matched by bytes
+bool isLiteral(const SearchEngine::Query &query)
+{
+    return !query.regex && query.caseSensitive && !query.wholeWords;
+}
+
+QRegularExpression makeRegex(const SearchEngine::Query &query)
+{
+    QString pattern = query.regex ? query.pattern : QRegularExpression::escape(query.pattern);
+    if(query.wholeWords) {
+        pattern = QStringLiteral("\\b(?:%1)\\b").arg(pattern);
+    }
+
+    QRegularExpression::PatternOptions options = QRegularExpression::UseUnicodePropertiesOption;
+    if(!query.caseSensitive) {
+        options |= QRegularExpression::CaseInsensitiveOption;
+    }
+
+    QRegularExpression regex(pattern, options);
+    regex.optimize();
+    return regex;
+}
+
+//! `replacement` with `\0`...`\9` replaced by captures of `match`
+QString expand(const QString &replacement, const QRegularExpressionMatch &match)
+{
+    QString result;
+    result.reserve(replacement.size());
+    for(int i = 0; i < replacement.size(); ++i) {
+        const QChar c = replacement.at(i);
+        if(c == QLatin1Char('\\') && i + 1 < replacement.size()) {
+            const QChar next = replacement.at(i + 1);
+            if(next.isDigit()) {
+                result += match.captured(next.digitValue());
+                ++i;
+                continue;
+            }
+            if(next == QLatin1Char('\\')) {
+                result += next;
+                ++i;
+                continue;
+            }
+        }
+        result += c;
+    }
+    return result;
+}
+
+//! UTF-8 size of `text` without encoding it
+qint64 utf8Size(QStringView text)
+{
+    qint64 size = 0;
+    for(QChar c : text) {
+        const ushort u = c.unicode();
+        size += u < 0x80 ? 1 : u < 0x800 ? 2 : c.isHighSurrogate() ? 4 : c.isLowSurrogate() ? 0 : 3;
+    }
+    return size;
+}
+
+//! Non overlapping occurrences of `matcher`'s pattern starting in [`from`, `to`)
+template<class Report>
+void scanLiteral(const PieceTable::Snapshot &text, const QByteArrayMatcher &matcher, qint64 from, qint64 to,
+                 Report &report, const std::atomic<bool> &cancel)
+{
+    const qint64 n = matcher.pattern().size();
+    QByteArray tail;    // last `n - 1` bytes before `offset`, matches may start there
+    qint64 offset = from;
+    qint64 next = from; // where the next match may start
+
+    auto scanSlice = [&](const char *data, qint64 size) {
+        if(!tail.isEmpty()) {
+            const QByteArray joint = tail + QByteArray::fromRawData(data, qMin(size, n - 1));
+            for(qsizetype at = matcher.indexIn(joint); at >= 0 && at < tail.size(); at = matcher.indexIn(joint, at + 1)) {
+                const qint64 match = offset - tail.size() + at;
+                if(match >= next && match < to) {
+                    report(match, n, nullptr);
+                    next = match + n;
+                }
+            }
+        }
+
+        for(qsizetype at = matcher.indexIn(data, size, qMax<qint64>(next - offset, 0));
+            at >= 0 && offset + at < to;
+            at = matcher.indexIn(data, size, at + n)) {
+            report(offset + at, n, nullptr);
+            next = offset + at + n;
+        }
+
+        if(size >= n - 1) {
+            tail = QByteArray(data + size - (n - 1), n - 1);
+        } else {
+            tail = (tail + QByteArray(data, size)).right(n - 1);
+        }
+        offset += size;
+    };
+
+    text.forEachChunk(from, qMin(to + n - 1, text.size()), [&](const char *data, qint64 size) {
+        for(qint64 at = 0; at < size; at += SliceSize) {
+            if(cancel) {
+                return false;
+            }
+            scanSlice(data + at, qMin(SliceSize, size - at));
+        }
+        return true;
+    });
+}
+
+//! Matches of `regex` in lines starting in [`from`, `to`), which is line aligned
+template<class Report>
+void scanLines(const PieceTable::Snapshot &text, const QRegularExpression &regex, qint64 from, qint64 to,
+               Report &report, const std::atomic<bool> &cancel)
+{
+    qint64 lineStart = from;
+    QByteArray pending; // start of a line cut by the end of a piece
+
+    auto searchLine = [&](const char *data, qint64 size) {
+        if(size > 0 && data[size - 1] == '\r') {
+            --size;
+        }
+        const QString line = QString::fromUtf8(data, size);
+        const bool ascii = line.size() == size;
+
+        // matches come in order, UTF-8 sizes are measured from the previous one
+        const QStringView view(line);
+        qsizetype measured = 0;
+        qint64 measuredBytes = 0;
+        QRegularExpressionMatchIterator it = regex.globalMatch(line);
+        while(it.hasNext()) {
+            const QRegularExpressionMatch match = it.next();
+            if(match.capturedLength() == 0) {
+                continue;
+            }
+            if(ascii) {
+                report(lineStart + match.capturedStart(), match.capturedLength(), &match);
+            } else {
+                measuredBytes += utf8Size(view.mid(measured, match.capturedStart() - measured));
+                const qint64 length = utf8Size(view.mid(match.capturedStart(), match.capturedLength()));
+                report(lineStart + measuredBytes, length, &match);
+                measured = match.capturedStart() + match.capturedLength();
+                measuredBytes += length;
+            }
+        }
+    };
+
+    qint64 offset = from;
+    text.forEachChunk(from, to, [&](const char *data, qint64 size) {
+        qint64 begin = 0;
+        while(const char *feed = static_cast<const char *>(std::memchr(data + begin, '\n', size - begin))) {
+            if(cancel) {
+                return false;
+            }
+
+            const qint64 end = feed - data;
+            if(pending.isEmpty()) {
+                searchLine(data + begin, end - begin);
+            } else {
+                pending.append(data + begin, end - begin);
+                searchLine(pending.constData(), pending.size());
+                pending.clear();
+            }
+            begin = end + 1;
+            lineStart = offset + begin;
+        }
+        pending.append(data + begin, size - begin);
+        offset += size;
+        return true;
+    });
+
+    if(!pending.isEmpty() && !cancel) {
+        searchLine(pending.constData(), pending.size());
+    }
+}
+
+} // namespace
+
+SearchEngine::SearchEngine(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SearchEngine::~SearchEngine()
+{
+    cancel();
+}
+
+bool SearchEngine::start(const PieceTable::Snapshot &text, const Query &query, qint64 visibleFrom, qint64 visibleTo)
+{
+    cancel();
+
+    if(query.pattern.isEmpty() || !makeRegex(query).isValid()) {
+        return false;
+    }
+
+    m_text = text;
+    m_running = true;
+    m_thread = std::thread(&SearchEngine::run, this, query, visibleFrom, visibleTo, m_generation);
+    return true;
+}
+
+bool SearchEngine::startReplace(const PieceTable::Snapshot &text, const Query &query, const QString &replacement)
+{
+    cancel();
+
+    if(query.pattern.isEmpty() || !makeRegex(query).isValid()) {
+        return false;
+    }
+
+    m_text = text;
+    m_running = true;
+    m_thread = std::thread(&SearchEngine::runReplace, this, query, replacement, m_generation);
+    return true;
+}
+
+bool SearchEngine::startFilter(const PieceTable::Snapshot &text, const Query &query)
+{
+    cancel();
+
+    if(query.pattern.isEmpty() || !makeRegex(query).isValid()) {
+        return false;
+    }
+
+    m_text = text;
+    m_running = true;
+    m_thread = std::thread(&SearchEngine::runFilter, this, query, m_generation);
+    return true;
+}
+
+QByteArray SearchEngine::replaced(const PieceTable::Snapshot &text, const QVector<Replacement> &replacements,
+                                  qint64 from, qint64 to)
+{
+    qint64 size = to - from;
+    for(const Replacement &replacement : replacements) {
+        size += replacement.text.size() - replacement.length;
+    }
+
+    QByteArray result;
+    result.reserve(size);
+    auto copy = [&](qint64 a, qint64 b) {
+        text.forEachChunk(a, b, [&](const char *data, qint64 length) {
+            result.append(data, length);
+            return true;
+        });
+    };
+
+    qint64 at = from;
+    for(const Replacement &replacement : replacements) {
+        if(replacement.offset < at || replacement.offset + replacement.length > to) {
+            continue;
+        }
+        copy(at, replacement.offset);
+        result.append(replacement.text);
+        at = replacement.offset + replacement.length;
+    }
+    copy(at, to);
+    return result;
+}
+
+void SearchEngine::cancel()
+{
+    m_cancel = true;
+    if(m_thread.joinable()) {
+        m_thread.join();
+    }
+    m_cancel = false;
+
+    ++m_generation;
+    m_running = false;
+    m_matches.clear();
+    m_insertAt = 0;
+    if(m_count.exchange(0) != 0) {
+        emit countChanged(0);
+    }
+}
+
+QVector<SearchEngine::Match> SearchEngine::matchesIn(qint64 from, qint64 to) const
+{
+    auto byOffset = [](const Match &match, qint64 offset) { return match.offset < offset; };
+    const auto begin = std::lower_bound(m_matches.cbegin(), m_matches.cend(), from, byOffset);
+    const auto end = std::lower_bound(begin, m_matches.cend(), to, byOffset);
+
+    QVector<Match> matches;
+    matches.reserve(end - begin);
+    std::copy(begin, end, std::back_inserter(matches));
+    return matches;
+}
+
+void SearchEngine::run(Query query, qint64 visibleFrom, qint64 visibleTo, quint64 generation)
+{
+    QVector<Match> batch;
+    Phase phase = Phase::Visible;
+    QElapsedTimer timer;
+    timer.start();
+
+    auto flush = [&]() {
+        if(!batch.isEmpty()) {
+            QMetaObject::invokeMethod(this, [this, batch, phase, generation]() {
+                receive(batch, phase, generation);
+            }, Qt::QueuedConnection);
+            batch.clear();
+        }
+        timer.restart();
+    };
+
+    auto report = [&](qint64 offset, qint64 length, const QRegularExpressionMatch *) {
+        batch.append({offset, length});
+        ++m_count;
+        if(batch.size() >= BatchSize || timer.elapsed() >= BatchInterval) {
+            flush();
+        }
+    };
+
+    const bool literal = isLiteral(query);
+    const QByteArrayMatcher matcher(query.pattern.toUtf8());
+    const QRegularExpression regex = literal ? QRegularExpression() : makeRegex(query);
+
+    auto scan = [&](qint64 from, qint64 to) {
+        if(from >= to) {
+            return;
+        }
+        if(literal) {
+            scanLiteral(m_text, matcher, from, to, report, m_cancel);
+        } else {
+            scanLines(m_text, regex, from, to, report, m_cancel);
+        }
+        flush();
+    };
+
+    // whole lines, so that regular expressions see them entirely
+    const qint64 first = m_text.lineStart(m_text.lineAt(qBound<qint64>(0, visibleFrom, m_text.size())));
+    const qint64 last = m_text.lineStart(m_text.lineAt(qBound<qint64>(first, visibleTo, m_text.size())) + 1);
+
+    scan(first, last);
+    phase = Phase::Before;
+    scan(0, first);
+    phase = Phase::After;
+    scan(last, m_text.size());
+
+    finish(generation);
+}
+
+void SearchEngine::finish(quint64 generation)
+{
+    if(!m_cancel) {
+        QMetaObject::invokeMethod(this, [this, generation]() {
+            if(generation != m_generation) {
+                return;
+            }
+            m_running = false;
+            emit countChanged(m_count);
+            emit finished(m_count);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void SearchEngine::runReplace(Query query, QString replacement, quint64 generation)
+{
+    QVector<Replacement> replacements;
+    const QByteArray text = replacement.toUtf8();
+
+    auto report = [&](qint64 offset, qint64 length, const QRegularExpressionMatch *match) {
+        // literal text is shared by all replacements
+        replacements.append({offset, length, match && query.regex ? expand(replacement, *match).toUtf8() : text});
+        ++m_count;
+    };
+
+    if(isLiteral(query)) {
+        scanLiteral(m_text, QByteArrayMatcher(query.pattern.toUtf8()), 0, m_text.size(), report, m_cancel);
+    } else {
+        scanLines(m_text, makeRegex(query), 0, m_text.size(), report, m_cancel);
+    }
+
+    if(!m_cancel) {
+        QMetaObject::invokeMethod(this, [this, replacements, generation]() {
+            if(generation != m_generation) {
+                return;
+            }
+            m_running = false;
+            emit replaceReady(replacements);
+        }, Qt::QueuedConnection);
+    }
+}
+
+void SearchEngine::runFilter(Query query, quint64 generation)
+{
+    QVector<qint64> batch;
+    QElapsedTimer timer;
+    timer.start();
+
+    auto flush = [&]() {
+        if(!batch.isEmpty()) {
+            QMetaObject::invokeMethod(this, [this, batch, generation]() {
+                if(generation == m_generation) {
+                    emit linesFound(batch);
+                    emit countChanged(m_count);
+                }
+            }, Qt::QueuedConnection);
+            batch.clear();
+        }
+        timer.restart();
+    };
+
+    // a line is looked up in the line index once, for its first match
+    qint64 nextLine = 0;
+    auto report = [&](qint64 offset, qint64, const QRegularExpressionMatch *) {
+        if(offset < nextLine) {
+            return;
+        }
+        const qint64 line = m_text.lineAt(offset);
+        nextLine = m_text.lineStart(line + 1);
+        batch.append(line);
+        ++m_count;
+        if(batch.size() >= BatchSize || timer.elapsed() >= BatchInterval) {
+            flush();
+        }
+    };
+
+    if(isLiteral(query)) {
+        scanLiteral(m_text, QByteArrayMatcher(query.pattern.toUtf8()), 0, m_text.size(), report, m_cancel);
+    } else {
+        scanLines(m_text, makeRegex(query), 0, m_text.size(), report, m_cancel);
+    }
+    flush();
+
+    finish(generation);
+}
+
+void SearchEngine::receive(const QVector<Match> &batch, Phase phase, quint64 generation)
+{
+    if(generation != m_generation) {
+        return;
+    }
+
+    if(phase == Phase::Before) {
+        m_matches.insert(m_insertAt, batch.size(), Match());
+        std::copy(batch.cbegin(), batch.cend(), m_matches.begin() + m_insertAt);
+        m_insertAt += batch.size();
+    } else {
+        m_matches.append(batch);
+    }
+
+    emit matchesFound(batch.first().offset, batch.last().offset + 1);
+    emit countChanged(m_count);
+}
+
+} // namespace TextEditorPrivate
+} // namespace aske
@@ -0,0 +1,140 @@
+//! @file
+
+#ifndef SEARCHENGINE_H
+#define SEARCHENGINE_H
+
+#include <atomic>
+#include <thread>
+#include <QObject>
+#include <QVector>
+#include "piecetable.h"
+
+namespace aske {
+namespace TextEditorPrivate {
+
+/*!
+ * @brief Searches a text snapshot on a worker thread.
+ *
+ * @details
+ * Literal case sensitive patterns are matched by bytes with `QByteArrayMatcher`
+ * right over the pieces, other queries are regular expressions run line by
+ * line. Matches never span lines in that case.
+ *
+ * The visible range is scanned first, the rest of the text after it. Matches
+ * come back to the GUI thread in batches and are kept sorted by offset, so
+ * the view can paint `matchesIn()` its range long before the scan finishes.
+ */
+class SearchEngine : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Query {
+        QString pattern;
+        bool regex {false};
+        bool caseSensitive {false};
+        bool wholeWords {false};
+    };
+
+    //! Match range in bytes of the searched snapshot
+    struct Match {
+        qint64 offset;
+        qint64 length;
+    };
+
+    //! `length` bytes at `offset` replaced with `text`
+    struct Replacement {
+        qint64 offset;
+        qint64 length;
+        QByteArray text;
+    };
+
+    explicit SearchEngine(QObject *parent = 0);
+    ~SearchEngine();
+
+    /*!
+     * Cancel running search and start searching `text` for `query`.
+     * Bytes [`visibleFrom`, `visibleTo`) are searched first.
+     * Returns false if query is empty or its regular expression is not valid.
+     */
+    bool start(const PieceTable::Snapshot &text, const Query &query, qint64 visibleFrom = 0, qint64 visibleTo = 0);
+
+    /*!
+     * Cancel running search and compute replacements of all matches of
+     * `query` in `text` on the worker, `replaceReady()` brings them.
+     * `\0`...`\9` in `replacement` refer to captures of a regular expression.
+     */
+    bool startReplace(const PieceTable::Snapshot &text, const Query &query, const QString &replacement);
+
+    /*!
+     * Cancel running search and collect numbers of lines of `text` which
+     * match `query`, `linesFound()` brings them in batches in ascending order.
+     */
+    bool startFilter(const PieceTable::Snapshot &text, const Query &query);
+
+    /*! Bytes [`from`, `to`) of `text` with `replacements` applied, built in one pass. */
+    static QByteArray replaced(const PieceTable::Snapshot &text, const QVector<Replacement> &replacements,
+                               qint64 from, qint64 to);
+
+    /*! Stop searching and drop all matches. */
+    void cancel();
+
+    bool isRunning() const { return m_running; }
+
+    /*! Searched text. */
+    const PieceTable::Snapshot &text() const { return m_text; }
+
+    /*! Matches received so far, sorted by offset. */
+    const QVector<Match> &matches() const { return m_matches; }
+
+    /*! Received matches which start in [`from`, `to`). */
+    QVector<Match> matchesIn(qint64 from, qint64 to) const;
+
+    /*! Number of matches found by the worker so far, may run ahead of `matches()`. */
+    qint64 count() const { return m_count; }
+
+signals:
+    /*! Matches starting in [`from`, `to`) were added to `matches()`. */
+    void matchesFound(qint64 from, qint64 to);
+
+    void countChanged(qint64 count);
+    void finished(qint64 count);
+
+    /*! Next matching `lines` found by `startFilter()`. */
+    void linesFound(const QVector<qint64> &lines);
+
+    /*! All replacements computed by `startReplace()`, ordered by offset. */
+    void replaceReady(const QVector<aske::TextEditorPrivate::SearchEngine::Replacement> &replacements);
+
+private:
+    //! Where a batch goes in `m_matches`, text before the visible range is scanned after it
+    enum class Phase {
+        Visible,
+        Before,
+        After,
+    };
+
+    void run(Query query, qint64 visibleFrom, qint64 visibleTo, quint64 generation);
+    void runReplace(Query query, QString replacement, quint64 generation);
+    void runFilter(Query query, quint64 generation);
+    void finish(quint64 generation);
+    void receive(const QVector<Match> &batch, Phase phase, quint64 generation);
+
+    static constexpr int BatchSize = 4096; //! Matches sent to GUI thread at once at most
+    static constexpr int BatchInterval = 50; //! Milliseconds after which a smaller batch is sent
+
+    PieceTable::Snapshot m_text;
+    QVector<Match> m_matches;
+    qsizetype m_insertAt {0};             //! Where matches before the visible range go
+
+    std::thread m_thread;
+    std::atomic<bool> m_cancel {false};
+    std::atomic<qint64> m_count {0};
+    quint64 m_generation {0};             //! Batches of cancelled searches are dropped
+    bool m_running {false};
+};
+
+} // namespace TextEditorPrivate
+} // namespace aske
+
+#endif // SEARCHENGINE_H
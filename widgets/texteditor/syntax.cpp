@@ -1,9 +1,62 @@
 #include "syntax.h"
 #include "highlighters/highlighters.h"
 
+#include <QRegularExpression>
+
 namespace aske {
 namespace TextEditorPrivate {
 
+const std::map<Syntax::t, QString> Syntax::names = {
+    {Syntax::ActionScript, "ActionScript"},
+    {Syntax::Ada, "Ada"},
+    {Syntax::Asp, "ASP"},
+    {Syntax::Asm, "Assembler"},
+    {Syntax::Batch, "Batch"},
+    {Syntax::Caml, "OCaml"},
+    {Syntax::CMake, "CMake"},
+    {Syntax::Cobol, "COBOL"},
+    {Syntax::CoffeeScript, "CoffeeScript"},
+    {Syntax::Cpp, "C++"},
+    {Syntax::CSharp, "C#"},
+    {Syntax::Csv, "CSV"},
+    {Syntax::Css, "CSS"},
+    {Syntax::D, "D"},
+    {Syntax::Diff, "Diff"},
+    {Syntax::Fortran, "Fortran"},
+    {Syntax::Haskell, "Haskell"},
+    {Syntax::Html, "HTML"},
+    {Syntax::Ini, "INI"},
+    {Syntax::Java, "Java"},
+    {Syntax::JS, "JavaScript"},
+    {Syntax::Lisp, "Lisp"},
+    {Syntax::Lua, "Lua"},
+    {Syntax::Makefile, "Makefile"},
+    {Syntax::Matlab, "MATLAB"},
+    {Syntax::ObjC, "Objective-C"},
+    {Syntax::Pascal, "Pascal"},
+    {Syntax::Perl, "Perl"},
+    {Syntax::Php, "PHP"},
+    {Syntax::PostScript, "PostScript"},
+    {Syntax::PowerShell, "PowerShell"},
+    {Syntax::Python, "Python"},
+    {Syntax::R, "R"},
+    {Syntax::Ruby, "Ruby"},
+    {Syntax::Rust, "Rust"},
+    {Syntax::Shell, "Shell"},
+    {Syntax::Scheme, "Scheme"},
+    {Syntax::Smalltalk, "Smalltalk"},
+    {Syntax::Sql, "SQL"},
+    {Syntax::Tab, "Guitar Tab"},
+    {Syntax::Tcl, "Tcl"},
+    {Syntax::Tex, "TeX"},
+    {Syntax::TypeScript, "TypeScript"},
+    {Syntax::VB, "Visual Basic"},
+    {Syntax::Vhdl, "VHDL"},
+    {Syntax::Verilog, "Verilog"},
+    {Syntax::Xml, "XML"},
+    {Syntax::Yaml, "YAML"},
+};
+
 const std::map<Syntax::t, QStringList> Syntax::extensions = {
     {Syntax::ActionScript, {"as",}},
     {Syntax::Ada, {"ada",}},
@@ -55,58 +108,237 @@ const std::map<Syntax::t, QStringList> Syntax::extensions = {
     {Syntax::Yaml, {"yaml",}},
 };
 
-std::map<Syntax::t, QSyntaxHighlighter *> Syntax::highlightersPool;
+// full file names which tell syntax by themselves
+const std::map<Syntax::t, QStringList> Syntax::fileNames = {
+    {Syntax::CMake, {"CMakeLists.txt",}},
+    {Syntax::Makefile, {"Makefile", "makefile", "GNUmakefile",}},
+    {Syntax::Ruby, {"Rakefile", "Gemfile",}},
+    {Syntax::Shell, {".profile", ".bash_profile", ".bash_login", ".bash_logout", ".zshrc", ".zprofile",}},
+};
+
+// interpreter names (shebang) and vim/emacs language names (modelines)
+const std::map<Syntax::t, QStringList> Syntax::languageNames = {
+    {Syntax::Ada, {"ada",}},
+    {Syntax::Asm, {"asm", "nasm", "masm",}},
+    {Syntax::Batch, {"dosbatch", "bat",}},
+    {Syntax::Caml, {"ocaml", "tuareg",}},
+    {Syntax::CMake, {"cmake",}},
+    {Syntax::Cobol, {"cobol",}},
+    {Syntax::CoffeeScript, {"coffee",}},
+    {Syntax::Cpp, {"c", "cpp", "c++",}},
+    {Syntax::CSharp, {"cs", "csharp",}},
+    {Syntax::Csv, {"csv",}},
+    {Syntax::Css, {"css",}},
+    {Syntax::D, {"d",}},
+    {Syntax::Diff, {"diff",}},
+    {Syntax::Fortran, {"fortran", "f90",}},
+    {Syntax::Haskell, {"haskell", "runghc", "runhaskell",}},
+    {Syntax::Html, {"html",}},
+    {Syntax::Ini, {"ini", "dosini", "conf",}},
+    {Syntax::Java, {"java",}},
+    {Syntax::JS, {"javascript", "js", "json", "node", "nodejs",}},
+    {Syntax::Lisp, {"lisp", "emacs-lisp", "sbcl", "clisp",}},
+    {Syntax::Lua, {"lua", "luajit",}},
+    {Syntax::Makefile, {"make", "makefile",}},
+    {Syntax::Matlab, {"matlab", "octave",}},
+    {Syntax::ObjC, {"objc", "objective-c",}},
+    {Syntax::Pascal, {"pascal",}},
+    {Syntax::Perl, {"perl",}},
+    {Syntax::Php, {"php",}},
+    {Syntax::PostScript, {"postscr", "postscript",}},
+    {Syntax::PowerShell, {"ps1", "powershell", "pwsh",}},
+    {Syntax::Python, {"python", "pypy",}},
+    {Syntax::R, {"r", "rscript",}},
+    {Syntax::Ruby, {"ruby",}},
+    {Syntax::Rust, {"rust",}},
+    {Syntax::Shell, {"sh", "bash", "zsh", "ksh", "dash", "ash", "shell-script",}},
+    {Syntax::Scheme, {"scheme", "guile", "racket",}},
+    {Syntax::Smalltalk, {"smalltalk",}},
+    {Syntax::Sql, {"sql", "mysql", "plsql",}},
+    {Syntax::Tcl, {"tcl", "tclsh", "wish",}},
+    {Syntax::Tex, {"tex", "latex", "plaintex",}},
+    {Syntax::TypeScript, {"typescript", "ts-node", "deno",}},
+    {Syntax::VB, {"vb", "basic",}},
+    {Syntax::Vhdl, {"vhdl",}},
+    {Syntax::Verilog, {"verilog",}},
+    {Syntax::Xml, {"xml",}},
+    {Syntax::Yaml, {"yaml",}},
+};
+
+const QHash<QString, Syntax::t> &Syntax::fileIndex() {
+    static const QHash<QString, Syntax::t> index = [] {
+        QHash<QString, Syntax::t> index;
+        for(auto &s : extensions) {
+            for(const QString &ext : s.second) {
+                index.insert(ext.toLower(), s.first);
+            }
+        }
+        // full names are looked up with the leading '/', so they never clash with extensions
+        for(auto &s : fileNames) {
+            for(const QString &name : s.second) {
+                index.insert('/' + name.toLower(), s.first);
+            }
+        }
+        return index;
+    }();
+    return index;
+}
+
+const QHash<QString, Syntax::t> &Syntax::languageIndex() {
+    static const QHash<QString, Syntax::t> index = [] {
+        QHash<QString, Syntax::t> index;
+        for(auto &s : languageNames) {
+            for(const QString &name : s.second) {
+                index.insert(name, s.first);
+            }
+        }
+        return index;
+    }();
+    return index;
+}
+
+QString Syntax::name(Syntax::t syntax) {
+    auto it = names.find(syntax);
+    return it != names.end() ? it->second : QString();
+}
 
 Syntax::t Syntax::fromFile(const QString &fileName) {
+    const qsizetype slash = qMax(fileName.lastIndexOf('/'), fileName.lastIndexOf('\\'));
+    const QString name = fileName.mid(slash + 1).toLower();
+    const QHash<QString, Syntax::t> &index = fileIndex();
+
     // non-extension cases
-    if(fileName.endsWith("Makefile", Qt::CaseSensitive)) {
-        return Syntax::Makefile;
+    auto it = index.constFind('/' + name);
+    if(it != index.constEnd()) {
+        return *it;
     }
 
     // extension cases
-    QString ext = QFileInfo(fileName).suffix();
-    if(ext.isEmpty()) {
+    const qsizetype dot = name.lastIndexOf('.');
+    if(dot < 0 || dot == name.size() - 1) {
         return Syntax::No;
     }
 
-    for(auto &s : extensions) {
-        if(s.second.contains(ext, Qt::CaseInsensitive)) {
-            return s.first;
-        }
-    }
-    return Syntax::No;
+    return index.value(name.mid(dot + 1), Syntax::No);
+}
+
+Syntax::t Syntax::fromFile(const QString &fileName, const QByteArray &head) {
+    Syntax::t syntax = fromFile(fileName);
+    return syntax != Syntax::No ? syntax : fromContent(head);
 }
 
-QSyntaxHighlighter *Syntax::getHighlighter(Syntax::t syntax) {
-    if(syntax == Syntax::No) {
-        return nullptr;
+Syntax::t Syntax::fromContent(const QByteArray &head) {
+    QByteArray data = head;
+    if(data.startsWith("\xEF\xBB\xBF")) { // UTF-8 BOM
+        data.remove(0, 3);
     }
 
-    auto it = highlightersPool.find(syntax);
-    if(it == highlightersPool.end()) {
-        QSyntaxHighlighter *highlighter = nullptr;
-
-        switch(syntax) {
-            case Syntax::Cpp: highlighter = new CppHighlighter; break;
-            case Syntax::Ini: highlighter = new IniHighlighter; break;
-            case Syntax::JS: highlighter = new JSHighlighter; break;
-            case Syntax::Python: highlighter = new PythonHighlighter; break;
-            case Syntax::Rust: highlighter = new RustHighlighter; break;
-            case Syntax::Batch:
-            case Syntax::Shell: highlighter = new ShellHighlighter; break;
-            case Syntax::Tab: highlighter = new TabHighlighter; break;
-            case Syntax::Sql: highlighter = new SqlHighlighter; break;
-            default: ;
+    const QHash<QString, Syntax::t> &languages = languageIndex();
+
+    // shebang: #!/usr/bin/python3, #!/usr/bin/env -S bash -e
+    if(data.startsWith("#!")) {
+        qsizetype eol = data.indexOf('\n');
+        if(eol < 0) {
+            eol = data.size();
+        }
+        const QString line = QString::fromUtf8(data.mid(2, eol - 2)).simplified();
+        const QStringList words = line.split(' ', Qt::SkipEmptyParts);
+
+        QString interpreter;
+        for(const QString &word : words) {
+            QString program = word.mid(word.lastIndexOf('/') + 1).toLower();
+            if(program == QLatin1String("env") || program.startsWith('-')) {
+                continue;
+            }
+            interpreter = program;
+            break;
+        }
+
+        // python3.11 -> python
+        while(!interpreter.isEmpty() && (interpreter.back().isDigit() || interpreter.back() == '.')) {
+            interpreter.chop(1);
+        }
+
+        Syntax::t syntax = languages.value(interpreter, Syntax::No);
+        if(syntax != Syntax::No) {
+            return syntax;
         }
+    }
+
+    // modelines within the first lines
+    {
+        static const QRegularExpression vim(QStringLiteral(R"((?:^|\s)(?:vim?|ex):.*\b(?:ft|filetype|syntax)=([\w+-]+))"));
+        static const QRegularExpression emacs(QStringLiteral(R"(-\*-\s*(?:.*\bmode:\s*([\w+-]+)|([\w+-]+)\s*-\*-))"));
+
+        const QList<QByteArray> lines = data.left(1024).split('\n');
+        for(qsizetype i = 0; i < qMin<qsizetype>(lines.size(), 5); ++i) {
+            const QString line = QString::fromUtf8(lines[i]);
+
+            QRegularExpressionMatch match = vim.match(line);
+            if(!match.hasMatch()) {
+                match = emacs.match(line);
+            }
+            if(match.hasMatch()) {
+                QString language = match.captured(1);
+                if(language.isEmpty()) {
+                    language = match.captured(2);
+                }
+                language = language.toLower();
+                if(language.endsWith(QLatin1String("-mode"))) {
+                    language.chop(5);
+                }
 
-        if(highlighter) {
-            highlightersPool.insert( std::make_pair(syntax, highlighter) );
+                Syntax::t syntax = languages.value(language, Syntax::No);
+                if(syntax != Syntax::No) {
+                    return syntax;
+                }
+            }
         }
+    }
+
+    // sniffing of the first significant bytes
+    const QByteArray start = data.left(256).trimmed();
+    const QByteArray lower = start.left(16).toLower();
+
+    if(start.startsWith("<?xml")) {
+        return Syntax::Xml;
+    }
+    if(lower.startsWith("<!doctype html") || lower.startsWith("<html")) {
+        return Syntax::Html;
+    }
+    if(start.startsWith('{')) {
+        return Syntax::JS;
+    }
+    if(start.startsWith('[')) {
+        // JSON array, not an INI [section]
+        const QByteArray rest = start.mid(1).trimmed();
+        const char next = rest.isEmpty() ? ']' : rest.at(0);
+        if(next == '{' || next == '[' || next == ']' || next == '"' || next == '-' || (next >= '0' && next <= '9')) {
+            return Syntax::JS;
+        }
+    }
+
+    return Syntax::No;
+}
+
+Highlighter *Syntax::createHighlighter(Syntax::t syntax) {
+    switch(syntax) {
+        case Syntax::Cpp: return new CppHighlighter;
+        case Syntax::Ini: return new IniHighlighter;
+        case Syntax::JS: return new JSHighlighter;
+        case Syntax::Python: return new PythonHighlighter;
+        case Syntax::Rust: return new RustHighlighter;
+        case Syntax::Batch:
+        case Syntax::Shell: return new ShellHighlighter;
+        case Syntax::Tab: return new TabHighlighter;
+        case Syntax::Sql: return new SqlHighlighter;
+        default: break;
+    }
 
-        return highlighter;
-    } else {
-        return it->second;
+    if(const Dfa::Grammar *grammar = dfaGrammar(syntax)) {
+        return new DfaHighlighter(*grammar);
     }
+    return nullptr;
 }
 
 } // namespace TextEditorPrivate
@@ -5,10 +5,15 @@
 
 #include <map>
 #include <QString>
-#include <QFileInfo>
-#include <QSyntaxHighlighter>
+#include <QHash>
+#include "highlighters/highlighter.h"
 
 namespace aske {
+
+namespace Dfa {
+struct Grammar;
+}
+
 namespace TextEditorPrivate {
 
 /*!
@@ -70,20 +75,62 @@ public:
         Yaml,
     };
 
+    /*! Human readable name of `syntax`, e.g. "C++". */
+    static QString name(Syntax::t syntax);
+
     /*! Deduce syntax from file name. */
     static Syntax::t fromFile(const QString &fileName);
 
-    /*! Get syntax highlighter by `Syntax::t` enumeration. */
-    static QSyntaxHighlighter *getHighlighter(Syntax::t syntax);
+    /*! Deduce syntax from file name, fall back to file's content.
+     *
+     * @details
+     * `head` is the beginning of the file, few hundred bytes are enough.
+     */
+    static Syntax::t fromFile(const QString &fileName, const QByteArray &head);
+
+    /*! Deduce syntax from the beginning of file's content.
+     *
+     * @details
+     * Recognizes shebang lines (`#!/usr/bin/env python`), vim and emacs
+     * modelines (`vim: ft=sh`, `-*- mode: python -*-`) and sniffs XML,
+     * HTML and JSON by their first bytes.
+     */
+    static Syntax::t fromContent(const QByteArray &head);
 
-    /*! Get syntax highlighter by file name. */
-    static QSyntaxHighlighter *getHighlighter(const QString &fileName) {
-        return getHighlighter(Syntax::fromFile(fileName));
+    /*! Create new syntax highlighter by `Syntax::t` enumeration.
+     *
+     * @details
+     * Every document needs it's own highlighter. Highlighters of the same
+     * syntax share immutable language data, so creating one is cheap.
+     * Returns `nullptr` if there is no highlighter for `syntax`.
+     * Caller takes ownership.
+     */
+    static Highlighter *createHighlighter(Syntax::t syntax);
+
+    /*! Create new syntax highlighter by file name. */
+    static Highlighter *createHighlighter(const QString &fileName) {
+        return createHighlighter(Syntax::fromFile(fileName));
     }
 
+    /*! Grammar compiled from `texteditor/grammars` for `syntax`.
+     *
+     * @details
+     * Defined in the source generated by `grammarc`. Returns `nullptr`
+     * if there is no grammar file for `syntax`.
+     */
+    static const Dfa::Grammar *dfaGrammar(Syntax::t syntax);
+
 private:
+    static const std::map<Syntax::t, QString> names;
     static const std::map<Syntax::t, QStringList> extensions;
-    static std::map<Syntax::t, QSyntaxHighlighter *> highlightersPool;
+    static const std::map<Syntax::t, QStringList> fileNames;
+    static const std::map<Syntax::t, QStringList> languageNames;
+
+    /*! Lower-cased extensions and file names to syntax index. */
+    static const QHash<QString, Syntax::t> &fileIndex();
+
+    /*! Lower-cased interpreter and modeline language names to syntax index. */
+    static const QHash<QString, Syntax::t> &languageIndex();
 };
 
 } // namespace TextEditorPrivate
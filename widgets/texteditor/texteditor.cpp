@@ -1,8 +1,17 @@
 #include "texteditor.h"
+#include "csvview.h"
+#include "largetextview.h"
 #include <std/fs.h>
 
+#include <algorithm>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QMouseEvent>
 #include <QPainter>
+#include <QPainterPath>
+#include <QScrollBar>
 #include <QTextBlock>
+#include <QTextLayout>
 #include <QTextStream>
 
 namespace aske {
@@ -12,15 +21,207 @@ using namespace TextEditorPrivate;
 TextEditor::TextEditor(QWidget *parent)
     : QPlainTextEdit(parent)
     , m_lineNumberArea(this)
+    , m_minimap(this)
 {
+    updateGutterMetrics();
     setTypes(Type::Text);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &TextEditor::updateVisibleBlocks);
+    initSearch();
+    initDecorations();
+    initFolding();
+    initFollowing();
+    initFilter();
 }
 
 TextEditor::TextEditor(Type::mask allowedTypes, QWidget *parent)
     : QPlainTextEdit(parent)
     , m_lineNumberArea(this)
+    , m_minimap(this)
 {
+    updateGutterMetrics();
     setTypes(allowedTypes);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged, this, &TextEditor::updateVisibleBlocks);
+    initSearch();
+    initDecorations();
+    initFolding();
+    initFollowing();
+    initFilter();
+}
+
+void TextEditor::initSearch()
+{
+    m_searchTimer.setSingleShot(true);
+    m_searchTimer.setInterval(SearchDelay);
+    connect(&m_searchTimer, &QTimer::timeout, this, [this]() {
+        // replacing restarts the search when it is done
+        if(!m_replacing) {
+            startSearch(m_query);
+        }
+    });
+    connect(this, &TextEditor::textChanged, this, [this]() {
+        if(!m_query.pattern.isEmpty()) {
+            m_searchTimer.start();
+        }
+    });
+    connect(&m_search, &SearchEngine::matchesFound, this, &TextEditor::onSearchMatchesFound);
+    connect(&m_search, &SearchEngine::replaceReady, this, &TextEditor::applyReplacements);
+}
+
+void TextEditor::initDecorations()
+{
+    connect(this, &TextEditor::cursorPositionChanged, this, &TextEditor::updateBrackets);
+
+    // formatting by highlighter is reported as a change too, it does not change revision
+    m_decoratedRevision = document()->revision();
+    connect(document(), &QTextDocument::contentsChange, this, [this](int position, int removed, int added) {
+        if(document()->revision() == m_decoratedRevision) {
+            return;
+        }
+        m_decoratedRevision = document()->revision();
+
+        // search hits are stale anyway, search is restarted soon
+        m_decorations.clear(Decorations::Layer::Search);
+        m_decorations.adjust(position, removed, added);
+        updateFolding(position, removed, added);
+    });
+}
+
+void TextEditor::initFolding()
+{
+    m_folding.reset(document());
+
+    // cursor moved into a collapsed region, e.g. by search or by going to a line
+    connect(this, &TextEditor::cursorPositionChanged, this, [this]() {
+        if(!textCursor().block().isVisible()) {
+            unfoldAt(textCursor().position());
+        }
+    });
+}
+
+void TextEditor::updateFolding(int position, int removed, int added)
+{
+    // blocks [first, last] replace as many old blocks as it takes to keep the count
+    const QTextBlock firstBlock = document()->findBlock(position);
+    const QTextBlock lastBlock = document()->findBlock(position + added);
+    const int first = firstBlock.blockNumber();
+    const int last = lastBlock.isValid() ? lastBlock.blockNumber() : document()->blockCount() - 1;
+    const int removedBlocks = last - first + 1 - (document()->blockCount() - m_folding.blockCount());
+
+    QVector<Folding::Summary> summaries;
+    summaries.reserve(last - first + 1);
+    const QTextBlock end = lastBlock.isValid() ? lastBlock.next() : QTextBlock();
+    for(QTextBlock block = firstBlock; block.isValid() && block != end; block = block.next()) {
+        summaries.append(Folding::summarize(block));
+    }
+    m_folding.replaceBlocks(first, removedBlocks, summaries);
+    m_folding.adjust(position, removed, added);
+
+    // an edit of hidden text shows it, blocks may be inserted there too
+    QVector<int> touched;
+    m_folding.forEachCollapsed(position, position + added + 1, [&](qint64 from, qint64 to) {
+        const QTextBlock header = document()->findBlock(static_cast<int>(from));
+        if(position + added > header.position() + header.length() - 1 && position <= to) {
+            touched.append(static_cast<int>(from));
+        }
+    });
+    if(!touched.isEmpty()) {
+        // not while the document is still reporting the change
+        QMetaObject::invokeMethod(this, [this, touched]() {
+            for(int header : touched) {
+                unfold(header);
+            }
+        }, Qt::QueuedConnection);
+    }
+}
+
+void TextEditor::toggleFold(int blockNumber)
+{
+    const QTextBlock header = document()->findBlockByNumber(blockNumber);
+    if(!header.isValid()) {
+        return;
+    }
+    if(m_folding.collapsedEnd(header.position()) >= 0) {
+        unfold(header.position());
+        return;
+    }
+
+    const int lastNumber = m_folding.regionEnd(blockNumber);
+    if(lastNumber < 0) {
+        return;
+    }
+    const QTextBlock last = document()->findBlockByNumber(lastNumber);
+    const int end = last.position() + last.length() - 1;
+
+    setBlocksVisible(header.next(), last, false);
+    m_folding.setCollapsed(header.position(), end, true);
+
+    if(textCursor().position() > header.position() + header.length() - 1 && textCursor().position() <= end) {
+        QTextCursor cursor = textCursor();
+        cursor.setPosition(header.position() + header.length() - 1);
+        setTextCursor(cursor);
+    }
+}
+
+void TextEditor::unfold(int position)
+{
+    const qint64 end = m_folding.collapsedEnd(position);
+    if(end < 0) {
+        return;
+    }
+    m_folding.setCollapsed(position, end, false);
+
+    // regions collapsed inside this one stay collapsed
+    QVector<std::pair<qint64, qint64>> nested;
+    m_folding.forEachCollapsed(position + 1, end, [&](qint64 from, qint64 to) {
+        if(from > position) {
+            nested.append({from, to});
+        }
+    });
+    std::sort(nested.begin(), nested.end());
+
+    QTextBlock block = document()->findBlock(position).next();
+    for(const auto &[from, to] : nested) {
+        if(from < block.position()) {
+            continue;
+        }
+        const QTextBlock header = document()->findBlock(static_cast<int>(from));
+        setBlocksVisible(block, header, true);
+        block = document()->findBlock(static_cast<int>(to)).next();
+    }
+    setBlocksVisible(block, document()->findBlock(static_cast<int>(end)), true);
+}
+
+void TextEditor::unfoldAt(int position)
+{
+    QVector<int> headers;
+    m_folding.forEachCollapsed(position, position + 1, [&](qint64 from, qint64) {
+        headers.append(static_cast<int>(from));
+    });
+    for(int header : std::as_const(headers)) {
+        unfold(header);
+    }
+}
+
+void TextEditor::setBlocksVisible(QTextBlock block, const QTextBlock &last, bool visible)
+{
+    if(!block.isValid() || !last.isValid() || block.blockNumber() > last.blockNumber()) {
+        return;
+    }
+
+    // hidden blocks take no lines, the layout of the rest of the document
+    // is kept and only the document size is reported again
+    const QTextBlock end = last.next();
+    for(; block.isValid() && block != end; block = block.next()) {
+        block.setVisible(visible);
+        block.setLineCount(visible ? qMax(1, block.layout()->lineCount()) : 0);
+    }
+
+    if(auto layout = qobject_cast<QPlainTextDocumentLayout *>(document()->documentLayout())) {
+        layout->requestUpdate();
+        emit layout->documentSizeChanged(layout->documentSize());
+    }
+    viewport()->update();
+    m_lineNumberArea.update();
 }
 
 void TextEditor::setTypes(Type::mask allowedTypes)
@@ -86,6 +287,7 @@ void TextEditor::switchToType(Type::t type)
 
     if(type == Type::Code) {
         m_lineNumberArea.show();
+        m_minimap.show();
         connect(this, &TextEditor::blockCountChanged, this, &TextEditor::updateLineNumberAreaWidth);
         connect(this, &TextEditor::updateRequest, this, &TextEditor::updateLineNumberArea);
         connect(this, &TextEditor::cursorPositionChanged, this, &TextEditor::highlightCurrentLine);
@@ -99,7 +301,10 @@ void TextEditor::switchToType(Type::t type)
         highlightCurrentLine();
     } else {
         m_lineNumberArea.hide();
+        m_minimap.hide();
+        m_lineNumberDigits = 0;
         setViewportMargins(0, 0, 0, 0);
+        m_decorations.clear(Decorations::Layer::CurrentLine);
 
         disconnect(this, &TextEditor::blockCountChanged, this, &TextEditor::updateLineNumberAreaWidth);
         disconnect(this, &TextEditor::updateRequest, this, &TextEditor::updateLineNumberArea);
@@ -114,13 +319,21 @@ void TextEditor::switchToType(Type::t type)
 
 void TextEditor::openFile(const QString &fileName)
 {
+    setFollowing(false);
+    setLineFilter({});
+    delete m_filterView;
+    m_filterView = nullptr;
+    delete m_csvView;
+    m_csvView = nullptr;
     m_fileName = fileName;
+    m_loadedSize = -1;
+    m_droppedLines = 0;
 
     QFile file(m_fileName);
     file.open(QIODevice::ReadOnly);
 
     bool binary = aske::isBinary(file);
-    Syntax::t syntax = Syntax::fromFile(fileName);
+    Syntax::t syntax = binary ? Syntax::No : Syntax::fromFile(fileName, file.peek(HeadSize));
     bool code = syntax != Syntax::No;
 
     m_fileType = binary ?
@@ -135,6 +348,21 @@ void TextEditor::openFile(const QString &fileName)
     QFont f(face, 10);
     setFont(f);
 
+    // QTextDocument keeps decoded text and a layout per line, it is not for huge files
+    if(!binary && file.size() >= LargeFileSize) {
+        file.close();
+        deleteHighlighter();
+        setPlainText(QString());
+        // a huge table is browsed as a table, text is indexed only when asked for
+        if(syntax == Syntax::Csv && setCsvView(true)) {
+            closeLargeFile();
+        } else {
+            openLargeFile(fileName);
+        }
+        return;
+    }
+    closeLargeFile();
+
     if(binary) {
         if(m_currentType == Type::Hex) {
             setPlainText(binaryToText(file.readAll()));
@@ -143,8 +371,13 @@ void TextEditor::openFile(const QString &fileName)
         }
         deleteHighlighter();
     } else {
-        setPlainText(QString::fromUtf8(file.readAll()));
+        const QByteArray data = file.readAll();
+        m_loadedSize = data.size();
+        setPlainText(QString::fromUtf8(data));
         applyHighlighter(syntax);
+        if(syntax == Syntax::Csv) {
+            setCsvView(true);
+        }
     }
 
     file.close();
@@ -152,6 +385,11 @@ void TextEditor::openFile(const QString &fileName)
 
 void TextEditor::saveFile(const QString &fileName)
 {
+    if(m_largeView) {
+        m_largeView->saveFile(fileName);
+        return;
+    }
+
     QFile file(fileName);
     file.open(QIODevice::WriteOnly | QIODevice::Truncate);
     QTextStream ss(&file);
@@ -167,45 +405,721 @@ void TextEditor::saveFile()
     }
 }
 
-void TextEditor::applyHighlighter()
+bool TextEditor::setFollowing(bool following)
 {
-    deleteHighlighter();
+    if(following == isFollowing()) {
+        return true;
+    }
 
-    m_highlighter = Syntax::getHighlighter(m_fileName);
-    if(m_highlighter) {
-        m_highlighter->setDocument(document());
+    if(!following) {
+        m_followTimer.stop();
+        if(!m_followWatcher.files().isEmpty()) {
+            m_followWatcher.removePaths(m_followWatcher.files());
+        }
+        if(!m_followWatcher.directories().isEmpty()) {
+            m_followWatcher.removePaths(m_followWatcher.directories());
+        }
+        m_followFile.close();
+        // following again resumes where it stopped, nothing is appended twice
+        m_loadedSize = m_followOffset;
+        return true;
+    }
+
+    if(m_largeView || m_loadedSize < 0 || m_fileName.isEmpty()) {
+        return false;
+    }
+    m_followFile.setFileName(m_fileName);
+    if(!m_followFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // the directory shows a rotated file being replaced
+    m_followOffset = m_loadedSize;
+    m_followDecoder.resetState();
+    m_followWatcher.addPath(m_fileName);
+    m_followWatcher.addPath(QFileInfo(m_fileName).absolutePath());
+
+    readFollowed();
+    return true;
+}
+
+void TextEditor::initFollowing()
+{
+    // a busy log changes all the time, it is read at most every `FollowInterval`
+    m_followTimer.setSingleShot(true);
+    m_followTimer.setInterval(FollowInterval);
+    connect(&m_followTimer, &QTimer::timeout, this, &TextEditor::readFollowed);
+
+    auto schedule = [this]() {
+        if(!m_followTimer.isActive()) {
+            m_followTimer.start();
+        }
+    };
+    connect(&m_followWatcher, &QFileSystemWatcher::fileChanged, this, schedule);
+    connect(&m_followWatcher, &QFileSystemWatcher::directoryChanged, this, schedule);
+}
+
+void TextEditor::readFollowed()
+{
+    if(!isFollowing()) {
+        return;
+    }
+
+    // watcher drops a file which was removed or renamed away, a file of the
+    // same name is a new one then, so is a file born at another time
+    const QFileInfo info(m_fileName);
+    const QDateTime birth = info.fileTime(QFileDevice::FileBirthTime);
+    const bool replaced = info.exists()
+            && (!m_followWatcher.files().contains(m_fileName)
+                || (birth.isValid() && birth != m_followFile.fileTime(QFileDevice::FileBirthTime)));
+
+    const qint64 size = m_followFile.size();
+    if(size < m_followOffset) {
+        // truncated in place
+        m_followOffset = 0;
+        m_followDecoder.resetState();
+    }
+
+    if(size > m_followOffset) {
+        m_followFile.seek(m_followOffset);
+        const QByteArray data = m_followFile.read(qMin(size - m_followOffset, FollowChunk));
+        m_followOffset += data.size();
+        appendFollowed(data);
+
+        // the rest is read soon, the event loop is not blocked meanwhile
+        if(m_followOffset < size) {
+            m_followTimer.start();
+            return;
+        }
+    }
+
+    // old file is read up to its end, now the new one is followed from its start
+    if(replaced) {
+        m_followFile.close();
+        m_followFile.setFileName(m_fileName);
+        if(!m_followFile.open(QIODevice::ReadOnly)) {
+            setFollowing(false);
+            return;
+        }
+        m_followOffset = 0;
+        m_followDecoder.resetState();
+        m_followWatcher.addPath(m_fileName);
+        m_followTimer.start();
+    }
+}
+
+void TextEditor::appendFollowed(const QByteArray &data)
+{
+    const QString text = m_followDecoder.decode(data);
+    if(text.isEmpty()) {
+        return;
     }
+
+    QScrollBar *scrollBar = verticalScrollBar();
+    const bool atEnd = scrollBar->value() == scrollBar->maximum();
+
+    // highlighter lexes the appended blocks only, the rest is not touched
+    // every append is an undo step of its own, not merged with typing
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    cursor.insertText(text);
+    cursor.endEditBlock();
+    trimFollowed();
+
+    if(atEnd) {
+        scrollBar->setValue(scrollBar->maximum());
+    }
+}
+
+void TextEditor::trimFollowed()
+{
+    // dropping a few lines on every read costs as much as appending them,
+    // a slack of lines is collected and dropped at once
+    const int excess = blockCount() - m_followLineLimit;
+    if(excess <= m_followLineLimit / 10) {
+        return;
+    }
+
+    QTextCursor cursor(document());
+    cursor.setPosition(document()->findBlockByNumber(excess).position(), QTextCursor::KeepAnchor);
+    cursor.removeSelectedText();
+    // undo steps would keep the dropped lines in memory
+    document()->clearUndoRedoStacks();
+    m_droppedLines += excess;
+    m_lineNumberArea.update();
+}
+
+void TextEditor::initFilter()
+{
+    connect(&m_filter, &SearchEngine::linesFound, this, [this](const QVector<qint64> &lines) {
+        if(LargeTextView *view = m_largeView ? m_largeView : m_filterView) {
+            view->appendFilter(lines);
+        }
+    });
+}
+
+bool TextEditor::setLineFilter(const SearchEngine::Query &query)
+{
+    m_filter.cancel();
+    if(query.pattern.isEmpty()) {
+        clearLineFilter();
+        return true;
+    }
+
+    LargeTextView *view = m_largeView;
+    if(!view) {
+        if(!m_filterView) {
+            m_filterView = new LargeTextView(this);
+            m_filterView->setReadOnly(true);
+            m_filterView->setSearchEngine(&m_search);
+            m_filterView->hide();
+        }
+        // document is copied only when it changed since the last filter
+        if(m_filterRevision != textRevision() || m_filterView->text().size() == 0) {
+            m_filterView->setText(textSnapshot());
+            m_filterRevision = textRevision();
+        }
+        view = m_filterView;
+    }
+
+    if(!m_filter.startFilter(view->text().snapshot(), query)) {
+        return false;
+    }
+    m_filterQuery = query;
+
+    if(view == m_filterView && !m_filterView->isVisible()) {
+        m_filterView->setCursorPosition(m_filterView->text().lineStart(textCursor().blockNumber()));
+        m_filterView->setFont(font());
+        m_filterView->setLineNumbersVisible(true);
+        m_filterView->setGeometry(rect());
+        m_filterView->show();
+        m_filterView->setFocus();
+    }
+    view->setFilter({});
+    return true;
+}
+
+void TextEditor::clearLineFilter()
+{
+    if(!isLineFiltered()) {
+        return;
+    }
+    m_filterQuery = {};
+
+    if(m_largeView) {
+        m_largeView->clearFilter();
+        return;
+    }
+
+    // cursor goes to the line it was on in the projection
+    m_filterView->clearFilter();
+    m_filterView->hide();
+    const QTextBlock block = document()->findBlockByNumber(
+                static_cast<int>(m_filterView->text().lineAt(m_filterView->cursorPosition())));
+    if(block.isValid()) {
+        setTextCursor(QTextCursor(block));
+        centerCursor();
+    }
+    setFocus();
+}
+
+bool TextEditor::setCsvView(bool visible)
+{
+    if(!visible) {
+        if(!isCsvView()) {
+            return true;
+        }
+        m_csvView->hide();
+        // a huge table was not loaded as text
+        if(!m_largeView && m_loadedSize < 0) {
+            openLargeFile(m_fileName);
+        } else {
+            setFocus();
+        }
+        return true;
+    }
+
+    if(m_fileName.isEmpty() || m_fileType == Type::Hex) {
+        return false;
+    }
+    if(!m_csvView) {
+        m_csvView = new CsvView(this);
+        if(!m_csvView->openFile(m_fileName)) {
+            delete m_csvView;
+            m_csvView = nullptr;
+            return false;
+        }
+    }
+    m_csvView->setFont(font());
+    m_csvView->setGeometry(rect());
+    m_csvView->show();
+    m_csvView->raise();
+    m_csvView->setFocus();
+    return true;
+}
+
+bool TextEditor::isCsvView() const
+{
+    return m_csvView && !m_csvView->isHidden();
+}
+
+void TextEditor::openLargeFile(const QString &fileName)
+{
+    if(!m_largeView) {
+        m_largeView = new LargeTextView(this);
+        m_largeView->setSearchEngine(&m_search);
+        connect(m_largeView, &LargeTextView::textChanged, this, [this]() {
+            if(!m_query.pattern.isEmpty()) {
+                m_searchTimer.start();
+            }
+            // line numbers of the projection moved, e.g. after replacing all
+            if(isLineFiltered()) {
+                setLineFilter(m_filterQuery);
+            }
+        });
+    }
+    m_largeView->setFont(font());
+    m_largeView->setLineNumbersVisible(m_currentType == Type::Code);
+    m_largeView->setGeometry(rect());
+    m_largeView->openFile(fileName);
+    m_largeView->show();
+    m_largeView->setFocus();
+}
+
+void TextEditor::closeLargeFile()
+{
+    delete m_largeView;
+    m_largeView = nullptr;
 }
 
 void TextEditor::applyHighlighter(Syntax::t syntax)
 {
+    // highlighter is per-document, it follows document changes by itself
+    if(m_highlighter && m_syntax == syntax) {
+        return;
+    }
+
     deleteHighlighter();
 
-    m_highlighter = Syntax::getHighlighter(syntax);
+    m_syntax = syntax;
+    m_folding.setMode(syntax == Syntax::Python || syntax == Syntax::Yaml || syntax == Syntax::CoffeeScript
+                      ? Folding::Mode::Indent : Folding::Mode::Braces);
+    m_highlighter = Syntax::createHighlighter(syntax);
     if(m_highlighter) {
+        m_highlighter->setParent(this);
+        connect(m_highlighter, &Highlighter::tokensChanged, this, [this](const QTextBlock &block) {
+            m_folding.updateBlock(block.blockNumber(), Folding::summarize(block));
+        });
+        updateVisibleBlocks();
         m_highlighter->setDocument(document());
     }
+    m_minimap.setHighlighter(m_highlighter);
 }
 
 void TextEditor::deleteHighlighter()
 {
-    if(m_highlighter) {
-        m_highlighter->setDocument(nullptr);
-    }
+    m_minimap.setHighlighter(nullptr);
+    delete m_highlighter;
     m_highlighter = nullptr;
+    m_syntax = Syntax::No;
+}
+
+void TextEditor::updateVisibleBlocks()
+{
+    if(!m_highlighter) {
+        return;
+    }
+
+    // estimation is enough here: wrapped lines only make range a bit wider
+    const int first = firstVisibleBlock().blockNumber();
+    const int lines = viewport()->height() / qMax(1, fontMetrics().lineSpacing());
+
+    m_highlighter->setVisibleBlocks(first, first + lines + 1);
+}
+
+bool TextEditor::startSearch(const SearchEngine::Query &query)
+{
+    m_searchTimer.stop();
+    m_replacing = false;
+    m_query = query;
+
+    const PieceTable::Snapshot text = textSnapshot();
+    const auto visible = visibleTextRange(text);
+    const bool started = m_search.start(text, query, visible.first, visible.second);
+    clearSearchDecorations();
+    return started;
+}
+
+void TextEditor::stopSearch()
+{
+    m_searchTimer.stop();
+    m_replacing = false;
+    m_query = SearchEngine::Query();
+    m_search.cancel();
+    clearSearchDecorations();
+}
+
+bool TextEditor::replaceAll(const SearchEngine::Query &query, const QString &replacement)
+{
+    m_searchTimer.stop();
+    m_replaceQuery = query;
+    m_replacement = replacement;
+    m_replaceRevision = textRevision();
+    m_replacing = m_search.startReplace(textSnapshot(), query, replacement);
+    clearSearchDecorations();
+    return m_replacing;
+}
+
+void TextEditor::applyReplacements(const QVector<SearchEngine::Replacement> &replacements)
+{
+    if(!m_replacing) {
+        return;
+    }
+
+    // text was edited while replacements were computed
+    if(textRevision() != m_replaceRevision) {
+        replaceAll(m_replaceQuery, m_replacement);
+        return;
+    }
+    m_replacing = false;
+
+    if(!replacements.isEmpty()) {
+        if(m_largeView) {
+            m_largeView->replace(replacements);
+        } else {
+            // one edit of the span between the first and the last match: one
+            // undo step, blocks around it keep their layout and highlighting
+            const qint64 from = replacements.first().offset;
+            const qint64 to = replacements.last().offset + replacements.last().length;
+            const QString span = QString::fromUtf8(SearchEngine::replaced(m_search.text(), replacements, from, to));
+
+            if(m_highlighter) {
+                m_highlighter->setSuspended(true);
+            }
+            QTextCursor cursor(document());
+            cursor.beginEditBlock();
+            cursor.setPosition(documentPosition(from));
+            cursor.setPosition(documentPosition(to), QTextCursor::KeepAnchor);
+            cursor.insertText(span);
+            cursor.endEditBlock();
+            if(m_highlighter) {
+                m_highlighter->setSuspended(false);
+            }
+        }
+    }
+
+    if(!m_query.pattern.isEmpty()) {
+        startSearch(m_query);
+    }
+    emit replacedAll(replacements.size());
+}
+
+PieceTable::Snapshot TextEditor::textSnapshot()
+{
+    if(m_largeView) {
+        m_snapshotAscii = false;
+        return m_largeView->text().snapshot();
+    }
+
+    // document is copied once, the worker never touches it
+    PieceTable table;
+    table.setText(toPlainText().toUtf8());
+    m_snapshotAscii = table.size() == document()->characterCount() - 1;
+    return table.snapshot();
+}
+
+quint64 TextEditor::textRevision() const
+{
+    return m_largeView ? m_largeView->revision() : static_cast<quint64>(document()->revision());
+}
+
+std::pair<qint64, qint64> TextEditor::visibleTextRange(const PieceTable::Snapshot &text) const
+{
+    qint64 first = 0;
+    qint64 lines = 0;
+    if(m_largeView) {
+        first = m_largeView->firstVisibleLine();
+        lines = m_largeView->visibleLineCount();
+    } else {
+        first = firstVisibleBlock().blockNumber();
+        lines = viewport()->height() / qMax(1, fontMetrics().lineSpacing());
+    }
+    return {text.lineStart(first), text.lineStart(first + lines + 1)};
+}
+
+int TextEditor::documentPosition(qint64 offset, PositionCache *cache) const
+{
+    if(m_snapshotAscii) {
+        return static_cast<int>(qMin<qint64>(offset, document()->characterCount() - 1));
+    }
+
+    // only bytes since the previous offset of the line are decoded
+    PositionCache local;
+    if(!cache) {
+        cache = &local;
+    }
+    const PieceTable::Snapshot &text = m_search.text();
+    const qint64 line = text.lineAt(offset);
+    if(line != cache->line || offset < cache->offset) {
+        const QTextBlock block = document()->findBlockByNumber(static_cast<int>(line));
+        if(!block.isValid()) {
+            return document()->characterCount() - 1;
+        }
+        *cache = {line, text.lineStart(line), 0, block.position(), block.length()};
+    }
+    cache->column += static_cast<int>(QString::fromUtf8(text.read(cache->offset, offset - cache->offset)).size());
+    cache->offset = offset;
+    return cache->blockPosition + qMin(cache->column, cache->blockLength - 1);
+}
+
+void TextEditor::onSearchMatchesFound(qint64 from, qint64 to)
+{
+    const auto visible = visibleTextRange(m_search.text());
+    const bool isVisible = from < visible.second && to > visible.first;
+
+    if(m_largeView) {
+        if(isVisible) {
+            m_largeView->viewport()->update();
+        }
+        return;
+    }
+    if(m_filterView && m_filterView->isVisible()) {
+        m_filterView->viewport()->update();
+    }
+
+    // matches come in order, their edges are converted in a single pass over every line
+    QVector<Decorations::Decoration> decorations;
+    PositionCache cache;
+    for(const SearchEngine::Match &match : m_search.matchesIn(from, to)) {
+        const int start = documentPosition(match.offset, &cache);
+        decorations.append({start, documentPosition(match.offset + match.length, &cache), SearchColor});
+    }
+    m_decorations.add(Decorations::Layer::Search, decorations);
+
+    if(isVisible) {
+        viewport()->update();
+    }
+}
+
+void TextEditor::clearSearchDecorations()
+{
+    if(m_largeView) {
+        m_largeView->viewport()->update();
+    } else if(!m_decorations.isEmpty(Decorations::Layer::Search)) {
+        m_decorations.clear(Decorations::Layer::Search);
+        viewport()->update();
+    }
+}
+
+void TextEditor::setDiagnostics(const QVector<Decorations::Decoration> &diagnostics)
+{
+    m_decorations.set(Decorations::Layer::Diagnostics, diagnostics);
+    viewport()->update();
+}
+
+void TextEditor::updateBrackets()
+{
+    const bool had = !m_decorations.isEmpty(Decorations::Layer::Brackets);
+    m_decorations.clear(Decorations::Layer::Brackets);
+
+    const QTextCursor cursor = textCursor();
+    const QTextBlock block = cursor.block();
+    const int column = cursor.positionInBlock();
+
+    // bracket after the cursor, otherwise the one before it
+    const QVector<Highlighter::Token> tokens = Highlighter::tokens(block);
+    const Highlighter::Token *bracket = nullptr;
+    for(const Highlighter::Token &token : tokens) {
+        if(token.kind == Highlighter::Token::Bracket && (token.offset == column || token.offset == column - 1)) {
+            bracket = &token;
+            if(token.offset == column) {
+                break;
+            }
+        }
+    }
+
+    if(bracket) {
+        const int position = block.position() + bracket->offset;
+        const int pair = matchingBracket(block, bracket->offset);
+        if(pair >= 0) {
+            m_decorations.set(Decorations::Layer::Brackets, {{position, position + 1, BracketColor},
+                                                             {pair, pair + 1, BracketColor}});
+        } else {
+            m_decorations.set(Decorations::Layer::Brackets, {{position, position + 1, UnmatchedBracketColor}});
+        }
+    }
+
+    if(had || bracket) {
+        viewport()->update();
+    }
+}
+
+int TextEditor::matchingBracket(const QTextBlock &block, int offset) const
+{
+    static const QString opening = QStringLiteral("([{");
+    static const QString closing = QStringLiteral(")]}");
+
+    const QChar bracket = block.text().at(offset);
+    const bool forward = opening.contains(bracket);
+    const QChar pair = forward ? closing.at(opening.indexOf(bracket)) : opening.at(closing.indexOf(bracket));
+
+    // only brackets which the highlighter left outside of strings and comments
+    int depth = 0;
+    QTextBlock current = block;
+    for(int blocks = 0; current.isValid() && blocks < MaxBracketBlocks; ++blocks) {
+        const QString text = current.text();
+        const QVector<Highlighter::Token> tokens = Highlighter::tokens(current);
+        const qsizetype count = tokens.size();
+        for(qsizetype i = forward ? 0 : count - 1; i >= 0 && i < count; i += forward ? 1 : -1) {
+            const Highlighter::Token &token = tokens.at(i);
+            if(token.kind != Highlighter::Token::Bracket) {
+                continue;
+            }
+            if(current == block && (forward ? token.offset <= offset : token.offset >= offset)) {
+                continue;
+            }
+
+            const QChar c = text.at(token.offset);
+            if(c == bracket) {
+                ++depth;
+            } else if(c == pair && depth-- == 0) {
+                return current.position() + token.offset;
+            }
+        }
+        current = forward ? current.next() : current.previous();
+    }
+    return -1;
+}
+
+void TextEditor::paintEvent(QPaintEvent *event)
+{
+    // under the text, painter is done before the text is drawn
+    if(!m_largeView) {
+        QPainter painter(viewport());
+        paintDecorations(painter, event->rect());
+    }
+    QPlainTextEdit::paintEvent(event);
+}
+
+void TextEditor::changeEvent(QEvent *event)
+{
+    QPlainTextEdit::changeEvent(event);
+
+    if(event->type() == QEvent::FontChange) {
+        updateGutterMetrics();
+    }
+}
+
+void TextEditor::paintDecorations(QPainter &painter, const QRect &rect)
+{
+    // document range shown in `rect`
+    const QPointF offset = contentOffset();
+    QTextBlock block = firstVisibleBlock();
+    while(block.isValid() && blockBoundingGeometry(block).translated(offset).bottom() < rect.top()) {
+        block = block.next();
+    }
+    if(!block.isValid()) {
+        return;
+    }
+    const int from = block.position();
+    while(block.isValid() && blockBoundingGeometry(block).translated(offset).top() <= rect.bottom()) {
+        block = block.next();
+    }
+    const int to = block.isValid() ? block.position() : document()->characterCount();
+
+    auto paintLayer = [&](Decorations::Layer layer) {
+        m_decorations.forEachIn(layer, from, to, [&](const Decorations::Decoration &decoration) {
+            paintDecoration(painter, layer, decoration, qMax<qint64>(from, decoration.from), qMin<qint64>(to, decoration.to));
+        });
+    };
+    paintLayer(Decorations::Layer::CurrentLine);
+    paintLayer(Decorations::Layer::Search);
+    paintLayer(Decorations::Layer::Brackets);
+    paintLayer(Decorations::Layer::Diagnostics);
+}
+
+void TextEditor::paintDecoration(QPainter &painter, Decorations::Layer layer, const Decorations::Decoration &decoration,
+                                 qint64 from, qint64 to)
+{
+    const QColor color = QColor::fromRgb(decoration.color);
+    const QPointF offset = contentOffset();
+
+    for(QTextBlock block = document()->findBlock(static_cast<int>(from));
+        block.isValid() && (block.position() < to || block.position() <= from);
+        block = block.next()) {
+        if(!block.isVisible()) {
+            continue;
+        }
+
+        const QRectF geometry = blockBoundingGeometry(block).translated(offset);
+        if(layer == Decorations::Layer::CurrentLine) {
+            const QTextLine line = block.layout()->lineForTextPosition(static_cast<int>(from - block.position()));
+            const QRectF rect = line.isValid() ? line.rect().translated(geometry.topLeft()) : geometry;
+            painter.fillRect(QRectF(0, rect.top(), viewport()->width(), rect.height()), color);
+            continue;
+        }
+
+        const QTextLayout *layout = block.layout();
+        const int start = static_cast<int>(qMax<qint64>(from - block.position(), 0));
+        const int end = static_cast<int>(qMin<qint64>(to - block.position(), block.length() - 1));
+        for(int i = 0; i < layout->lineCount(); ++i) {
+            const QTextLine line = layout->lineAt(i);
+            const int lineEnd = line.textStart() + line.textLength();
+            const bool outside = start == end ? (start < line.textStart() || start > lineEnd)
+                                              : (end <= line.textStart() || start >= lineEnd);
+            if(outside) {
+                continue;
+            }
+
+            const qreal left = geometry.left() + line.cursorToX(qMax(start, line.textStart()));
+            const qreal right = geometry.left() + line.cursorToX(qMin(end, lineEnd));
+            const QRectF area(left, geometry.top() + line.y(), qMax<qreal>(right - left, 2), line.height());
+
+            if(layer == Decorations::Layer::Diagnostics) {
+                // wavy underline
+                QPainterPath path(QPointF(area.left(), area.bottom() - 1));
+                for(qreal x = area.left(), step = 2; x < area.right(); x += step) {
+                    path.lineTo(x + step, area.bottom() - (static_cast<int>((x - area.left()) / step) % 2 ? 1 : 3));
+                }
+                painter.setPen(color);
+                painter.drawPath(path);
+            } else {
+                painter.fillRect(area, color);
+            }
+        }
+    }
+}
+
+QByteArray TextEditor::documentHead() const
+{
+    if(m_largeView) {
+        return m_largeView->text().read(0, HeadSize);
+    }
+
+    QString head;
+    for(QTextBlock block = document()->begin(); block.isValid() && head.size() < HeadSize; block = block.next()) {
+        head += block.text();
+        head += '\n';
+    }
+    return head.left(HeadSize).toUtf8();
 }
 
 void TextEditor::onFileRenamed(const QString &fileName)
 {
     m_fileName = fileName;
 
+    Syntax::t syntax = Syntax::No;
     if(m_fileType == Type::Text || m_fileType == Type::Code) {
-        m_fileType = isCode(fileName) ? Type::Code : Type::Text;
+        syntax = Syntax::fromFile(fileName, documentHead());
+        m_fileType = syntax != Syntax::No ? Type::Code : Type::Text;
     }
 
     updateLook();
-    if(m_currentType != Type::Hex) {
-        applyHighlighter();
+    if(m_largeView) {
+        m_largeView->setLineNumbersVisible(m_currentType == Type::Code);
+    } else if(m_currentType != Type::Hex) {
+        applyHighlighter(syntax);
     } else {
         deleteHighlighter();
     }
@@ -213,25 +1127,58 @@ void TextEditor::onFileRenamed(const QString &fileName)
 
 int TextEditor::lineNumberAreaWidth()
 {
+    return 3 + m_digitAdvance * qMax(1, m_lineNumberDigits) + 15 + FoldMarkerWidth;
+}
+
+void TextEditor::updateGutterMetrics()
+{
+    const QFontMetrics metrics = fontMetrics();
+    m_digitAdvance = 0;
+    for(int digit = 0; digit < 10; ++digit) {
+        const QChar c(QLatin1Char('0' + digit));
+        m_digits[digit].setTextFormat(Qt::PlainText);
+        m_digits[digit].setText(QString(c));
+        m_digits[digit].prepare(QTransform(), font());
+        m_digitAdvance = qMax(m_digitAdvance, metrics.horizontalAdvance(c));
+    }
+
+    // shown gutter is sized again
+    if(m_lineNumberDigits) {
+        m_lineNumberDigits = 0;
+        updateLineNumberAreaWidth(0);
+    }
+}
+
+void TextEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
+{
+    // margins change only when the number of digits does
     int digits = 1;
-    int max = qMax(1, blockCount());
+    int max = qMax(1, blockCount() + m_droppedLines);
     while (max >= 10) {
         max /= 10;
         ++digits;
     }
+    if(digits == m_lineNumberDigits) {
+        return;
+    }
+    m_lineNumberDigits = digits;
 
-    int space = 3 + fontMetrics().boundingRect(QLatin1Char('9')).width() * digits + 15;
-
-    return space;
+    setViewportMargins(lineNumberAreaWidth(), 0, Minimap::Width, 0);
+    updateMarginWidgets();
 }
 
-void TextEditor::updateLineNumberAreaWidth(int /* newBlockCount */)
+void TextEditor::updateMarginWidgets()
 {
-    setViewportMargins(lineNumberAreaWidth(), 0, 0, 0);
+    const QRect cr = contentsRect();
+    m_lineNumberArea.setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+
+    const QRect viewportRect = viewport()->geometry();
+    m_minimap.setGeometry(QRect(viewportRect.right() + 1, viewportRect.top(), Minimap::Width, viewportRect.height()));
 }
 
 void TextEditor::updateLineNumberArea(const QRect &rect, int dy)
 {
+    // rows already drawn are blitted, only the exposed strip is painted
     if (dy)
         m_lineNumberArea.scroll(0, dy);
     else
@@ -245,33 +1192,50 @@ void TextEditor::resizeEvent(QResizeEvent *e)
 {
     QPlainTextEdit::resizeEvent(e);
 
-    QRect cr = contentsRect();
-    m_lineNumberArea.setGeometry(QRect(cr.left(), cr.top(), lineNumberAreaWidth(), cr.height()));
+    updateMarginWidgets();
+    if(m_largeView) {
+        m_largeView->setGeometry(rect());
+    }
+    if(m_filterView) {
+        m_filterView->setGeometry(rect());
+    }
+    if(m_csvView) {
+        m_csvView->setGeometry(rect());
+    }
+    if(m_currentType == Type::Code) {
+        // wrapping moved the visual lines
+        highlightCurrentLine();
+    }
+
+    updateVisibleBlocks();
 }
 
 void TextEditor::highlightCurrentLine()
 {
-    QList<QTextEdit::ExtraSelection> extraSelections;
-
     if (!isReadOnly()) {
-        QTextEdit::ExtraSelection selection;
-
-        QColor lineColor = QColor(245, 245, 245);
-
-        selection.format.setBackground(lineColor);
-        selection.format.setProperty(QTextFormat::FullWidthSelection, true);
-        selection.cursor = textCursor();
-        selection.cursor.clearSelection();
-        extraSelections.append(selection);
+        // only the visual line of the cursor, a wrapped block has several
+        const QTextCursor cursor = textCursor();
+        const QTextBlock block = cursor.block();
+        const QTextLine line = block.layout()->lineForTextPosition(cursor.positionInBlock());
+        const int start = block.position() + (line.isValid() ? line.textStart() : 0);
+        const int end = line.isValid() ? start + line.textLength() : block.position() + block.length() - 1;
+        m_decorations.set(Decorations::Layer::CurrentLine, {{start, end, CurrentLineColor}});
+    } else {
+        m_decorations.clear(Decorations::Layer::CurrentLine);
     }
 
-    setExtraSelections(extraSelections);
+    viewport()->update();
 }
 
 void TextEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
 {
     QPainter painter(&m_lineNumberArea);
     painter.fillRect(event->rect(), Qt::white);
+    painter.setFont(font());
+    painter.setPen(Qt::lightGray);
+
+    const int lineHeight = fontMetrics().height();
+    const int numberRight = m_lineNumberArea.width() - 10 - FoldMarkerWidth;
 
     QTextBlock block = firstVisibleBlock();
     int blockNumber = block.blockNumber();
@@ -279,12 +1243,39 @@ void TextEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
     int bottom = top + static_cast<int>(blockBoundingRect(block).height());
 
     while (block.isValid() && top <= event->rect().bottom()) {
+        const qint64 collapsedEnd = m_folding.collapsedEnd(block.position());
         if (block.isVisible() && bottom >= event->rect().top()) {
-            QString number = QString::number(blockNumber + 1);
+            // right aligned digit by digit from prepared glyphs, no text layout per line
+            int x = numberRight;
+            for(int number = blockNumber + 1 + m_droppedLines; number; number /= 10) {
+                x -= m_digitAdvance;
+                painter.drawStaticText(x, top, m_digits[number % 10]);
+            }
 
-            painter.setPen(Qt::lightGray);
-            painter.drawText(0, top, m_lineNumberArea.width()-10, fontMetrics().height(),
-                             Qt::AlignRight, number);
+            if(collapsedEnd >= 0 || m_folding.regionEnd(blockNumber) >= 0) {
+                // triangle pointing right if collapsed, down otherwise
+                const qreal size = FoldMarkerWidth / 2.0;
+                const QPointF center(m_lineNumberArea.width() - 6 - FoldMarkerWidth / 2.0,
+                                     top + lineHeight / 2.0);
+                QPainterPath marker;
+                if(collapsedEnd >= 0) {
+                    marker.moveTo(center + QPointF(-size / 2, -size / 2));
+                    marker.lineTo(center + QPointF(size / 2, 0));
+                    marker.lineTo(center + QPointF(-size / 2, size / 2));
+                } else {
+                    marker.moveTo(center + QPointF(-size / 2, -size / 2));
+                    marker.lineTo(center + QPointF(size / 2, -size / 2));
+                    marker.lineTo(center + QPointF(0, size / 2));
+                }
+                marker.closeSubpath();
+                painter.fillPath(marker, Qt::darkGray);
+            }
+        }
+
+        // hidden blocks of a collapsed region are skipped at once
+        if (collapsedEnd >= 0) {
+            block = document()->findBlock(static_cast<int>(collapsedEnd));
+            blockNumber = block.blockNumber();
         }
 
         block = block.next();
@@ -294,4 +1285,31 @@ void TextEditor::lineNumberAreaPaintEvent(QPaintEvent *event)
     }
 }
 
+void TextEditor::lineNumberAreaMousePressEvent(QMouseEvent *event)
+{
+    if(event->button() != Qt::LeftButton
+            || event->position().x() < m_lineNumberArea.width() - 10 - FoldMarkerWidth) {
+        return;
+    }
+
+    const qreal y = event->position().y();
+    QTextBlock block = firstVisibleBlock();
+    while(block.isValid()) {
+        const QRectF rect = blockBoundingGeometry(block).translated(contentOffset());
+        if(rect.top() > y) {
+            break;
+        }
+        if(block.isVisible() && rect.bottom() >= y) {
+            toggleFold(block.blockNumber());
+            break;
+        }
+
+        const qint64 collapsedEnd = m_folding.collapsedEnd(block.position());
+        if(collapsedEnd >= 0) {
+            block = document()->findBlock(static_cast<int>(collapsedEnd));
+        }
+        block = block.next();
+    }
+}
+
 } // namespace aske
@@ -4,12 +4,25 @@
 #define MEMORYTEXTEDITOR_H
 
 #include <askelib/std/mask.h>
+#include <QFile>
+#include <QFileSystemWatcher>
 #include <QPlainTextEdit>
+#include <QStaticText>
+#include <QStringDecoder>
+#include <QTimer>
+#include "decorations.h"
+#include "folding.h"
+#include "minimap.h"
+#include "searchengine.h"
 #include "syntax.h"
 
-class QSyntaxHighlighter;
-
 namespace aske {
+
+namespace TextEditorPrivate {
+class CsvView;
+class LargeTextView;
+} // namespace TextEditorPrivate
+
 /*!
  * @brief The TextEditor class
  *
@@ -49,7 +62,14 @@ public:
     /*! Forced switch to text editor type regardless of it's content. */
     void switchToType(Type::t types);
 
-    /*! Load data from `fileName`. Text editor's type will be changed automatically. */
+    /*!
+     * Load data from `fileName`. Text editor's type will be changed automatically.
+     *
+     * @details
+     * A text file from `LargeFileSize` is not loaded into `document()`, a
+     * view over the file covers the editor instead. It edits, selects, copies
+     * and searches, but has no syntax highlighting, folding or minimap.
+     */
     void openFile(const QString &fileName);
 
     /*! Save data from text editor to `fileName`. */
@@ -68,12 +88,105 @@ public:
     /*! Current content type */
     Type::t currentType() { return m_currentType; }
 
+    /*! Whether current file is too big for `document()` and is shown by a piece table view. */
+    bool isLargeFile() const { return m_largeView; }
+
+    /*!
+     * Follow bytes appended to the current file, like `tail -F`.
+     *
+     * @details
+     * Only the new bytes are read and appended as new blocks, a view scrolled
+     * to the end stays there. A truncated file is followed from its start, a
+     * replaced (rotated) one is read to its end and then the new file is
+     * followed. Lines above `followLineLimit()` are dropped from the top.
+     * Every append is an undo step, dropping lines clears the undo history.
+     * Following again resumes at the last byte read. Returns false if current
+     * file can not be followed: it is binary, large or there is no file.
+     */
+    bool setFollowing(bool following);
+
+    bool isFollowing() const { return m_followFile.isOpen(); }
+
+    /*! Lines kept while following. */
+    int followLineLimit() const { return m_followLineLimit; }
+    void setFollowLineLimit(int lines) { m_followLineLimit = qMax(1, lines); }
+
+    /*!
+     * Search for `query` in background and highlight matches.
+     *
+     * @details
+     * Matches in the visible lines are shown first. The search is restarted
+     * after edits until `stopSearch()`. Returns false if query is not valid.
+     */
+    bool startSearch(const TextEditorPrivate::SearchEngine::Query &query);
+
+    /*! Stop searching and remove highlighted matches. */
+    void stopSearch();
+
+    /*!
+     * Replace all matches of `query` with `replacement`.
+     *
+     * @details
+     * Matches and their replacements are computed in background, then applied
+     * as a single undoable edit with highlighting suspended, `replacedAll()`
+     * is emitted after that. Returns false if query is not valid.
+     */
+    bool replaceAll(const TextEditorPrivate::SearchEngine::Query &query, const QString &replacement);
+
+    /*!
+     * Show only lines matching `query`, an empty query shows all lines again.
+     *
+     * @details
+     * Numbers of matching lines are collected in background over the line
+     * index of the text and shown as they come, the gutter keeps original
+     * line numbers. A large file is projected in place, other text is
+     * snapshotted once per revision and shown read-only, changing the filter
+     * reuses the snapshot. Returns false if query is not valid.
+     */
+    bool setLineFilter(const TextEditorPrivate::SearchEngine::Query &query);
+
+    bool isLineFiltered() const { return !m_filterQuery.pattern.isEmpty(); }
+
+    /*! Underline document ranges of `diagnostics` with their colors, replacing previous ones. */
+    void setDiagnostics(const QVector<TextEditorPrivate::Decorations::Decoration> &diagnostics);
+
+    /*!
+     * Collapse the region started by block `blockNumber` or expand it if it is collapsed.
+     *
+     * @details
+     * Regions come from braces outside of strings and comments, or from
+     * indentation for indentation based languages. Collapsed regions follow
+     * edits and are expanded when an edit or the cursor gets inside them.
+     */
+    void toggleFold(int blockNumber);
+
+    /*!
+     * Show the file as a table or as text again.
+     *
+     * @details
+     * The table is a view of the file on disk, unsaved edits are not in it.
+     * A CSV file is opened as a table, a large one is not loaded as text
+     * until the table is hidden. Returns false if there is no text file.
+     */
+    bool setCsvView(bool visible);
+
+    bool isCsvView() const;
+
+    /*! Engine of the current search, for match count and progress signals. */
+    const TextEditorPrivate::SearchEngine &searchEngine() const { return m_search; }
+
 public slots:
     /*! This slot should be invoked if text editor's file name was changed. */
     void onFileRenamed(const QString &fileName);
 
+signals:
+    /*! `replaceAll()` replaced `count` matches. */
+    void replacedAll(qint64 count);
+
 protected:
     void resizeEvent(QResizeEvent *event) override;
+    void paintEvent(QPaintEvent *event) override;
+    void changeEvent(QEvent *event) override;
 
 private:
     void updateLook();
@@ -96,30 +209,131 @@ private:
             textEditor->lineNumberAreaPaintEvent(event);
         }
 
+        void mousePressEvent(QMouseEvent *event) override {
+            textEditor->lineNumberAreaMousePressEvent(event);
+        }
+
     private:
         TextEditor *textEditor;
     };
 
     friend class LineNumberArea;
     void lineNumberAreaPaintEvent(QPaintEvent *event);
+    void lineNumberAreaMousePressEvent(QMouseEvent *event);
     int lineNumberAreaWidth();
 
+    void updateGutterMetrics();
     void updateLineNumberAreaWidth(int newBlockCount);
+    void updateMarginWidgets();
     void highlightCurrentLine();
     void updateLineNumberArea(const QRect &, int);
 
-    void applyHighlighter();
+    void updateVisibleBlocks();
+
+    static constexpr int SearchDelay = 200; //! Milliseconds of no edits before search is restarted
+    void initSearch();
+    std::pair<qint64, qint64> visibleTextRange(const TextEditorPrivate::PieceTable::Snapshot &text) const;
+    //! Line of the last offset converted, later offsets of the line continue from it
+    struct PositionCache {
+        qint64 line {-1};
+        qint64 offset {0};
+        int column {0};
+        int blockPosition {0};
+        int blockLength {0};
+    };
+    int documentPosition(qint64 offset, PositionCache *cache = nullptr) const;
+    void onSearchMatchesFound(qint64 from, qint64 to);
+    void clearSearchDecorations();
+    TextEditorPrivate::PieceTable::Snapshot textSnapshot();
+    quint64 textRevision() const;
+    void applyReplacements(const QVector<TextEditorPrivate::SearchEngine::Replacement> &replacements);
+
+    static constexpr QRgb CurrentLineColor = 0xfff5f5f5;
+    static constexpr QRgb SearchColor = 0xffffeb82;
+    static constexpr QRgb BracketColor = 0xffc8e6c8;
+    static constexpr QRgb UnmatchedBracketColor = 0xfff5c8c8;
+    static constexpr int MaxBracketBlocks = 5000; //! Blocks scanned for a pair of a bracket
+    void initDecorations();
+    void updateBrackets();
+    int matchingBracket(const QTextBlock &block, int offset) const;
+    void paintDecorations(QPainter &painter, const QRect &rect);
+    void paintDecoration(QPainter &painter, TextEditorPrivate::Decorations::Layer layer,
+                         const TextEditorPrivate::Decorations::Decoration &decoration, qint64 from, qint64 to);
+
+    static constexpr int FoldMarkerWidth = 12; //! Width of the gutter column with fold markers
+    void initFolding();
+    void updateFolding(int position, int removed, int added);
+    void setBlocksVisible(QTextBlock block, const QTextBlock &last, bool visible);
+    void unfold(int position);
+    void unfoldAt(int position);
+
     void applyHighlighter(TextEditorPrivate::Syntax::t syntax);
+
+    static constexpr int HeadSize = 512; //! Bytes used for syntax detection by content
+    QByteArray documentHead() const;
     void deleteHighlighter();
 
+    void initFilter();
+    void clearLineFilter();
+
+    static constexpr int FollowInterval = 100;                   //! Milliseconds between reads of a followed file
+    static constexpr qint64 FollowChunk = 4 * 1024 * 1024;       //! Bytes appended at most per read
+    static constexpr int DefaultFollowLineLimit = 200000;
+    void initFollowing();
+    void readFollowed();
+    void appendFollowed(const QByteArray &data);
+    void trimFollowed();
+
+    static constexpr qint64 LargeFileSize = 64 * 1024 * 1024; //! Text files from this size are not loaded into `document()`
+    void openLargeFile(const QString &fileName);
+    void closeLargeFile();
+
     LineNumberArea m_lineNumberArea;
+    TextEditorPrivate::Minimap m_minimap;  //! Shown in Code mode right of the text
+    QStaticText m_digits[10];           //! Prepared glyphs line numbers are drawn with
+    int m_digitAdvance {0};             //! Widest digit, all digits are drawn in cells of this width
+    int m_lineNumberDigits {0};         //! Digits the gutter is sized for, 0 if it is hidden
+    int m_droppedLines {0};             //! Lines dropped from the top while following, numbering continues
     QString m_fileName;
 
     Type::mask m_allowedTypes {Type::Text | Type::Hex}; //! Types allowed by TextEditor
     Type::t m_currentType {Type::No}; //! Current TextEditorType
     Type::t m_fileType {Type::No}; //! Type of a current file
 
-    QSyntaxHighlighter *m_highlighter {nullptr};
+    Highlighter *m_highlighter {nullptr}; //! Own highlighter of `document()`
+    TextEditorPrivate::Syntax::t m_syntax {TextEditorPrivate::Syntax::No};
+
+    TextEditorPrivate::LargeTextView *m_largeView {nullptr}; //! View of a large file, covers the editor
+
+    TextEditorPrivate::CsvView *m_csvView {nullptr}; //! Table of a CSV file, covers the editor
+
+    TextEditorPrivate::SearchEngine m_search;
+    TextEditorPrivate::SearchEngine::Query m_query;             //! Empty if there is no search
+    QTimer m_searchTimer;                                       //! Restarts search after edits
+    bool m_snapshotAscii {false};                               //! Offsets in `m_search.text()` are document positions
+
+    qint64 m_loadedSize {-1};                                   //! Bytes of current file in `document()`, -1 if not text
+    QFile m_followFile;                                         //! Open while following
+    qint64 m_followOffset {0};                                  //! Bytes of `m_followFile` already appended
+    QFileSystemWatcher m_followWatcher;                         //! Watches the file and its directory
+    QTimer m_followTimer;                                       //! Coalesces change notifications
+    QStringDecoder m_followDecoder {QStringDecoder::Utf8};      //! Keeps sequences split between reads
+    int m_followLineLimit {DefaultFollowLineLimit};
+
+    TextEditorPrivate::SearchEngine m_filter;                   //! Finds lines shown while filtered
+    TextEditorPrivate::SearchEngine::Query m_filterQuery;       //! Empty if not filtered
+    TextEditorPrivate::LargeTextView *m_filterView {nullptr};   //! Projection of `document()`, covers the editor
+    quint64 m_filterRevision {0};                               //! Revision of `document()` in `m_filterView`
+
+    TextEditorPrivate::Decorations m_decorations;
+    int m_decoratedRevision {0};                                //! Revision of `document()` decorations follow
+
+    TextEditorPrivate::Folding m_folding;
+
+    bool m_replacing {false};
+    TextEditorPrivate::SearchEngine::Query m_replaceQuery;
+    QString m_replacement;
+    quint64 m_replaceRevision {0};                              //! `textRevision()` replacements are computed for
 };
 
 } // namespace aske
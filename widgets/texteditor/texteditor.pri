@@ -1,5 +1,18 @@
 # Input
 SOURCES += texteditor/texteditor.cpp \
+    texteditor/batchhighlighter.cpp \
+    texteditor/decorations.cpp \
+    texteditor/piecetable.cpp \
+    texteditor/largetextview.cpp \
+    texteditor/searchengine.cpp \
+    texteditor/folding.cpp \
+    texteditor/minimap.cpp \
+    texteditor/csvview.cpp \
+    texteditor/highlighters/highlighter.cpp \
+    texteditor/highlighters/regexrules.cpp \
+    texteditor/highlighters/lexer.cpp \
+    texteditor/highlighters/lexerstate.cpp \
+    texteditor/highlighters/dfahighlighter.cpp \
     texteditor/highlighters/clike.cpp \
     texteditor/highlighters/cplusplus.cpp \
     texteditor/highlighters/ini.cpp \
@@ -13,6 +26,21 @@ SOURCES += texteditor/texteditor.cpp \
 
 
 HEADERS += texteditor/texteditor.h \
+    texteditor/batchhighlighter.h \
+    texteditor/decorations.h \
+    texteditor/piecetable.h \
+    texteditor/largetextview.h \
+    texteditor/searchengine.h \
+    texteditor/folding.h \
+    texteditor/minimap.h \
+    texteditor/csvview.h \
+    texteditor/highlighters/highlighter.h \
+    texteditor/highlighters/keywords.h \
+    texteditor/highlighters/regexrules.h \
+    texteditor/highlighters/lexer.h \
+    texteditor/highlighters/lexerstate.h \
+    texteditor/highlighters/dfa.h \
+    texteditor/highlighters/dfahighlighter.h \
     texteditor/highlighters/clike.h \
     texteditor/highlighters/cplusplus.h \
     texteditor/highlighters/ini.h \
@@ -24,3 +52,56 @@ HEADERS += texteditor/texteditor.h \
     texteditor/highlighters/highlighters.h \
     texteditor/highlighters/sql.h \
     texteditor/syntax.h
+
+# Grammars compiled into DFA tables by tools/grammarc
+GRAMMARS += \
+    texteditor/grammars/actionscript.xml \
+    texteditor/grammars/ada.xml \
+    texteditor/grammars/asm.xml \
+    texteditor/grammars/asp.xml \
+    texteditor/grammars/caml.xml \
+    texteditor/grammars/cmake.xml \
+    texteditor/grammars/cobol.xml \
+    texteditor/grammars/coffeescript.xml \
+    texteditor/grammars/csharp.xml \
+    texteditor/grammars/css.xml \
+    texteditor/grammars/d.xml \
+    texteditor/grammars/diff.xml \
+    texteditor/grammars/fortran.xml \
+    texteditor/grammars/haskell.xml \
+    texteditor/grammars/html.xml \
+    texteditor/grammars/java.xml \
+    texteditor/grammars/lisp.xml \
+    texteditor/grammars/lua.xml \
+    texteditor/grammars/makefile.xml \
+    texteditor/grammars/matlab.xml \
+    texteditor/grammars/objc.xml \
+    texteditor/grammars/pascal.xml \
+    texteditor/grammars/perl.xml \
+    texteditor/grammars/php.xml \
+    texteditor/grammars/postscript.xml \
+    texteditor/grammars/powershell.xml \
+    texteditor/grammars/r.xml \
+    texteditor/grammars/ruby.xml \
+    texteditor/grammars/scheme.xml \
+    texteditor/grammars/smalltalk.xml \
+    texteditor/grammars/tcl.xml \
+    texteditor/grammars/tex.xml \
+    texteditor/grammars/typescript.xml \
+    texteditor/grammars/vb.xml \
+    texteditor/grammars/verilog.xml \
+    texteditor/grammars/vhdl.xml \
+    texteditor/grammars/xml.xml \
+    texteditor/grammars/yaml.xml
+
+GRAMMARC = $${ASKELIBQT_BIN_PATH}grammarc
+win32: GRAMMARC = $${GRAMMARC}.exe
+
+grammarc.name = grammarc
+grammarc.input = GRAMMARS
+grammarc.output = $$OUT_PWD/grammars.cpp
+grammarc.commands = $$shell_path($$GRAMMARC) ${QMAKE_FILE_OUT} ${QMAKE_FILE_IN}
+grammarc.depends = $$GRAMMARC
+grammarc.CONFIG += combine
+grammarc.variable_out = GENERATED_SOURCES
+QMAKE_EXTRA_COMPILERS += grammarc